@@ -54,6 +54,13 @@ app.post('/upload', function (req, res) {
             return res.status(500).send(err);
         }
 
+        //Write the .gpxb snapshot beside the upload off the event loop, so later reads skip the XML
+        gpxLib.snapshotGPXFile.async('uploads/' + uploadFile.name, (err, written) => {
+            if (err || !written) {
+                console.log('No snapshot for ' + uploadFile.name);
+            }
+        });
+
         res.redirect('/');
     });
 });
@@ -75,8 +82,11 @@ let gpxLib = ffi.Library('./parser/bin/libgpxparser.so', {
     'FiletoJSON': ['string', ['string']],
     'GPXViewtoJSON': ['string', ['string']],
     'findPathToJSON': ['string', ['string', 'float', 'float', 'float', 'float', 'float']],
+    'findPathsToJSON': ['string', ['string', 'float', 'float', 'float', 'float', 'float']],
     'createNewGPX': ['bool', ['string', 'string', 'string']],
-    'addNewRoute': ['bool', ['string', 'string', 'string', 'int']]
+    'addNewRoute': ['bool', ['string', 'string', 'string', 'int']],
+    'directoryToJSON': ['string', ['string', 'int']],
+    'snapshotGPXFile': ['bool', ['string']]
 });
 
 var connection;
@@ -102,29 +112,19 @@ function getWPTJSON(filename) {
 
 // Request FileLog from upoaded files
 //returns number of files, filenames and the gpx files themselves
+//All files are parsed in one call on the library's worker threads, off the event loop
 app.get('/getFileLog', function (req, res) {
-    fs.readdir('./uploads', (err, files) => {
-        var GPX = [];
-        var fNames = [];
-        let size = 0;
-        let num = files.length;
-        for (let i = 0; i < num; i++) {
-            if (files[i].endsWith(".gpx")) {
-                var json = getGPXdoc(files[i]);
-                if (json !== null) {
-                    if (json !== '{}') {
-                        size++;
-                        GPX.push(json);
-                        fNames.push(files[i]);
-                    }
-                }
-            }
+    gpxLib.directoryToJSON.async('./uploads', 0, (err, json) => {
+        if (err || json === null) {
+            console.log('Error in file log: ' + err);
+            res.send({
+                numFiles: 0,
+                fileNames: [],
+                files: []
+            });
+            return;
         }
-        res.send({
-            numFiles: size,
-            fileNames: fNames,
-            files: GPX
-        });
+        res.send(JSON.parse(json));
     });
 });
 
@@ -155,35 +155,24 @@ app.get('/getGPXView', function (req, res) {
 
 // finds the best bath from start to destination points based on latitude and longitude.
 //returns number of paths found and the data for those paths
+//The library keeps the end points of every upload and only reads the files that changed, off the event loop
 app.get('/findPath', function (req, res) {
-    fs.readdir('./uploads', (err, files) => {
-        var pathData = [];
-        let slat = req.query.slat;
-        let slon = req.query.slon;
-        let dlat = req.query.dlat;
-        let dlon = req.query.dlon;
-        let delta = req.query.delta;
-        let size = 0;
-        let num = files.length;
-        for (let i = 0; i < num; i++) {
-            if (files[i].endsWith(".gpx")) {
-                let fname = "./uploads/" + files[i];
-                let json = gpxLib.findPathToJSON(fname, slat, slon, dlat, dlon, delta);
-                if (json !== null) {
-                    let datap = json.split('--');
-                    for (let j = 0; j < datap.length; j++) {
-                        if (datap[j] !== '[]') {
-                            size++;
-                            pathData.push(datap[j]);
-                        }
-                    }
-                }
-            }
+    let slat = req.query.slat;
+    let slon = req.query.slon;
+    let dlat = req.query.dlat;
+    let dlon = req.query.dlon;
+    let delta = req.query.delta;
+
+    gpxLib.findPathsToJSON.async('./uploads', slat, slon, dlat, dlon, delta, (err, json) => {
+        if (err || json === null) {
+            console.log('Error in find path: ' + err);
+            res.send({
+                numPathFiles: 0,
+                foundPathData: []
+            });
+            return;
         }
-        res.send({
-            numPathFiles: size,
-            foundPathData: pathData
-        });
+        res.send(JSON.parse(json));
     });
 });
 
@@ -270,7 +259,7 @@ app.get('/storeFiles', function (req, res) {
         let prior = 0;
         let num = files.length;
         for (let i = 0; i < num; i++) {
-            if (files[i].endsWith(".gpx")) {
+            if (files[i].endsWith(".gpx") || files[i].endsWith(".gpx.gz")) {
                 var json = getGPXdoc(files[i]);
                 if (json !== null) {
                     let dataToSend = JSON.parse(json);
@@ -0,0 +1,123 @@
+/**
+ * Created by: Alexander Blankenstein
+ *
+ * Times building and walking a List, a List whose nodes come from an arena pool and an ArrayList.
+ * Usage: listbench [number of elements] [rounds]
+ **/
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "LinkedListAPI.h"
+#include "ArrayListAPI.h"
+#include "GPXArena.h"
+
+/** Function that returns the time in milliseconds, from a clock that only goes forward
+**/
+static double now(void){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+//The elements are the numbers 1 to n stored in the pointers, so there is nothing to print or free
+static char* printNumber(void* data){
+    char* str = malloc(24);
+    snprintf(str, 24, "%ld", (long)data);
+    return str;
+}
+
+static void deleteNumber(void* data){
+}
+
+static int compareNumbers(const void* first, const void* second){
+    return (long)first < (long)second ? -1 : (long)first > (long)second;
+}
+
+int main(int argc, char** argv){
+    long n = argc > 1 ? atol(argv[1]) : 1000000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 5;
+    //Summed over every walk and printed, so none of them can be left out by the compiler
+    long sum = 0;
+    void* elem;
+
+    printf("%ld elements, times in ms\n", n);
+    printf("%8s %8s %8s %8s %8s %8s %8s %8s %8s\n", "list", "iter", "pooled", "iter", "array", "iter", "index", "bulk", "fromList");
+
+    for (int r = 0; r < rounds; r++){
+        double start = now();
+        List* list = initializeList(&printNumber, &deleteNumber, &compareNumbers);
+        for (long i = 1; i <= n; i++){
+            insertBack(list, (void*)i);
+        }
+        double listBuild = now() - start;
+
+        start = now();
+        ListIterator iter = createIterator(list);
+        while ((elem = nextElement(&iter)) != NULL){
+            sum = sum + (long)elem;
+        }
+        double listIter = now() - start;
+
+        GPXArena* arena = createArena();
+        start = now();
+        List* pooled = initializeListInPool(&printNumber, &deleteNumber, &compareNumbers, &arenaPoolAlloc, arena);
+        for (long i = 1; i <= n; i++){
+            insertBack(pooled, (void*)i);
+        }
+        double pooledBuild = now() - start;
+
+        start = now();
+        iter = createIterator(pooled);
+        while ((elem = nextElement(&iter)) != NULL){
+            sum = sum + (long)elem;
+        }
+        double pooledIter = now() - start;
+
+        start = now();
+        ArrayList* array = initializeArrayList(&printNumber, &deleteNumber, &compareNumbers);
+        for (long i = 1; i <= n; i++){
+            insertArrayBack(array, (void*)i);
+        }
+        double arrayBuild = now() - start;
+
+        start = now();
+        ArrayIterator arrayIter = createArrayIterator(array);
+        while ((elem = nextArrayElement(&arrayIter)) != NULL){
+            sum = sum + (long)elem;
+        }
+        double arrayIterate = now() - start;
+
+        start = now();
+        for (int i = 0; i < getArrayLength(array); i++){
+            sum = sum + (long)getFromArray(array, i);
+        }
+        double arrayIndex = now() - start;
+
+        start = now();
+        ArrayList* bulk = initializeArrayList(&printNumber, &deleteNumber, &compareNumbers);
+        insertArrayElements(bulk, array->elements, n);
+        double bulkBuild = now() - start;
+
+        start = now();
+        ArrayList* copy = initializeArrayList(&printNumber, &deleteNumber, &compareNumbers);
+        insertListElements(copy, list);
+        double copyBuild = now() - start;
+
+        printf("%8.1f %8.1f %8.1f %8.1f %8.1f %8.1f %8.1f %8.1f %8.1f\n", listBuild, listIter, pooledBuild, pooledIter,
+               arrayBuild, arrayIterate, arrayIndex, bulkBuild, copyBuild);
+
+        freeList(list);
+        freeList(pooled);
+        freeArena(arena);
+        freeArrayList(array);
+        freeArrayList(bulk);
+        freeArrayList(copy);
+    }
+
+    printf("checksum %ld\n", sum);
+    return 0;
+}
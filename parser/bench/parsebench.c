@@ -0,0 +1,137 @@
+/**
+ * Created by: Alexander Blankenstein
+ *
+ * Times reading a GPX file into a GPXdoc with each of the create functions, and with the libxml tree and fillDoc
+ * that createGPXdoc used before it read the file as a stream. Every read is done in a child process of its own,
+ * so the peak RSS printed is that of the one read.
+ * Usage: parsebench <file.gpx> [rounds] [tree|stream|fast|compact|parallel|lazy]
+ **/
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "GPXParser.h"
+#include "GPXHelper.h"
+
+#define NUM_LOADERS 6
+
+static const char* loaderNames[NUM_LOADERS] = {"tree", "stream", "fast", "compact", "parallel", "lazy"};
+
+/** Function that returns the time in milliseconds, from a clock that only goes forward
+**/
+static double now(void){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+/** Function to read the file the way createGPXdoc did before, the whole libxml tree first and fillDoc over it
+**/
+static GPXdoc* createTreeGPXdoc(char* fileName){
+    xmlDoc* tree = readXMLFile(fileName, 0);
+    if (tree == NULL){
+        return NULL;
+    }
+    GPXdoc* doc = initializeGPXdoc();
+    fillDoc(xmlDocGetRootElement(tree), doc);
+    xmlFreeDoc(tree);
+    return doc;
+}
+
+/** Function to read the file with one of the loaders named in loaderNames
+**/
+static GPXdoc* readWith(int loader, char* fileName){
+    switch (loader){
+        case 0: return createTreeGPXdoc(fileName);
+        case 1: return createGPXdoc(fileName);
+        case 2: return createFastGPXdoc(fileName);
+        case 3: return createCompactGPXdoc(fileName);
+        case 4: return createParallelGPXdoc(fileName, 0);
+        default: return createLazyGPXdoc(fileName);
+    }
+}
+
+/** Function that returns the number of waypoints, route points and track points of a document. The points of a
+ *  lazy document are all read by it.
+**/
+static long countPoints(GPXdoc* doc){
+    long count = getNumWaypoints(doc);
+    ListIterator routes = createIterator(doc->routes);
+    Route* route;
+    while ((route = nextElement(&routes)) != NULL){
+        count = count + getLength(route->waypoints);
+    }
+
+    ListIterator tracks = createIterator(doc->tracks);
+    Track* track;
+    while ((track = nextElement(&tracks)) != NULL){
+        ListIterator segments = createIterator(track->segments);
+        TrackSegment* segment;
+        while ((segment = nextElement(&segments)) != NULL){
+            count = count + getLength(segment->waypoints);
+        }
+    }
+    return count;
+}
+
+/** Function to read the file once in this process and print how long it took
+ *@return the exit status of the child
+**/
+static int timeRead(int loader, char* fileName){
+    initGPXParser();
+
+    double start = now();
+    GPXdoc* doc = readWith(loader, fileName);
+    double ms = now() - start;
+
+    //The peak is taken before the points are counted, which reads the rest of a lazy document
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    if (doc == NULL){
+        fprintf(stderr, "%s: cannot read %s\n", loaderNames[loader], fileName);
+        return 1;
+    }
+
+    long points = countPoints(doc);
+    printf("%-9s %10.1f ms %10.2f Mpoints/s %8ld MB peak RSS %3d parses %ld points\n", loaderNames[loader], ms,
+        points / ms / 1e3, usage.ru_maxrss / 1024, getParseCount(), points);
+
+    deleteGPXdoc(doc);
+    cleanupGPXParser();
+    return 0;
+}
+
+int main(int argc, char** argv){
+    if (argc < 2){
+        fprintf(stderr, "usage: %s <file.gpx> [rounds] [tree|stream|fast|compact|parallel|lazy]\n", argv[0]);
+        return 1;
+    }
+    int rounds = argc > 2 ? atoi(argv[2]) : 3;
+    int failed = 0;
+
+    for (int loader = 0; loader < NUM_LOADERS; loader++){
+        if (argc > 3 && strcmp(argv[3], loaderNames[loader]) != 0){
+            continue;
+        }
+        for (int r = 0; r < rounds; r++){
+            fflush(stdout);
+            pid_t child = fork();
+            if (child == 0){
+                exit(timeRead(loader, argv[1]));
+            }
+
+            int status = 1;
+            if (child < 0 || waitpid(child, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0){
+                failed = 1;
+            }
+        }
+    }
+    return failed;
+}
@@ -0,0 +1,211 @@
+/**
+ * Created by: Alexander Blankenstein
+ *
+ * Times the two pieces the fast path replaced, on the contents of a real GPX file held in memory:
+ * parseGPXNumber against strtod on every lat, lon and <ele> value in the file (checking they agree bit for bit
+ * and stop at the same place), and the hand written tokenizer against an xmlTextReader, both driving the same
+ * GPXBuilder over the same buffer.
+ * Usage: scanbench <file.gpx> [rounds]
+ **/
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "GPXParser.h"
+#include "GPXNumber.h"
+#include "GPXBuilder.h"
+#include "GPXScanner.h"
+#include "GPXHelper.h"
+
+#define MAX_NUMBER 32
+
+/** Function that returns the time in milliseconds, from a clock that only goes forward
+**/
+static double now(void){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+/** Function to read a whole file into memory
+ *@return the contents, or NULL if the file cannot be read
+**/
+static char* readWhole(const char* fileName, long* len){
+    FILE* file = fopen(fileName, "rb");
+    if (file == NULL){
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    *len = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char* buffer = malloc(*len + 1);
+    if (*len <= 0 || fread(buffer, 1, *len, file) != (size_t)*len){
+        free(buffer);
+        buffer = NULL;
+    }
+    else {
+        buffer[*len] = '\0';
+    }
+    fclose(file);
+    return buffer;
+}
+
+/** Function to copy every value that follows one of the markers, up to the character that ends it, into
+ *  NUL terminated slots of MAX_NUMBER characters
+ *@return the number of values added
+**/
+static int collectNumbers(const char* buffer, const char* marker, char end, char* numbers, int num, int size){
+    int added = 0;
+    const char* at = buffer;
+    int markerLen = strlen(marker);
+
+    while (num + added < size && (at = strstr(at, marker)) != NULL){
+        at = at + markerLen;
+        const char* stop = strchr(at, end);
+        if (stop == NULL || stop - at >= MAX_NUMBER){
+            continue;
+        }
+        char* slot = numbers + (long)(num + added) * MAX_NUMBER;
+        memcpy(slot, at, stop - at);
+        slot[stop - at] = '\0';
+        added++;
+    }
+    return added;
+}
+
+/** Function to compare parseGPXNumber with strtod on the values and print the time each takes per value
+**/
+static void benchNumbers(const char* buffer, long len, int rounds){
+    //No value is shorter than 4 characters with its marker, which bounds how many there can be
+    int size = len / 4 + 1;
+    char* numbers = malloc((long)size * MAX_NUMBER);
+    int num = 0;
+    num = num + collectNumbers(buffer, " lat=\"", '"', numbers, num, size);
+    num = num + collectNumbers(buffer, " lon=\"", '"', numbers, num, size);
+    num = num + collectNumbers(buffer, "<ele>", '<', numbers, num, size);
+    if (num == 0){
+        printf("no lat, lon or ele values\n");
+        free(numbers);
+        return;
+    }
+
+    int* lens = malloc(sizeof(int) * num);
+    int mismatches = 0;
+    for (int i = 0; i < num; i++){
+        char* value = numbers + (long)i * MAX_NUMBER;
+        char* libcEnd;
+        const char* ownEnd;
+        lens[i] = strlen(value);
+        double libc = strtod(value, &libcEnd);
+        double own = parseGPXNumber(value, lens[i], &ownEnd);
+        if (memcmp(&libc, &own, sizeof(double)) != 0 || libcEnd != ownEnd){
+            mismatches++;
+        }
+    }
+
+    //The sums are printed so neither loop can be left out
+    double libcSum = 0;
+    double start = now();
+    for (int r = 0; r < rounds; r++){
+        for (int i = 0; i < num; i++){
+            libcSum = libcSum + strtod(numbers + (long)i * MAX_NUMBER, NULL);
+        }
+    }
+    double libcMs = now() - start;
+
+    double ownSum = 0;
+    start = now();
+    for (int r = 0; r < rounds; r++){
+        for (int i = 0; i < num; i++){
+            ownSum = ownSum + parseGPXNumber(numbers + (long)i * MAX_NUMBER, lens[i], NULL);
+        }
+    }
+    double ownMs = now() - start;
+
+    double count = (double)num * rounds;
+    printf("%d lat, lon and ele values, %d differ from strtod\n", num, mismatches);
+    printf("strtod         %8.1f ns/value (sum %g)\n", libcMs / count * 1e6, libcSum);
+    printf("parseGPXNumber %8.1f ns/value (sum %g), %.1fx\n", ownMs / count * 1e6, ownSum, libcMs / ownMs);
+
+    free(lens);
+    free(numbers);
+}
+
+/** Function to build a document from the buffer with the hand written tokenizer
+**/
+static GPXdoc* scanBuffer(const char* buffer, long len){
+    GPXBuilder builder;
+    GPXScanner scanner;
+
+    GPXdoc* doc = initializeGPXdoc();
+    initializeBuilder(&builder, doc);
+    initializeScanner(&scanner, &builder);
+    bool handled = scanGPXBuffer(&scanner, buffer, len);
+    clearScanner(&scanner);
+    clearBuilder(&builder);
+
+    if (!handled){
+        deleteGPXdoc(doc);
+        return NULL;
+    }
+    return doc;
+}
+
+/** Function to build a document from the buffer with an xmlTextReader, the way createGPXdoc reads a file
+**/
+static GPXdoc* readBuffer(const char* buffer, long len){
+    xmlTextReaderPtr reader = xmlReaderForMemory(buffer, len, NULL, NULL, 64);
+    if (reader == NULL){
+        return NULL;
+    }
+    GPXdoc* doc = readerToGPXdoc(reader, true, false);
+    xmlFreeTextReader(reader);
+    return doc;
+}
+
+/** Function to time building a document from the buffer, keeping the best of the rounds
+**/
+static void benchTokenizer(const char* name, GPXdoc* (*build)(const char*, long), const char* buffer, long len, int rounds){
+    double best = -1;
+    for (int r = 0; r < rounds; r++){
+        double start = now();
+        GPXdoc* doc = build(buffer, len);
+        double ms = now() - start;
+        if (doc == NULL){
+            printf("%-14s cannot read the file\n", name);
+            return;
+        }
+        deleteGPXdoc(doc);
+        best = best < 0 || ms < best ? ms : best;
+    }
+    printf("%-14s %8.1f ms %8.1f MB/s\n", name, best, len / best / 1e3);
+}
+
+int main(int argc, char** argv){
+    if (argc < 2){
+        fprintf(stderr, "usage: %s <file.gpx> [rounds]\n", argv[0]);
+        return 1;
+    }
+    int rounds = argc > 2 ? atoi(argv[2]) : 5;
+
+    long len;
+    char* buffer = readWhole(argv[1], &len);
+    if (buffer == NULL){
+        fprintf(stderr, "cannot read %s\n", argv[1]);
+        return 1;
+    }
+
+    initGPXParser();
+    benchNumbers(buffer, len, rounds);
+    benchTokenizer("xmlTextReader", &readBuffer, buffer, len, rounds);
+    benchTokenizer("scanGPXBuffer", &scanBuffer, buffer, len, rounds);
+    cleanupGPXParser();
+
+    free(buffer);
+    return 0;
+}
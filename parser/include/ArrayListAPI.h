@@ -0,0 +1,152 @@
+/**
+ * @file ArrayListAPI.h
+ * @brief File containing the function definitions of a list kept in one growing array
+ */
+
+#ifndef _ARRAY_LIST_API_
+#define _ARRAY_LIST_API_
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#include "LinkedListAPI.h"
+
+/**
+ * Metadata head of the array list.
+ * The elements are kept in order in one block that doubles in size when it is full, so the length and any
+ * element are found in constant time and nothing is allocated per element. The function pointers are the
+ * same as the ones of a List.
+ **/
+typedef struct arrayListHead{
+    void** elements;
+    int length;
+    int capacity;
+    void (*deleteData)(void* toBeDeleted);
+    int (*compare)(const void* first,const void* second);
+    char* (*printData)(void* toBePrinted);
+} ArrayList;
+
+
+/**
+ * Array list iterator structure, the next element and the end of the array.
+ **/
+typedef struct arrayIter{
+    void** element;
+    void** end;
+} ArrayIterator;
+
+
+/** Function to initialize an empty array list with the appropriate function pointers.
+*@pre function pointer arguments must not be NULL
+*@post ArrayList structure has been allocated and initialized, no elements are allocated yet
+*@return the newly allocated ArrayList struct
+*@param printFunction - function pointer to print a single element of the list
+*@param deleteFunction - function pointer to delete a single piece of data from the list
+*@param compareFunction - function pointer to compare two elements of the list in order to test for equality or order
+**/
+ArrayList* initializeArrayList(char* (*printFunction)(void* toBePrinted),void (*deleteFunction)(void* toBeDeleted),int (*compareFunction)(const void* first,const void* second));
+
+
+/** Function to make room for at least capacity elements, so that many can be added without growing the array again
+*@pre the list exists
+*@param list - pointer to the ArrayList struct
+*@param capacity - the number of elements the list should hold without growing
+**/
+void reserveArrayList(ArrayList* list, int capacity);
+
+
+/** Inserts an element at the back of the array list, growing the array when it is full
+*@pre the list exists
+*@param list - pointer to the ArrayList struct
+*@param toBeAdded - a pointer to data that is to be added to the list
+**/
+void insertArrayBack(ArrayList* list, void* toBeAdded);
+
+
+/** Inserts a run of elements at the back of the array list in order, growing the array at most once
+*@pre the list exists, elements holds numElements pointers
+*@param list - pointer to the ArrayList struct
+*@param elements - the data to add
+*@param numElements - the number of elements to add
+**/
+void insertArrayElements(ArrayList* list, void** elements, int numElements);
+
+
+/** Inserts every element of a linked list at the back of the array list, in order. The linked list is not changed.
+*@pre both lists exist
+*@param list - pointer to the ArrayList struct
+*@param other - pointer to the List struct to copy the elements of
+**/
+void insertListElements(ArrayList* list, List* other);
+
+
+/** Returns the element at an index of the array list. Does not alter the list.
+*@pre the list exists
+*@return the data at index, or NULL if index is out of range
+*@param list - pointer to the ArrayList struct
+*@param index - the index, 0 is the front
+**/
+void* getFromArray(ArrayList* list, int index);
+
+
+/** Returns the number of elements in the array list.
+*@pre the list exists
+*@return the number of elements (0 or more)
+*@param list - pointer to the ArrayList struct
+**/
+int getArrayLength(ArrayList* list);
+
+
+/** Sorts the array list with its compare function. Elements that compare equal keep their order.
+*@pre the list exists
+*@param list - pointer to the ArrayList struct
+**/
+void sortArrayList(ArrayList* list);
+
+
+/** Frees the data of every element with the list's delete function and empties the list, keeping the ArrayList struct
+ * and its array for reuse
+*@pre the list exists
+*@post the list length is 0
+*@param list - pointer to the ArrayList struct
+**/
+void clearArrayList(ArrayList* list);
+
+
+/** Deletes the entire array list, the data of every element, the array and the ArrayList struct itself
+*@pre the list exists
+*@param list - pointer to the ArrayList struct
+**/
+void freeArrayList(ArrayList* list);
+
+
+/** Returns a string representation of the array list from front to back, made with the list's printData function.
+ * The returned string must be freed by the calling function.
+*@pre the list exists, but does not have to have elements
+*@return the string
+*@param list - pointer to the ArrayList struct
+**/
+char* arrayListToString(ArrayList* list);
+
+
+/** Function for creating an iterator over the array list, used with nextArrayElement the way a ListIterator is
+ * used with nextElement. Adding elements to the list ends the use of any iterator over it, as the array may move.
+*@pre the list exists
+*@return the iterator, pointing at the front of the list
+*@param list - pointer to the ArrayList struct to iterate over
+**/
+ArrayIterator createArrayIterator(ArrayList* list);
+
+
+/** Function that returns the next element of the array list through the iterator, the front element the first
+* time it is called. Returns NULL once the end of the list is reached.
+*@pre the iterator was made by createArrayIterator and the list has not been added to since
+*@return the element the iterator pointed to when the function was called
+*@param iter - a pointer to an iterator for an ArrayList struct
+**/
+void* nextArrayElement(ArrayIterator* iter);
+
+#endif
@@ -0,0 +1,77 @@
+/**
+ * Created by: Alexander Blankenstein
+ **/
+
+#ifndef GPXARENA_H
+#define GPXARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* ******************************* Document arena *************************** */
+
+typedef struct GPXArenaBlock GPXArenaBlock;
+
+//An object from outside the arena (made by initializeWaypoint, JSONtoRoute, ...) that was added to an arena
+//document. It keeps its own memory and is deleted with the arena.
+typedef struct {
+    void* data;
+    void (*deleteData)(void* toBeDeleted);
+} GPXAdopted;
+
+//Region allocator owned by a GPXdoc. Everything the parser builds for a document is carved out of a few
+//large blocks, so freeing the document is one free per block instead of a walk over every list.
+typedef struct GPXArena {
+    GPXArenaBlock* blocks;
+    //The same blocks ordered by address, for arenaOwns
+    GPXArenaBlock** sorted;
+    int numBlocks;
+    int sizeBlocks;
+
+    GPXAdopted* adopted;
+    int numAdopted;
+    int sizeAdopted;
+
+    //Number of objects handed out and bytes requested for them
+    long allocations;
+    long bytes;
+
+    //Set once the arena was merged into another, everything is then taken from and counted in that one
+    struct GPXArena* parent;
+
+    //Number of changes made to the lists of the document, see arenaChanged
+    unsigned int numChanges;
+    //numChanges when the parser last finished building the document. While the two are the same, nothing from
+    //outside the arena was put in the document, see arenaBuilt.
+    unsigned int builtChanges;
+} GPXArena;
+
+GPXArena* createArena(void);
+
+void freeArena(GPXArena* arena);
+
+void* arenaAlloc(GPXArena* arena, size_t size);
+
+void* arenaPoolAlloc(void* arena, size_t size);
+
+char* arenaString(GPXArena* arena, const char* str, int len);
+
+bool arenaOwns(const GPXArena* arena, const void* ptr);
+
+void arenaAdopt(GPXArena* arena, void* data, void (*deleteData)(void* toBeDeleted));
+
+void arenaMerge(GPXArena* arena, GPXArena* other);
+
+void arenaChanged(void* arena);
+
+unsigned int arenaChanges(const GPXArena* arena);
+
+void arenaBuilt(GPXArena* arena, unsigned int startChanges);
+
+bool arenaUntouched(const GPXArena* arena);
+
+long arenaBlockCount(const GPXArena* arena);
+
+long arenaReserved(const GPXArena* arena);
+
+#endif
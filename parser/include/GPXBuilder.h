@@ -0,0 +1,100 @@
+/**
+ * Created by: Alexander Blankenstein
+ **/
+
+#ifndef GPXBUILDER_H
+#define GPXBUILDER_H
+
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <libxml/parser.h>
+#include <libxml/tree.h>
+#include <libxml/xmlreader.h>
+
+#include "GPXParser.h"
+#include "GPXLazy.h"
+
+/* ******************************* Event builder *************************** */
+
+//An attribute handed to the builder. Neither string is NUL terminated, so a tokenizer can pass
+//pointers straight into its input buffer.
+typedef struct {
+    const char* name;
+    int nameLen;
+    const char* value;
+    int valueLen;
+} GPXAttribute;
+
+//Fills a GPXdoc from a stream of start element / text / end element events.
+//Every ingest path (DOM walk, xmlTextReader, ...) drives one of these, so they all build identical documents.
+typedef struct {
+    GPXdoc* doc;
+
+    //Depth of the innermost open element. The root element is depth 1.
+    int depth;
+
+    //Depth of the open wpt, rte or trk, 0 when none is open
+    int objectDepth;
+    Route* route;
+    Track* track;
+
+    TrackSegment* segment;
+    int segmentDepth;
+
+    Waypoint* waypoint;
+    int waypointDepth;
+
+    //Child element whose text is being collected, dataDepth is 0 when nothing is being collected
+    const char* dataName;
+    int dataDepth;
+    char* text;
+    int textLen;
+    int textSize;
+
+    //False to keep the <ele> and <time> of waypoints only in their typed fields, see Waypoint.droppedText
+    bool keepText;
+
+    //Waypoints, route points and track points finished so far
+    long numPoints;
+
+    //Changes to the document's lists when the builder started, see arenaBuilt
+    unsigned int startChanges;
+
+    //Where the tag being handed over starts and ends, set by a tokenizer reading one buffer that starts at base
+    const char* base;
+    const char* tagStart;
+    const char* tagEnd;
+
+    //Set to only count the points of the routes and track segments right under the root and its tracks, noting
+    //where they are in the file so they are read when first used (see GPXLazy.c). part is the one that is open,
+    //outerStart/outerLen the start tag of the open track.
+    GPXLazyFile* lazy;
+    GPXLazyPart* part;
+    int partPoints;
+    long outerStart;
+    int outerLen;
+} GPXBuilder;
+
+void initializeBuilder(GPXBuilder* builder, GPXdoc* doc);
+
+void clearBuilder(GPXBuilder* builder);
+
+void builderStartElement(GPXBuilder* builder, const char* name, int nameLen, const char* nsHref, const GPXAttribute* attrs, int numAttrs);
+
+void builderText(GPXBuilder* builder, const char* text, int len);
+
+bool builderWantsText(const GPXBuilder* builder);
+
+void builderEndElement(GPXBuilder* builder);
+
+/* ******************************* libxml drivers *************************** */
+
+void builderNodeStart(GPXBuilder* builder, xmlNode* node);
+
+void builderNodeText(GPXBuilder* builder, xmlNode* node);
+
+GPXdoc* readerToGPXdoc(xmlTextReaderPtr reader, bool keepText, bool validating);
+
+#endif
@@ -0,0 +1,31 @@
+/**
+ * Created by: Alexander Blankenstein
+ **/
+
+#ifndef GPXCOLUMNS_H
+#define GPXCOLUMNS_H
+
+#include <stdbool.h>
+
+#include "GPXParser.h"
+#include "GPXArena.h"
+
+/* ******************************* Columnar points *************************** */
+
+PointColumns* initializeColumns(GPXArena* arena);
+
+void appendColumnsPoint(PointColumns* columns, const Waypoint* waypoint);
+
+GPXTotals* initializeTotals(GPXArena* arena);
+
+void appendTotalsPoint(GPXTotals* totals, double lat, double lon);
+
+GPXCounts* initializeCounts(GPXArena* arena);
+
+bool countsCurrent(const GPXCounts* counts);
+
+void markCountsCurrent(GPXCounts* counts);
+
+void mergeCounts(GPXCounts* counts, const GPXCounts* other);
+
+#endif
@@ -11,15 +11,64 @@
 #include <stdlib.h>
 #include <libxml/parser.h>
 #include <libxml/tree.h>
+#include <libxml/xmlreader.h>
 #include <math.h>
+#include <sys/stat.h>
 
 #include "GPXParser.h"
+#include "GPXArena.h"
 
 /* ******************************* List helper functions *************************** */
 
-void fillDoc(xmlNode* a_node, GPXdoc* tmpDoc, char* filename);
+void fillDoc(xmlNode* a_node, GPXdoc* tmpDoc);
 
-void createWaypoint(Waypoint* waypoint, xmlNode* a_node, xmlDocPtr doc);
+const char* findSubAttribute(const char* name, int nameLen);
+
+GPXdoc* initializeGPXdoc(void);
+
+GPXdoc* initializeSharedGPXdoc(GPXArena* arena);
+
+Waypoint* initializeWaypoint(GPXArena* arena);
+
+Route* initializeRoute(GPXArena* arena);
+
+Track* initializeTrack(GPXArena* arena);
+
+TrackSegment* initializeTrackSegment(GPXArena* arena);
+
+GPXData* initializeGPXData(GPXArena* arena, const char* name, const char* value);
+
+bool hasGPXData(const List* list, int nameId);
+
+//Room for one elevation or time written out by typedPointText
+#define GPX_TYPED_TEXT_SIZE 64
+
+int typedPointText(const Waypoint* waypoint, const char* names[2], char values[2][GPX_TYPED_TEXT_SIZE]);
+
+//What a file name says about the file, see gpxFileKind
+#define GPX_FILE_NONE 0
+#define GPX_FILE_PLAIN 1
+#define GPX_FILE_GZIP 2
+
+int gpxFileKind(const char* fileName);
+
+long long gpxFileModified(const struct stat* info);
+
+bool readFileAt(int fd, char* buffer, long len, long offset);
+
+char* readGPXSummary(char* fileName);
+
+void dropGPXSummary(const char* fileName);
+
+void dropGPXSnapshot(const char* fileName);
+
+xmlDocPtr readXMLFile(char* fileName, int options);
+
+xmlDocPtr readXMLFileWith(xmlParserCtxtPtr ctxt, char* fileName, int options);
+
+xmlTextReaderPtr readXMLStream(char* fileName, int options);
+
+void resetParseCount(void);
 
 void trim(char* str);
 
@@ -29,16 +78,40 @@ bool compareRoutesBool(const void* first, const void* second);
 
 bool compareTracksBool(const void* first, const void* second);
 
+xmlDocPtr convertToXMLDoc(GPXdoc* doc);
+
 bool convertToXML(GPXdoc* doc, char* fileName);
 
 bool validateXMLTree(char* fileName, char* gpxSchemaFile);
 
+bool validateXMLDoc(xmlDocPtr doc, char* gpxSchemaFile);
+
+int validateXMLWith(GPXValidator* validator, xmlDocPtr doc, GPXValidation* result);
+
+GPXdoc* readValidGPXdoc(GPXValidator* validator, xmlTextReaderPtr reader, GPXValidation* result);
+
+GPXValidator* sharedGPXValidator(char* gpxSchemaFile);
+
+void freeSharedGPXValidators(void);
+
+void freeSharedGPXCorpora(void);
+
 float haversine(float lat1, float lon1, float lat2, float lon2);
 
 void dummyDelete(void* data);
 
+void appendJSONString(char** json, int* len, int* size, const char* str);
+
+void appendText(char** json, int* len, int* size, const char* str);
+
 int numPointsRoutes(const Route* rt);
 
 int numPointsTracks(const Track* tr);
 
+int numWaypointData(const Waypoint* waypoint);
+
+int numRouteData(const Route* rt);
+
+int numTrackData(const Track* tr);
+
 #endif
\ No newline at end of file
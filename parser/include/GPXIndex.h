@@ -0,0 +1,133 @@
+/**
+ * Created by: Alexander Blankenstein
+ **/
+
+#ifndef GPXINDEX_H
+#define GPXINDEX_H
+
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "GPXParser.h"
+#include "GPXArena.h"
+#include "LinkedListAPI.h"
+
+/* ******************************* Name index *************************** */
+
+//One slot of a name table, entity is NULL for an empty slot
+typedef struct {
+	unsigned int hash;
+	void* entity;
+} GPXNameSlot;
+
+//Open addressing table from a name to the first entity of a list with that name
+typedef struct {
+	GPXNameSlot* slots;
+	//Number of slots, a power of two at least twice numNames
+	int size;
+	int numNames;
+	//Whether the table has been filled, and numChanges of the list when it was. The table is only used while
+	//the list has not changed since, otherwise the next lookup fills it again.
+	bool filled;
+	unsigned int numChanges;
+} GPXNameTable;
+
+//Names of the waypoints, routes and tracks of a document, see GPXdoc. Lookups from many threads fill and read
+//the tables under the lock.
+typedef struct GPXNameIndex {
+	GPXNameTable waypoints;
+	GPXNameTable routes;
+	GPXNameTable tracks;
+	pthread_mutex_t lock;
+} GPXNameIndex;
+
+GPXNameIndex* initializeNameIndex(GPXArena* arena);
+
+Waypoint* findNamedWaypoint(const GPXdoc* doc, const char* name);
+
+Route* findNamedRoute(const GPXdoc* doc, const char* name);
+
+Track* findNamedTrack(const GPXdoc* doc, const char* name);
+
+void addNamedRoute(GPXdoc* doc, Route* rt);
+
+/* ******************************* End point grid *************************** */
+
+//A start or end point on a grid, with the position of its route or track in the list
+typedef struct {
+	int row;
+	//Longitude moved into [-180, 180) for the grid, the point itself is in GPXEndTable
+	double lon;
+	int pos;
+} GPXEndEntry;
+
+//Points sorted by latitude row, then by longitude. Row rowIds[i] holds the entries from rowStarts[i] up to
+//rowStarts[i + 1].
+typedef struct {
+	GPXEndEntry* entries;
+	int numEntries;
+	int* rowIds;
+	int* rowStarts;
+	int numRows;
+} GPXEndGrid;
+
+//Start and end points of the routes or tracks of a document
+typedef struct {
+	//Route or track at every position of the list, and its first and last point as haversine takes them
+	//(first lat, first lon, last lat, last lon). Routes and tracks without both points are NULL.
+	void** entities;
+	float* points;
+	int numEntities;
+	//The first and last waypoint the points were read off, NULL for points from the totals of a lazy list.
+	//Only kept for the tables of a document.
+	const Waypoint** endPoints;
+
+	//The grids are only made for the second query after the table is filled, so a document asked once (like
+	//the one findPathToJSON opens) is not sorted for nothing
+	int numQueries;
+	bool hasGrids;
+	GPXEndGrid starts;
+	GPXEndGrid ends;
+	//Latitude of a row in degrees
+	double rowHeight;
+
+	//Positions of the points that are always measured: the ones not on the grids (not a real latitude or
+	//longitude), and numMoved more whose first or last point changed after the grids were made
+	int* outside;
+	int numOutside;
+	int sizeOutside;
+	int numMoved;
+
+	//Whether the table has been filled, and numChanges of the list when it was. The table is only used while
+	//the list has not changed since, otherwise the next query fills it again.
+	bool filled;
+	unsigned int numChanges;
+	//Changes seen by the arena of the document when endPoints were last found, see arenaChanges
+	unsigned int numDocChanges;
+} GPXEndTable;
+
+//End points of the routes and tracks of a document, see GPXdoc. Queries from many threads fill and read the
+//tables under the lock.
+typedef struct GPXEndIndex {
+	GPXEndTable routes;
+	GPXEndTable tracks;
+	pthread_mutex_t lock;
+} GPXEndIndex;
+
+GPXEndIndex* initializeEndIndex(GPXArena* arena);
+
+bool getRouteEnds(const Route* rt, float points[4]);
+
+bool getTrackEnds(const Track* tr, float points[4]);
+
+void fillEndTableWith(GPXEndTable* table, void* const* entities, const float* points, int numEntities);
+
+void findEndsBetween(GPXEndTable* table, float sourceLat, float sourceLong, float destLat, float destLong, float delta, List* found);
+
+void freeEndTable(GPXEndTable* table);
+
+void findRoutesBetween(const GPXdoc* doc, float sourceLat, float sourceLong, float destLat, float destLong, float delta, List* found);
+
+void findTracksBetween(const GPXdoc* doc, float sourceLat, float sourceLong, float destLat, float destLong, float delta, List* found);
+
+#endif
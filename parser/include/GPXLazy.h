@@ -0,0 +1,53 @@
+/**
+ * Created by: Alexander Blankenstein
+ **/
+
+#ifndef GPXLAZY_H
+#define GPXLAZY_H
+
+#include <stdbool.h>
+
+#include "GPXParser.h"
+#include "GPXArena.h"
+#include "LinkedListAPI.h"
+
+/* ******************************* Lazy point lists *************************** */
+
+//The file a lazy document was read from, shared by all of its parts
+typedef struct {
+    char* fileName;
+
+    //Size and modification time of the file when it was read, parts are only loaded from that same file
+    long long size;
+    long long modified;
+
+    //The start tag of the root element, read again before every part for its namespace declarations
+    long rootStart;
+    int rootLen;
+} GPXLazyFile;
+
+//Where the points of one route or track segment are in the file. Loading reads the root start tag, the
+//start tag of the track (for segments) and the whole <rte> or <trkseg> element, and nothing else.
+typedef struct {
+    GPXLazyFile* file;
+
+    //The start tag of the track the segment is in, outerLen is 0 for routes
+    long outerStart;
+    int outerLen;
+
+    long start;
+    long end;
+
+    //The columns of the route or segment, swapped for the ones built when the points are loaded
+    PointColumns** columns;
+} GPXLazyPart;
+
+GPXLazyFile* initializeLazyFile(GPXArena* arena, const char* fileName, long long size, long long modified);
+
+GPXLazyPart* initializeLazyPart(GPXArena* arena, GPXLazyFile* file);
+
+void loadLazyPart(List* list, void* source);
+
+GPXdoc* scanLazyGPXFile(char* fileName, bool* handled);
+
+#endif
@@ -0,0 +1,28 @@
+/**
+ * Created by: Alexander Blankenstein
+ **/
+
+#ifndef GPXNAMES_H
+#define GPXNAMES_H
+
+/* ******************************* Interned element names *************************** */
+
+//Process wide table of GPXData element names. Every distinct name is stored once and GPXData keeps its
+//index, so equal names have equal ids. The names the parser produces are built in, in the order of the
+//subAttributes table, and resolve without locking. Other names are added on first use.
+#define GPX_NAME_NAME 0
+#define GPX_NAME_DESC 1
+#define GPX_NAME_RTEPT 2
+#define GPX_NAME_TRKSEG 3
+#define GPX_NAME_TRKPT 4
+#define GPX_NAME_ELE 5
+#define GPX_NAME_TIME 6
+
+//Names are cut to this many bytes, the size GPXData.name used to have
+#define GPX_NAME_MAX 255
+
+int internGPXName(const char* name, int len);
+
+const char* gpxNameString(int id);
+
+#endif
@@ -0,0 +1,29 @@
+/**
+ * Created by: Alexander Blankenstein
+ **/
+
+#ifndef GPXNUMBER_H
+#define GPXNUMBER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* ******************************* Number parsing *************************** */
+
+//Reads coordinates, elevations and versions the way strtod does in the C locale, whatever locale the
+//process runs in. Plain decimals (the only thing GPX files hold in practice) are converted without
+//calling into libc, and the result is always the correctly rounded double strtod would give.
+double parseGPXNumber(const char* str, int len, const char** end);
+
+bool parseGPXNumberExactly(const char* str, int len, double* value);
+
+//Reads an xsd:dateTime (YYYY-MM-DDThh:mm:ss[.fff][Z|+hh:mm|-hh:mm], as used by <time>) into milliseconds
+//since 1970-01-01T00:00:00Z. A time without a zone is taken as UTC.
+bool parseGPXTime(const char* str, int len, int64_t* ms);
+
+//The way back, for values that were only kept in decoded form
+int formatGPXElevation(float value, char* buffer, int size);
+
+int formatGPXTime(int64_t ms, char* buffer, int size);
+
+#endif
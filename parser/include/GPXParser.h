@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
+#include <stdint.h>
 #include <libxml/parser.h>
 #include <libxml/tree.h>
 #include <libxml/encoding.h>
@@ -19,14 +20,22 @@
 //Represents a generic GPX element/XML node - i.e. some sort of an additinal piece of data, 
 // e.g. comment, elevation, desciption, etc..
 typedef struct  {
-    //GPXData name.  Must not be an empty string.
-	char 	name[256];
+    //Id of the GPXData name in the interned name table, use getGPXDataName to read the name.
+    //Two GPXData have the same name exactly when their ids are equal.
+	int 	nameId;
 
     //GPXData value.  We use a C99 flexible array member, which we will discuss in class.
 	//Must not be an empty string
 	char	value[]; 
 } GPXData;
 
+//Value of Waypoint.time and PointColumns.time for a point without a readable <time>
+#define GPX_NO_TIME INT64_MIN
+
+//Bits of Waypoint.droppedText
+#define GPX_DROPPED_ELE 1
+#define GPX_DROPPED_TIME 2
+
 typedef struct {
     //Waypoint name.  Must not be NULL.  May be an empty string.
     char* name;
@@ -43,8 +52,70 @@ typedef struct {
     //the name already has its own dedicated filed in the Waypoint sruct - so do not place the name in this list
     //All objects in the list will be of type GPXData.  It must not be NULL.  It may be empty.
     List* otherData;
+
+    //The first readable <ele> and <time>, decoded by the parser. NAN and GPX_NO_TIME when the point has none.
+    float elevation;
+    //GPX_DROPPED_ELE and GPX_DROPPED_TIME for the ones createCompactGPXdoc dropped the text of from otherData.
+    //The XML and string writers put back only those, a value set anywhere else is never written out as text.
+    unsigned char droppedText;
+    int64_t time;
 } Waypoint;
 
+//Columnar copy of the points of a route or track segment, one contiguous array per value, filled by the parser
+//next to the waypoint list. Use getRouteColumns/getSegmentColumns to get it, they return NULL once the
+//waypoint list no longer matches it, points moved in place included. The lists stay the reference, the columns
+//are a faster way to read them.
+typedef struct {
+    //Number of points, and the room in the arrays
+    int length;
+    int size;
+
+    double* lat;
+    double* lon;
+    //Elevation from a numeric <ele>, NAN when the point has none
+    double* ele;
+    //Milliseconds since 1970-01-01T00:00:00Z from <time>, GPX_NO_TIME when the point has none
+    int64_t* time;
+
+    //Sparse table of the other data, ordered by point: data[i] belongs to point dataPoint[i].
+    //Holds every GPXData of a point except the <ele> and <time> stored in the columns above.
+    int numData;
+    int sizeData;
+    int* dataPoint;
+    GPXData** data;
+} PointColumns;
+
+//Counts of a whole document, so getNumSegments does not walk it. The parser makes them as it reads the file and
+//addWaypoint/addRoute carry them on. Every list of the document is watched by its arena (see watchList), a
+//segment list put in the document with insertBack is watched once getNumSegments has counted it, and the counts
+//are only used while the arena has seen no change since they were last known to be right.
+//getNumGPXData is not kept here: names can be changed in place, which no list sees.
+//numSegments is -1 while not known (a lazy document has not read its points yet).
+typedef struct {
+    //The document's arena, and its number of changes when the counts were last right
+    struct GPXArena* arena;
+    unsigned int numChanges;
+
+    int numWaypoints;
+    int numRoutes;
+    int numTracks;
+    int numSegments;
+} GPXCounts;
+
+//Running totals of the points of a route or track, so its length is not summed again on every call.
+//getRouteLen/getTrackLen fill them on first use and the parser carries them on as points are appended.
+//numPoints is -1 until they are filled. They are summed from the columns, so they are only used while those still
+//match the waypoint lists, or while a lazy document has not read the points they were read from.
+typedef struct {
+    int numPoints;
+    //Sum of the distances between consecutive points, added in the same order getRouteLen/getTrackLen use
+    float length;
+    double firstLat;
+    double firstLon;
+    double lastLat;
+    double lastLon;
+} GPXTotals;
+
 typedef struct {
     //Route name.  Must not be NULL.  May be an empty string.
     char* name;
@@ -59,12 +130,21 @@ typedef struct {
     //the name already has its own dedicated filed in the Waypoint sruct - so do not place the name in this list
     //All objects in the list will be of type GPXData.  It must not be NULL.  It may be empty.
     List* otherData;
+
+    //Columnar copy of the waypoints, NULL for routes not made by the parser
+    PointColumns* columns;
+
+    //Cached length, NULL for routes not made by the parser
+    GPXTotals* totals;
 } Route;
 
 typedef struct {
     //Waypoints that make up the track segment
     //All objects in the list will be of type Waypoint.  It must not be NULL.  It may be empty.
     List* waypoints;
+
+    //Columnar copy of the waypoints, NULL for segments not made by the parser
+    PointColumns* columns;
 } TrackSegment;
 
 typedef struct {
@@ -81,6 +161,9 @@ typedef struct {
     //the name already has its own dedicated filed in the Waypoint sruct - so do not place the name in this list
     //All objects in the list will be of type GPXData.  It must not be NULL.  It may be empty.
     List* otherData;
+
+    //Cached length, NULL for tracks not made by the parser
+    GPXTotals* totals;
 } Track;
 
 
@@ -107,8 +190,35 @@ typedef struct {
     //Tracks in the GPX file
     //All objects in the list will be of type Track.  It must not be NULL.  It may be empty.
     List* tracks;
+
+    //Region every object the parser made for the document is allocated from, freed as a whole by deleteGPXdoc.
+    //See "List helper functions" for what happens to objects and strings made elsewhere.
+    struct GPXArena* arena;
+
+    //Counts kept as the document is read and changed, see GPXCounts
+    GPXCounts* counts;
+
+    //Hash tables from names to the first waypoint, route and track with that name, filled by the first
+    //getWaypoint/getRoute/getTrack call and again when the list changes. NULL to always search.
+    struct GPXNameIndex* names;
+
+    //Grids of the start and end points of the routes and tracks, filled by the first
+    //getRoutesBetween/getTracksBetween call and again when the list changes. Points moved since are found by
+    //every call and measured. NULL to always measure every route and track.
+    struct GPXEndIndex* ends;
 } GPXdoc;
 
+//Memory held by a document, see getGPXdocMemory
+typedef struct {
+    //Structs, strings and list nodes making up the document
+    long objects;
+    //malloc calls backing them
+    long systemAllocations;
+    //Bytes handed out to the objects, and bytes taken from the system for them
+    long bytes;
+    long reserved;
+} GPXMemoryStats;
+
 /* Public API - main */
 
 /** Function to create an GPX object based on the contents of an GPX file.
@@ -131,7 +241,8 @@ GPXdoc* createGPXdoc(char* fileName);
 **/
 char* GPXdocToString(GPXdoc* doc);
 
-/** Function to delete doc content and free all the memory.
+/** Function to delete doc content and free all the memory. For a document the parser read, that is its arena
+ *  and whatever was put into the document from outside it (see "List helper functions").
  *@pre GPX object exists, is not null, and has not been freed
  *@post GPX object had been freed
  *@return none
@@ -175,8 +286,8 @@ Track* getTrack(const GPXdoc* doc, char* name);
 Route* getRoute(const GPXdoc* doc, char* name);
 
 /** Function to create an GPX object based on the contents of an GPX file.
- * This function must validate the XML tree generated by libxml against a GPX schema file
- * before attempting to traverse the tree and create an GPXdoc struct
+ * The file is validated against a GPX schema file while it is read, in the same pass that builds the
+ * GPXdoc struct. The schema is compiled once and kept. A file that breaks the schema gives NULL.
  *@pre File name cannot be an empty string or NULL.
        File represented by this name must exist and must be readable.
  *@post Either:
@@ -189,6 +300,143 @@ Route* getRoute(const GPXdoc* doc, char* name);
 **/
 GPXdoc* createValidGPXdoc(char* fileName, char* gpxSchemaFile);
 
+/** Function to create an GPX object like createGPXdoc, but reading the file through a memory mapped
+ * tokenizer instead of libxml. Files using anything the tokenizer does not handle (a DOCTYPE, another
+ * encoding, malformed markup, ...) fall back to createGPXdoc, so the result is always the same.
+ *@pre File name cannot be an empty string or NULL.
+       File represented by this name must exist and must be readable.
+ *@post Either:
+        A valid GPXdoc has been created and its address was returned
+		or 
+		An error occurred, and NULL was returned
+ *@return the pinter to the new struct or NULL
+ *@param fileName - a string containing the name of the GPX file
+**/
+GPXdoc* createFastGPXdoc(char* fileName);
+
+/** Function to create an GPX object like createFastGPXdoc, keeping the <ele> and <time> of waypoints only as
+ * the typed elevation and time fields. Their text is dropped from otherData, so the values are written back
+ * in a normalized form (shortest decimal elevation, UTC time) instead of the exact original text.
+ *@pre File name cannot be an empty string or NULL.
+       File represented by this name must exist and must be readable.
+ *@post Either:
+        A valid GPXdoc has been created and its address was returned
+		or 
+		An error occurred, and NULL was returned
+ *@return the pinter to the new struct or NULL
+ *@param fileName - a string containing the name of the GPX file
+**/
+GPXdoc* createCompactGPXdoc(char* fileName);
+
+/** Function to create an GPX object like createFastGPXdoc, splitting a large file at <trkseg>, <trk> and <rte>
+ * tags and reading the parts on several threads. The parts are joined in file order, so the result is the same
+ * as createFastGPXdoc gives. Files under a few MB are read on the calling thread.
+ *@pre File name cannot be an empty string or NULL.
+       File represented by this name must exist and must be readable.
+ *@post Either:
+        A valid GPXdoc has been created and its address was returned
+		or 
+		An error occurred, and NULL was returned
+ *@return the pinter to the new struct or NULL
+ *@param fileName - a string containing the name of the GPX file
+ *@param numThreads - the number of threads to use, 0 or less for one per processor
+**/
+GPXdoc* createParallelGPXdoc(char* fileName, int numThreads);
+
+/** Function to create an GPX object like createFastGPXdoc whose route and track points are only read when they
+ * are first used. The file is tokenized once up front for the names, data, point counts and lengths, so the
+ * counts, getRouteLen/getTrackLen, isLoopRoute/isLoopTrack and the JSON summaries never build a point. Anything
+ * that walks or changes the waypoints of a route or segment reads that one <rte> or <trkseg> from the file
+ * again. If the file has changed by then, the list is left empty. Files the tokenizer does not handle are read
+ * in full like createFastGPXdoc does. The document can be read from many threads at once like any other, a part
+ * is read once and the other threads asking for it wait until it is in place.
+ *@pre File name cannot be an empty string or NULL.
+       File represented by this name must exist and must be readable.
+ *@post Either:
+        A valid GPXdoc has been created and its address was returned
+		or 
+		An error occurred, and NULL was returned
+ *@return the pinter to the new struct or NULL
+ *@param fileName - a string containing the name of the GPX file
+**/
+GPXdoc* createLazyGPXdoc(char* fileName);
+
+/** Function to write a GPX object to a .gpxb snapshot, a binary copy of it that loads without parsing any XML.
+ * The snapshot has a version, the byte order of the machine and a checksum, a snapshot that does not match
+ * them is never loaded. It is written to a temporary file that is then renamed over fileName.
+ *@pre GPXdoc object exists and is not NULL, file name is not NULL or empty
+ *@return true if the snapshot was written, false otherwise
+ *@param doc - a pointer to a GPXdoc struct
+ *@param fileName - the name of the snapshot file
+**/
+bool writeGPXSnapshot(GPXdoc* doc, char* fileName);
+
+/** Function to create an GPX object from a .gpxb snapshot written by writeGPXSnapshot or snapshotGPXFile.
+ * The document is the same as the one that was written, including the columns and cached lengths. All of it is
+ * copied out of the snapshot, so the file can be removed straight after.
+ *@pre File name cannot be an empty string or NULL.
+ *@return the pinter to the new struct, or NULL if the file is missing, from another version or machine, or damaged
+ *@param fileName - the name of the snapshot file
+**/
+GPXdoc* readGPXSnapshot(char* fileName);
+
+/** Function to parse a .gpx or .gpx.gz file like createFastGPXdoc and write its snapshot beside it, named like
+ * the file with .gpxb in place of the extension. The snapshot records the size and modification time of the file.
+ *@pre File name cannot be an empty string or NULL.
+ *@return true if the snapshot was written, false otherwise
+ *@param fileName - the name of the GPX file
+**/
+bool snapshotGPXFile(char* fileName);
+
+/** Function to create an GPX object from the snapshot snapshotGPXFile wrote beside a .gpx or .gpx.gz file.
+ * If there is none, or the file has changed since it was written, the file is parsed like createFastGPXdoc.
+ * Like createLazyGPXdoc, the route and segment points are only read from the snapshot when they are first used,
+ * the rest of the document, cached lengths included, is there straight away. If the snapshot has
+ * changed or is gone by then (writeGPXdoc on the file removes it), the list is left empty.
+ *@pre File name cannot be an empty string or NULL.
+       File represented by this name must exist and must be readable.
+ *@post Either:
+        A valid GPXdoc has been created and its address was returned
+		or
+		An error occurred, and NULL was returned
+ *@return the pinter to the new struct or NULL
+ *@param fileName - the name of the GPX file
+**/
+GPXdoc* createSnapshotGPXdoc(char* fileName);
+
+/** Functions that return the columnar copy of the points of a route or track segment
+ *@pre Route/segment object exists and is not NULL
+ *@return the columns, or NULL if there are none or they no longer match the waypoint list. The coordinates
+    of the points are compared with the columns on every call. Points of a lazy document that were not read
+    yet have no columns.
+ *@param rt/seg - a pointer to a Route/TrackSegment struct
+**/
+const PointColumns* getRouteColumns(const Route* rt);
+const PointColumns* getSegmentColumns(const TrackSegment* seg);
+
+/** Function that finds the other data of one point in the columns' sparse table
+ *@pre columns exist and index is between 0 and columns->length - 1
+ *@return the number of GPXData the point has
+ *@param columns - the columns
+ *@param index - the point
+ *@param data - set to the first of them, inside columns->data
+**/
+int getPointData(const PointColumns* columns, int index, GPXData* const** data);
+
+/** Function that reports the memory a document built by the parser holds. Objects made outside the
+ * document and added to it afterwards are not counted.
+ *@pre GPXdoc object exists and is not NULL
+ *@return the counts, all zero if the document has no arena
+ *@param doc - a pointer to a GPXdoc struct
+**/
+GPXMemoryStats getGPXdocMemory(const GPXdoc* doc);
+
+/** Function that returns how many times libxml parsed a file during the calling thread's most recent
+ * createGPXdoc, createFastGPXdoc, createCompactGPXdoc, createParallelGPXdoc, createLazyGPXdoc or createValidGPXdoc call. Every ingest should parse its file at most once.
+ *@return the number of libxml parse invocations
+**/
+int getParseCount(void);
+
 /** Function to validating an existing a GPXobject object against a GPX schema file
  *@pre 
     GPXdoc object exists and is not NULL
@@ -200,7 +448,8 @@ GPXdoc* createValidGPXdoc(char* fileName, char* gpxSchemaFile);
  **/
 bool validateGPXDoc(GPXdoc* doc, char* gpxSchemaFile);
 
-/** Function to writing a GPXdoc into a file in GPX format.
+/** Function to writing a GPXdoc into a file in GPX format. The summary and .gpxb snapshot kept beside the file
+ * are removed, they were made from what it held before.
  *@pre
     GPXdoc object exists, is valid, and and is not NULL.
     fileName is not NULL, has the correct extension
@@ -389,9 +638,24 @@ Route* JSONtoRoute(const char* gpxString);
 
 /* ******************************* List helper functions *************************** */
 
+/* Objects, names and GPXData of a document read by the parser live in its arena, next to anything made with malloc
+ * (initializeRoute(NULL), ...) and put into its lists.
+ * - deleteGPXdoc frees all of it, whichever way it was made. A document whose lists were never changed is freed
+ *   with its arena alone. The lists of a document never delete anything
+ *   themselves, so clearList and freeList on them only drop the nodes.
+ * - An object taken out of a document with deleteDataFromList belongs to the caller again: delete it with the
+ *   function below, or put it back. Do so before the document is deleted, a route added with addRoute still
+ *   points into it.
+ * - The delete functions below free only the parts of an object that are not in an arena, so they are safe on
+ *   objects of a document.
+ * - A name or GPXData the parser made must never be freed or realloced by the caller, nor passed to
+ *   deleteGpxData. A name or creator pointed at a new string stays the caller's to free, the document only
+ *   frees what is in its lists. */
+
 void deleteGpxData( void* data);
 char* gpxDataToString( void* data);
 int compareGpxData(const void *first, const void *second);
+const char* getGPXDataName(const GPXData* data);
 
 void deleteWaypoint(void* data);
 char* waypointToString( void* data);
@@ -419,4 +683,48 @@ char* findPathToJSON(char* fileName, float sourceLat, float sourceLong, float de
 bool createNewGPX(char* fileName, char* JSONString, char* gpxSchemaFile);
 bool addNewRoute(char* fileName, char* routeJSON, char* wptJSON, int numWPT);
 
+//Parse many files at once on a pool of worker threads (0 threads means one per processor), returning
+//{"numFiles":n,"fileNames":[...],"files":[...]} with the FiletoJSON string of every file that parsed
+char* filesToJSON(char** fileNames, int numFiles, int numThreads);
+char* directoryToJSON(char* dirName, int numThreads);
+
+//Find the routes and tracks of every GPX file in a directory from a source to a destination, as
+//{"numPathFiles":n,"foundPathData":[...]} with the findPathToJSON strings of every file that has any. Their end
+//points are kept between calls, and a call only reads the files added or changed since the last one.
+char* findPathsToJSON(char* dirName, float sourceLat, float sourceLong, float destLat, float destLong, float delta);
+
+//Follow a GPX file that is still being written: createGPXTail reads what is there, every followGPXTail call
+//adds what was appended since to the same document and returns the number of new points (-1 once the file
+//cannot be followed). The document belongs to the handle and is freed by deleteGPXTail.
+typedef struct GPXTail GPXTail;
+GPXTail* createGPXTail(char* fileName);
+int followGPXTail(GPXTail* tail);
+GPXdoc* getGPXTailDoc(const GPXTail* tail);
+bool isGPXTailFinished(const GPXTail* tail);
+void deleteGPXTail(GPXTail* tail);
+
+//Validate many GPX files against one schema: createGPXValidator compiles the schema once, and the validator can
+//then be used from any number of threads at once, each with libxml contexts of its own. Nothing is printed,
+//every file gets a GPXValidation with its result and the first problem libxml found.
+#define GPX_VALID 0
+#define GPX_NOT_VALID 1
+#define GPX_NOT_READ 2
+#define GPX_VALIDATION_ERROR 3
+typedef struct {
+    int result;
+    char message[256];
+} GPXValidation;
+typedef struct GPXValidator GPXValidator;
+GPXValidator* createGPXValidator(char* gpxSchemaFile);
+GPXValidation validateGPXFile(GPXValidator* validator, char* fileName);
+GPXValidation* validateGPXFiles(GPXValidator* validator, char** fileNames, int numFiles, int numThreads);
+void deleteGPXValidator(GPXValidator* validator);
+
+//Every function above can be called from many threads at once, as long as no two threads change the same
+//document. initGPXParser sets the library up and may be called any number of times (the other functions call
+//it themselves). cleanupGPXParser frees the schemas, the directories kept by findPathsToJSON and libxml
+//state kept for the whole process, once, after the last thread using the library is done.
+void initGPXParser(void);
+void cleanupGPXParser(void);
+
 #endif
\ No newline at end of file
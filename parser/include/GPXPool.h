@@ -0,0 +1,43 @@
+/**
+ * Created by: Alexander Blankenstein
+ **/
+
+#ifndef GPXPOOL_H
+#define GPXPOOL_H
+
+#include <stdbool.h>
+#include <pthread.h>
+
+/* ******************************* Worker thread pool *************************** */
+
+//One unit of work, called once for every index of a run
+typedef void (*GPXTask)(void* arg, int index);
+
+//Fixed number of worker threads that sleep until runThreadPool hands them a batch of tasks. The workers take
+//the next index as they finish the last one, so uneven tasks (a few big files among many small ones) still
+//keep every thread busy. Only one run at a time.
+typedef struct {
+    pthread_t* threads;
+    int numThreads;
+
+    pthread_mutex_t lock;
+    pthread_cond_t workReady;
+    pthread_cond_t workDone;
+
+    GPXTask task;
+    void* arg;
+    int numTasks;
+    int nextTask;
+    int tasksLeft;
+    bool stopping;
+} GPXThreadPool;
+
+int defaultThreadCount(void);
+
+GPXThreadPool* createThreadPool(int numThreads);
+
+void runThreadPool(GPXThreadPool* pool, int numTasks, GPXTask task, void* arg);
+
+void freeThreadPool(GPXThreadPool* pool);
+
+#endif
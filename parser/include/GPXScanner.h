@@ -0,0 +1,74 @@
+/**
+ * Created by: Alexander Blankenstein
+ **/
+
+#ifndef GPXSCANNER_H
+#define GPXSCANNER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "GPXParser.h"
+#include "GPXBuilder.h"
+
+/* ******************************* Fast path tokenizer *************************** */
+
+//A namespace declaration (xmlns or xmlns:prefix) made by an open element
+typedef struct {
+    const char* prefix;
+    int prefixLen;
+    const char* href;
+    int hrefLen;
+    int depth;
+} GPXNamespace;
+
+//Hand written tokenizer for plain UTF-8 GPX files. It reads straight out of a buffer (normally an mmapped file)
+//and hands names and attribute values to a GPXBuilder in place. Anything it does not handle (DTDs, other encodings,
+//malformed markup, ...) makes it stop so the caller can fall back to libxml, which then decides what the file means.
+typedef struct {
+    GPXBuilder* builder;
+
+    //Qualified names of the open elements, pointing into the buffer or into held, so end tags can be checked
+    const char** openNames;
+    int* openLens;
+    int numOpen;
+    int sizeOpen;
+
+    GPXNamespace* namespaces;
+    int numNamespaces;
+    int sizeNamespaces;
+
+    //Attributes of the start tag being read. attrScratch holds the offset of a decoded value in scratch, or -1
+    //when the value is used in place.
+    GPXAttribute* attrs;
+    int* attrScratch;
+    int sizeAttrs;
+
+    //Decoded text and attribute values that could not be passed in place
+    char* scratch;
+    int scratchLen;
+    int scratchSize;
+
+    bool seenRoot;
+
+    //Copies of the open names and namespaces made by holdScannerNames, once the buffer they were in is reused
+    char* held;
+} GPXScanner;
+
+void initializeScanner(GPXScanner* scanner, GPXBuilder* builder);
+
+void clearScanner(GPXScanner* scanner);
+
+bool scanGPXBuffer(GPXScanner* scanner, const char* buffer, size_t len);
+
+long scanGPXPrefix(GPXScanner* scanner, const char* buffer, size_t len, bool atStart);
+
+void holdScannerNames(GPXScanner* scanner);
+
+GPXdoc* scanGPXFile(char* fileName, bool keepText, bool* handled);
+
+GPXdoc* scanGzipGPXFile(char* fileName, bool keepText, bool* handled);
+
+GPXdoc* scanGPXFileParallel(char* fileName, bool keepText, int numThreads, bool* handled);
+
+#endif
@@ -37,6 +37,21 @@ typedef struct listHead{
     void (*deleteData)(void* toBeDeleted);
     int (*compare)(const void* first,const void* second);
     char* (*printData)(void* toBePrinted);
+    //Optional pool the list head and its nodes are carved out of (see initializeListInPool). Pool nodes are
+    //never freed one at a time, whoever owns the pool releases them all at once.
+    void* (*allocate)(void* pool, size_t size);
+    void* pool;
+    //Optional function that adds the nodes of a list whose length was known before its contents (see
+    //setListLoader). It is called once, the first time the nodes are needed.
+    void (*load)(struct listHead* list, void* source);
+    void* source;
+    //Number of times nodes were added, removed or reordered, so whatever is worked out from the nodes can tell
+    //whether it still matches them. It only ever goes up (and wraps around).
+    unsigned int numChanges;
+    //Optional function called with watchContext after every such change (see watchList), so something that
+    //holds many lists can tell when any of them changed
+    void (*watch)(void* context);
+    void* watchContext;
 } List;
 
 
@@ -62,6 +77,44 @@ typedef struct iter{
 **/
 List* initializeList(char* (*printFunction)(void* toBePrinted),void (*deleteFunction)(void* toBeDeleted),int (*compareFunction)(const void* first,const void* second));
 
+/** Function to initialize a list whose head and nodes are allocated from a pool instead of malloc.
+ * freeList, clearList and deleteDataFromList never free pool memory, the pool owner does that.
+ *@return pointer to the list head
+ *@param printFunction function pointer to print a single node of the list
+ *@param deleteFunction function pointer to delete a single piece of data from the list
+ *@param compareFunction function pointer to compare two nodes of the list in order to test for equality or order
+ *@param allocate function returning size bytes out of the pool
+ *@param pool the pool passed to allocate
+**/
+List* initializeListInPool(char* (*printFunction)(void* toBePrinted),void (*deleteFunction)(void* toBeDeleted),int (*compareFunction)(const void* first,const void* second),void* (*allocate)(void* pool, size_t size),void* pool);
+
+/** Function to give an empty list a length now and its nodes later. getLength reports the length straight away,
+ * anything that reads or changes the nodes first calls load, which adds them with insertBack or appendList.
+ * The length then becomes whatever load actually added. clearList and freeList drop a load that never ran.
+ * Many threads can read a list that has not been loaded yet, load runs once and the others wait for it. Changing
+ * the list is still only safe while no other thread uses it, as for any list.
+ *@pre the list is empty
+ *@param list pointer to the list
+ *@param length the number of nodes load is expected to add
+ *@param load function adding the nodes, passed the list and source
+ *@param source passed to load
+**/
+void setListLoader(List* list, int length, void (*load)(List* list, void* source), void* source);
+
+/** Function to have a function called after every change to the nodes of a list, the ones numChanges counts.
+ * Adding the nodes of a list given to setListLoader does not count as a change.
+ *@param list pointer to the list
+ *@param watch function to call, NULL to stop watching the list
+ *@param context passed to watch
+**/
+void watchList(List* list, void (*watch)(void* context), void* context);
+
+/** Function that tells whether the nodes of a list given to setListLoader have been added yet. Does not load them.
+ *@return true if the nodes are in place, or the list never had a loader
+ *@param list pointer to the list
+**/
+bool isListLoaded(const List* list);
+
 
 
 /**Function for creating a node for the linked list. 
@@ -95,6 +148,13 @@ void insertFront(List* list, void* toBeAdded);
 **/
 void insertBack(List* list, void* toBeAdded);
 
+/**Moves every node of other to the back of list, other is left empty. Nothing is copied or allocated.
+*@pre Both lists allocate their nodes the same way, with malloc or from pools that are freed together
+*@param list pointer to the List struct that grows
+*@param other pointer to the List struct that is emptied
+**/
+void appendList(List* list, List* other);
+
 
 
 /** Deletes the entire linked list, freeing all memory asssociated with the list, including the list struct itself.
@@ -126,6 +186,15 @@ void clearList(List* list);
 void insertSorted(List* list, void* toBeAdded);
 
 
+/** Sorts the list in place with its compare function in O(n log n) time, without allocating.
+* Elements that compare equal keep their order.
+*@pre List exists and is valid
+*@post The nodes are in order, head and tail are updated
+*@param list - a pointer to the List struct
+**/
+void sortList(List* list);
+
+
 
 /** Removes data from from the list, deletes the node and frees the memory,
  * changes pointer values of surrounding nodes to maintain list structure.
@@ -0,0 +1,145 @@
+/**
+ * @file SkipListAPI.h
+ * @brief File containing the function definitions of a list that is always kept sorted
+ */
+
+#ifndef _SKIP_LIST_API_
+#define _SKIP_LIST_API_
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#include "LinkedListAPI.h"
+
+//Most levels a skip list node can have, enough for far more elements than fit in memory
+#define SKIP_LIST_MAX_LEVEL 32
+
+/**
+ * Node of a skip list. The bottom level is a Node of a normal doubly linked list, so the elements can be walked
+ * in order with createSkipListIterator and nextElement. Each higher level skips over about three quarters of
+ * the nodes of the level below.
+ **/
+typedef struct skipListNode{
+    Node node;
+    int height;
+    struct skipListNode* forward[];
+} SkipListNode;
+
+/**
+ * Metadata head of the skip list.
+ * Finding where an element goes takes O(log n) comparisons on average, instead of the walk insertSorted does.
+ * The function pointers are the same as the ones of a List.
+ **/
+typedef struct skipListHead{
+    //Node before the first element, with every level. Its node.next is the first element.
+    SkipListNode* head;
+    Node* tail;
+    int length;
+    //Number of levels in use
+    int level;
+    //State of the generator that picks the height of new nodes, each list has its own
+    unsigned int seed;
+    void (*deleteData)(void* toBeDeleted);
+    int (*compare)(const void* first,const void* second);
+    char* (*printData)(void* toBePrinted);
+} SkipList;
+
+
+/** Function to initialize an empty skip list with the appropriate function pointers.
+*@pre function pointer arguments must not be NULL
+*@post SkipList structure has been allocated and initialized
+*@return the newly allocated SkipList struct
+*@param printFunction - function pointer to print a single element of the list
+*@param deleteFunction - function pointer to delete a single piece of data from the list
+*@param compareFunction - function pointer to compare two elements of the list in order to place them
+**/
+SkipList* initializeSkipList(char* (*printFunction)(void* toBePrinted),void (*deleteFunction)(void* toBeDeleted),int (*compareFunction)(const void* first,const void* second));
+
+
+/** Uses the comparison function pointer to place the element in order, in O(log n) time on average.
+* An element that compares equal to others is placed after them, so they stay in the order they were added.
+*@pre the list exists
+*@param list - pointer to the SkipList struct
+*@param toBeAdded - a pointer to data that is to be added to the list
+**/
+void insertSkipList(SkipList* list, void* toBeAdded);
+
+
+/** Returns the first element of the skip list that compares equal to searchRecord with the list's compare function
+*@pre the list exists, searchRecord is the same kind of data as the elements
+*@return the data, or NULL if no element compares equal
+*@param list - pointer to the SkipList struct
+*@param searchRecord - a pointer to the data to look for
+**/
+void* findInSkipList(SkipList* list, const void* searchRecord);
+
+
+/** Removes data from the skip list and frees its node, the data itself is returned and not freed
+*@pre the list exists
+*@return on success: the data, on failure (data is not in the list): NULL
+*@param list - pointer to the SkipList struct
+*@param toBeDeleted - a pointer to the data to remove, compared by address
+**/
+void* deleteDataFromSkipList(SkipList* list, void* toBeDeleted);
+
+
+/** Returns the smallest element of the skip list. Does not alter the list.
+*@pre the list exists
+*@return the data, or NULL if the list is empty
+*@param list - pointer to the SkipList struct
+**/
+void* getFromSkipListFront(SkipList* list);
+
+
+/** Returns the largest element of the skip list. Does not alter the list.
+*@pre the list exists
+*@return the data, or NULL if the list is empty
+*@param list - pointer to the SkipList struct
+**/
+void* getFromSkipListBack(SkipList* list);
+
+
+/** Returns the number of elements in the skip list.
+*@pre the list exists
+*@return the number of elements (0 or more)
+*@param list - pointer to the SkipList struct
+**/
+int getSkipListLength(SkipList* list);
+
+
+/** Frees the data of every element with the list's delete function and every node, keeping the SkipList struct
+*@pre the list exists
+*@post the list length is 0
+*@param list - pointer to the SkipList struct
+**/
+void clearSkipList(SkipList* list);
+
+
+/** Deletes the entire skip list, the data of every element, the nodes and the SkipList struct itself
+*@pre the list exists
+*@param list - pointer to the SkipList struct
+**/
+void freeSkipList(SkipList* list);
+
+
+/** Returns a string representation of the skip list in order, made with the list's printData function.
+ * The returned string must be freed by the calling function.
+*@pre the list exists, but does not have to have elements
+*@return the string
+*@param list - pointer to the SkipList struct
+**/
+char* skipListToString(SkipList* list);
+
+
+/** Function for creating an iterator over the skip list in order, used with nextElement like the iterator of a List.
+ * Adding or removing elements ends the use of any iterator over it.
+*@pre the list exists
+*@return the iterator, pointing at the smallest element
+*@param list - pointer to the SkipList struct to iterate over
+**/
+ListIterator createSkipListIterator(SkipList* list);
+
+#endif
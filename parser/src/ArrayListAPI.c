@@ -0,0 +1,251 @@
+/**
+ * Created by: Alexander Blankenstein
+ **/
+
+#include "ArrayListAPI.h"
+
+//Elements the array holds after the first insert
+#define FIRST_CAPACITY 8
+
+/** Function to initialize an empty array list. Nothing but the ArrayList struct is allocated until the first insert.
+*@return pointer to the list head
+*@param printFunction function pointer to print a single element of the list
+*@param deleteFunction function pointer to delete a single piece of data from the list
+*@param compareFunction function pointer to compare two elements of the list in order to test for equality or order
+**/
+ArrayList* initializeArrayList(char* (*printFunction)(void* toBePrinted),void (*deleteFunction)(void* toBeDeleted),int (*compareFunction)(const void* first,const void* second)){
+    assert(printFunction != NULL);
+    assert(deleteFunction != NULL);
+    assert(compareFunction != NULL);
+
+    ArrayList* tmpList = malloc(sizeof(ArrayList));
+
+    tmpList->elements = NULL;
+    tmpList->length = 0;
+    tmpList->capacity = 0;
+
+    tmpList->deleteData = deleteFunction;
+    tmpList->compare = compareFunction;
+    tmpList->printData = printFunction;
+
+    return tmpList;
+}
+
+/** Function to grow the array to hold at least capacity elements, doubling it so a run of inserts costs amortized constant time
+*@param list pointer to the array list
+*@param capacity the number of elements needed
+**/
+void reserveArrayList(ArrayList* list, int capacity){
+    if (list == NULL || capacity <= list->capacity){
+        return;
+    }
+
+    int newCapacity = list->capacity > 0 ? list->capacity : FIRST_CAPACITY;
+    while (newCapacity < capacity){
+        newCapacity = newCapacity * 2;
+    }
+
+    list->elements = realloc(list->elements, sizeof(void*) * newCapacity);
+    list->capacity = newCapacity;
+}
+
+/** Inserts an element at the back of the array list
+*@param list pointer to the array list
+*@param toBeAdded a pointer to data that is to be added to the list
+**/
+void insertArrayBack(ArrayList* list, void* toBeAdded){
+    if (list == NULL || toBeAdded == NULL){
+        return;
+    }
+
+    if (list->length == list->capacity){
+        reserveArrayList(list, list->length + 1);
+    }
+    list->elements[list->length] = toBeAdded;
+    list->length++;
+}
+
+/** Inserts a run of elements at the back of the array list with a single copy
+*@param list pointer to the array list
+*@param elements the data to add
+*@param numElements the number of elements to add
+**/
+void insertArrayElements(ArrayList* list, void** elements, int numElements){
+    if (list == NULL || elements == NULL || numElements <= 0){
+        return;
+    }
+
+    reserveArrayList(list, list->length + numElements);
+    memcpy(list->elements + list->length, elements, sizeof(void*) * numElements);
+    list->length = list->length + numElements;
+}
+
+/** Inserts every element of a linked list at the back of the array list, sizing the array once from the list's length
+*@param list pointer to the array list
+*@param other pointer to the linked list
+**/
+void insertListElements(ArrayList* list, List* other){
+    if (list == NULL || other == NULL){
+        return;
+    }
+
+    ListIterator iter = createIterator(other);
+    reserveArrayList(list, list->length + getLength(other));
+
+    void* elem;
+    while ((elem = nextElement(&iter)) != NULL){
+        insertArrayBack(list, elem);
+    }
+}
+
+/** Returns the element at an index of the array list
+*@return the data at index, or NULL if index is out of range
+*@param list pointer to the array list
+*@param index the index, 0 is the front
+**/
+void* getFromArray(ArrayList* list, int index){
+    if (list == NULL || index < 0 || index >= list->length){
+        return NULL;
+    }
+    return list->elements[index];
+}
+
+/** Returns the number of elements in the array list
+*@return the length
+*@param list pointer to the array list
+**/
+int getArrayLength(ArrayList* list){
+    if (list == NULL){
+        return 0;
+    }
+    return list->length;
+}
+
+/** Function to merge sort a run of elements, using scratch as room for the merge
+**/
+static void mergeSort(void** elements, void** scratch, int length, int (*compare)(const void* first,const void* second)){
+    if (length < 2){
+        return;
+    }
+
+    int middle = length / 2;
+    mergeSort(elements, scratch, middle, compare);
+    mergeSort(elements + middle, scratch, length - middle, compare);
+
+    //Already in order, nothing to merge
+    if (compare(elements[middle - 1], elements[middle]) <= 0){
+        return;
+    }
+
+    memcpy(scratch, elements, sizeof(void*) * middle);
+    int left = 0;
+    int right = middle;
+    int out = 0;
+    while (left < middle && right < length){
+        //Taking from the left on ties keeps equal elements in order
+        if (compare(scratch[left], elements[right]) <= 0){
+            elements[out++] = scratch[left++];
+        }else{
+            elements[out++] = elements[right++];
+        }
+    }
+    while (left < middle){
+        elements[out++] = scratch[left++];
+    }
+}
+
+/** Sorts the array list with its compare function, keeping elements that compare equal in order
+*@param list pointer to the array list
+**/
+void sortArrayList(ArrayList* list){
+    if (list == NULL || list->length < 2){
+        return;
+    }
+
+    void** scratch = malloc(sizeof(void*) * (list->length / 2));
+    mergeSort(list->elements, scratch, list->length, list->compare);
+    free(scratch);
+}
+
+/** Frees the data of every element and empties the list, the array is kept for the next inserts
+*@param list pointer to the array list
+**/
+void clearArrayList(ArrayList* list){
+    if (list == NULL){
+        return;
+    }
+
+    for (int i = 0; i < list->length; i++){
+        list->deleteData(list->elements[i]);
+    }
+    list->length = 0;
+}
+
+/** Frees the data of every element, the array and the list struct
+*@param list pointer to the array list
+**/
+void freeArrayList(ArrayList* list){
+    if (list == NULL){
+        return;
+    }
+
+    clearArrayList(list);
+    free(list->elements);
+    free(list);
+}
+
+/** Returns a string representation of the array list, made the same way toString makes one of a List
+*@return the string, to be freed by the caller
+*@param list pointer to the array list
+**/
+char* arrayListToString(ArrayList* list){
+    char* str = malloc(sizeof(char));
+    strcpy(str, "");
+
+    if (list == NULL){
+        return str;
+    }
+
+    int len = 0;
+    for (int i = 0; i < list->length; i++){
+        char* currDescr = list->printData(list->elements[i]);
+        int descrLen = strlen(currDescr);
+        str = realloc(str, sizeof(char) * (len + descrLen + 2));
+        str[len] = '\n';
+        memcpy(str + len + 1, currDescr, descrLen + 1);
+        len = len + descrLen + 1;
+        free(currDescr);
+    }
+
+    return str;
+}
+
+/** Function for creating an iterator over the array list, it walks the array instead of nodes
+*@return the iterator
+*@param list pointer to the array list
+**/
+ArrayIterator createArrayIterator(ArrayList* list){
+    ArrayIterator iter;
+
+    iter.element = NULL;
+    iter.end = NULL;
+
+    if (list != NULL && list->length > 0){
+        iter.element = list->elements;
+        iter.end = list->elements + list->length;
+    }
+
+    return iter;
+}
+
+/** Function that returns the next element of the array list through the iterator
+*@return the element, or NULL at the end of the list
+*@param iter pointer to the iterator
+**/
+void* nextArrayElement(ArrayIterator* iter){
+    if (iter->element != iter->end){
+        return *(iter->element++);
+    }else{
+        return NULL;
+    }
+}
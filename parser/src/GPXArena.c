@@ -0,0 +1,325 @@
+/**
+ * Created by: Alexander Blankenstein
+ **/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "GPXArena.h"
+
+//Blocks start small so tiny files stay tiny, and double up to a cap so big files need few of them
+#define FIRST_BLOCK_SIZE (16 * 1024)
+#define MAX_BLOCK_SIZE (4 * 1024 * 1024)
+#define ARENA_ALIGN 8
+
+struct GPXArenaBlock {
+    GPXArenaBlock* next;
+    size_t size;
+    size_t used;
+    char* data;
+};
+
+/** Function to create an empty arena
+ *@return the new arena
+ **/
+GPXArena* createArena(void) {
+	GPXArena* arena = malloc(sizeof(GPXArena));
+	memset(arena, 0, sizeof(GPXArena));
+	return arena;
+}
+
+/** Function to delete the objects the arena adopted and free every block, and the arena itself
+ *@param Ptr- the arena, can be NULL
+ **/
+void freeArena(GPXArena* arena) {
+	if (arena == NULL) {
+		return;
+	}
+
+	for (int i = 0; i < arena->numAdopted; i++) {
+		arena->adopted[i].deleteData(arena->adopted[i].data);
+	}
+	free(arena->adopted);
+
+	GPXArenaBlock* block = arena->blocks;
+	while (block != NULL) {
+		GPXArenaBlock* next = block->next;
+		free(block);
+		block = next;
+	}
+	free(arena->sorted);
+	free(arena);
+}
+
+/** Function to follow merges to the arena that owns the memory
+ **/
+static GPXArena* rootArena(GPXArena* arena) {
+	while (arena->parent != NULL) {
+		arena = arena->parent;
+	}
+	return arena;
+}
+
+/** Function to find the position of the last block that starts at or before ptr in the blocks ordered by address
+ *@return the position, -1 if every block starts after ptr
+ **/
+static int findBlock(const GPXArena* arena, uintptr_t address) {
+	int low = 0;
+	int high = arena->numBlocks;
+	while (low < high) {
+		int mid = (low + high) / 2;
+		if ((uintptr_t)arena->sorted[mid]->data <= address) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+	return low - 1;
+}
+
+/** Function to put a block in its place among the blocks ordered by address
+ **/
+static void addSorted(GPXArena* arena, GPXArenaBlock* block) {
+	if (arena->numBlocks == arena->sizeBlocks) {
+		arena->sizeBlocks = arena->sizeBlocks == 0 ? 16 : arena->sizeBlocks * 2;
+		arena->sorted = realloc(arena->sorted, sizeof(GPXArenaBlock*) * arena->sizeBlocks);
+	}
+	int pos = findBlock(arena, (uintptr_t)block->data) + 1;
+	memmove(arena->sorted + pos + 1, arena->sorted + pos, sizeof(GPXArenaBlock*) * (arena->numBlocks - pos));
+	arena->sorted[pos] = block;
+	arena->numBlocks++;
+}
+
+/** Function to add a block with room for at least size bytes
+ **/
+static GPXArenaBlock* addBlock(GPXArena* arena, size_t size) {
+	size_t blockSize = FIRST_BLOCK_SIZE;
+	if (arena->blocks != NULL) {
+		blockSize = arena->blocks->size * 2;
+		if (blockSize > MAX_BLOCK_SIZE) {
+			blockSize = MAX_BLOCK_SIZE;
+		}
+	}
+	if (blockSize < size) {
+		blockSize = size;
+	}
+
+	//The header and the data share one allocation
+	GPXArenaBlock* block = malloc(sizeof(GPXArenaBlock) + blockSize);
+	block->data = (char*)(block + 1);
+	block->size = blockSize;
+	block->used = 0;
+	block->next = arena->blocks;
+	arena->blocks = block;
+	addSorted(arena, block);
+	return block;
+}
+
+/** Function to take size bytes out of the arena with the given alignment
+ **/
+static void* take(GPXArena* arena, size_t size, size_t align) {
+	arena = rootArena(arena);
+	GPXArenaBlock* block = arena->blocks;
+	size_t start = 0;
+
+	if (block != NULL) {
+		start = (block->used + align - 1) & ~(align - 1);
+	}
+	if (block == NULL || start + size > block->size) {
+		block = addBlock(arena, size);
+		start = 0;
+	}
+
+	block->used = start + size;
+	arena->allocations++;
+	arena->bytes = arena->bytes + size;
+	return block->data + start;
+}
+
+/** Function to allocate memory that lives as long as the arena
+ *@return the memory, or memory from malloc when arena is NULL
+ *@param Ptr- the arena, NULL for plain malloc
+ *@param int- the number of bytes
+ **/
+void* arenaAlloc(GPXArena* arena, size_t size) {
+	if (arena == NULL) {
+		return malloc(size);
+	}
+	return take(arena, size, ARENA_ALIGN);
+}
+
+/** Function matching the List pool signature, so lists can take their nodes from an arena
+ *@return the memory
+ *@param Ptr- the arena
+ *@param int- the number of bytes
+ **/
+void* arenaPoolAlloc(void* arena, size_t size) {
+	return take((GPXArena*)arena, size, ARENA_ALIGN);
+}
+
+/** Function to copy a string into the arena
+ *@return the NUL terminated copy, from malloc when arena is NULL
+ *@param Ptr- the arena, NULL for plain malloc
+ *@param str- the string, does not need to be NUL terminated
+ *@param int- the length of the string
+ **/
+char* arenaString(GPXArena* arena, const char* str, int len) {
+	char* copy;
+	if (arena == NULL) {
+		copy = malloc(sizeof(char) * (len + 1));
+	}
+	else {
+		copy = take(arena, len + 1, 1);
+	}
+	memcpy(copy, str, len);
+	copy[len] = '\0';
+	return copy;
+}
+
+/** Function to check if memory was handed out by the arena
+ *@return true if ptr lies inside one of the arena's blocks
+ **/
+bool arenaOwns(const GPXArena* arena, const void* ptr) {
+	if (arena == NULL) {
+		return false;
+	}
+	arena = rootArena((GPXArena*)arena);
+
+	uintptr_t address = (uintptr_t)ptr;
+	int pos = findBlock(arena, address);
+	return pos >= 0 && address < (uintptr_t)arena->sorted[pos]->data + arena->sorted[pos]->size;
+}
+
+/** Function to hand an object that was not allocated from the arena over to it, it is deleted with the arena
+ *@param Ptr- the arena
+ *@param Ptr- the object
+ *@param Ptr- the function that deletes the object
+ **/
+void arenaAdopt(GPXArena* arena, void* data, void (*deleteData)(void* toBeDeleted)) {
+	arena = rootArena(arena);
+	if (arena->numAdopted == arena->sizeAdopted) {
+		arena->sizeAdopted = arena->sizeAdopted == 0 ? 8 : arena->sizeAdopted * 2;
+		arena->adopted = realloc(arena->adopted, sizeof(GPXAdopted) * arena->sizeAdopted);
+	}
+	arena->adopted[arena->numAdopted].data = data;
+	arena->adopted[arena->numAdopted].deleteData = deleteData;
+	arena->numAdopted++;
+}
+
+/** Function to move everything another arena holds into this one. The other arena keeps working, whatever is
+ *  allocated from it afterwards comes from this one, and it is freed with this one. Used to join documents that
+ *  were built separately, after which their lists can be spliced together.
+ *@param Ptr- the arena that takes over
+ *@param Ptr- the arena that is emptied, must not be used with freeArena afterwards
+ **/
+void arenaMerge(GPXArena* arena, GPXArena* other) {
+	arena = rootArena(arena);
+	if (other == NULL || other == arena || other->parent != NULL) {
+		return;
+	}
+
+	//The current block stays in front, so allocation carries on where it was
+	if (other->blocks != NULL) {
+		GPXArenaBlock* last = other->blocks;
+		while (last->next != NULL) {
+			last = last->next;
+		}
+		if (arena->blocks == NULL) {
+			arena->blocks = other->blocks;
+		}
+		else {
+			last->next = arena->blocks->next;
+			arena->blocks->next = other->blocks;
+		}
+		other->blocks = NULL;
+	}
+	for (int i = 0; i < other->numBlocks; i++) {
+		addSorted(arena, other->sorted[i]);
+	}
+	free(other->sorted);
+	other->sorted = NULL;
+	other->numBlocks = 0;
+	other->sizeBlocks = 0;
+
+	for (int i = 0; i < other->numAdopted; i++) {
+		arenaAdopt(arena, other->adopted[i].data, other->adopted[i].deleteData);
+	}
+	free(other->adopted);
+	other->adopted = NULL;
+	other->numAdopted = 0;
+	other->sizeAdopted = 0;
+
+	arena->allocations = arena->allocations + other->allocations;
+	arena->bytes = arena->bytes + other->bytes;
+	other->parent = arena;
+	arenaAdopt(arena, other, free);
+}
+
+/** Function to count a change to one of the lists of the arena's document. Matches the watch signature of a
+ *  List, the arena lists of a document are all watched with it.
+ *@param Ptr- the arena
+ **/
+void arenaChanged(void* arena) {
+	GPXArena* root = rootArena((GPXArena*)arena);
+	//Only the thread changing the document counts, but a lazy list that turns out shorter than its file said is
+	//counted by whichever thread reads it first
+	__atomic_store_n(&root->numChanges, __atomic_load_n(&root->numChanges, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+}
+
+/** Function that returns the number of changes made to the lists of the arena's document so far, anything kept
+ *  about the whole document is still right while this stays the same
+ *@return the number of changes
+ *@param Ptr- the arena
+ **/
+unsigned int arenaChanges(const GPXArena* arena) {
+	return __atomic_load_n(&rootArena((GPXArena*)arena)->numChanges, __ATOMIC_RELAXED);
+}
+
+/** Function to record that the parser finished building the arena's document. The changes the parser made are
+ *  left out of the ones arenaUntouched looks at, as long as the document was untouched when it started.
+ *@param Ptr- the arena
+ *@param int- the number of changes when the parser started, from arenaChanges
+ **/
+void arenaBuilt(GPXArena* arena, unsigned int startChanges) {
+	GPXArena* root = rootArena(arena);
+	if (root->builtChanges == startChanges) {
+		root->builtChanges = arenaChanges(root);
+	}
+}
+
+/** Function that tells whether the lists of the arena's document are still the ones the parser built, so
+ *  everything in it is memory of the arena
+ *@return true if no list was changed since
+ *@param Ptr- the arena
+ **/
+bool arenaUntouched(const GPXArena* arena) {
+	const GPXArena* root = rootArena((GPXArena*)arena);
+	return arenaChanges(root) == root->builtChanges;
+}
+
+/** Function to count the system allocations backing the arena
+ *@return the number of blocks
+ **/
+long arenaBlockCount(const GPXArena* arena) {
+	arena = rootArena((GPXArena*)arena);
+	long count = 0;
+	for (GPXArenaBlock* block = arena->blocks; block != NULL; block = block->next) {
+		count++;
+	}
+	return count;
+}
+
+/** Function to count the bytes the arena took from the system
+ *@return the total size of the blocks
+ **/
+long arenaReserved(const GPXArena* arena) {
+	arena = rootArena((GPXArena*)arena);
+	long total = 0;
+	for (GPXArenaBlock* block = arena->blocks; block != NULL; block = block->next) {
+		total = total + block->size + sizeof(GPXArenaBlock);
+	}
+	return total;
+}
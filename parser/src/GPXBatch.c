@@ -0,0 +1,170 @@
+/**
+ * Created by: Alexander Blankenstein
+ **/
+
+#define _DEFAULT_SOURCE
+
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <dirent.h>
+#include <libxml/parser.h>
+
+#include "GPXParser.h"
+#include "GPXHelper.h"
+#include "GPXPool.h"
+#include "ArrayListAPI.h"
+
+//The files of one batch, filled in by the workers
+typedef struct {
+    char** paths;
+    char** results;
+} GPXBatch;
+
+/** Function to parse one file of a batch into its JSON summary, run on a worker thread
+ **/
+static void summarizeFile(void* arg, int index) {
+	GPXBatch* batch = (GPXBatch*)arg;
+	batch->results[index] = readGPXSummary(batch->paths[index]);
+}
+
+/** Function to parse a batch of files on a thread pool and collect their summaries
+ *@return the JSON, {"numFiles":n,"fileNames":[...],"files":[...]} where every file is the GPXtoJSON string
+ **/
+static char* batchToJSON(char** paths, char** names, int numFiles, int numThreads) {
+	GPXBatch batch;
+	batch.paths = paths;
+	batch.results = calloc(numFiles > 0 ? numFiles : 1, sizeof(char*));
+
+	//libxml sets up its globals on first use, which is not safe to race
+	initGPXParser();
+
+	GPXThreadPool* pool = NULL;
+	if (numFiles > 1) {
+		pool = createThreadPool(numThreads < numFiles ? numThreads : numFiles);
+	}
+	if (pool != NULL) {
+		runThreadPool(pool, numFiles, summarizeFile, &batch);
+		freeThreadPool(pool);
+	}
+	else {
+		for (int i = 0; i < numFiles; i++) {
+			summarizeFile(&batch, i);
+		}
+	}
+
+	//Files that could not be parsed are left out, the same as the file log did one file at a time
+	int numParsed = 0;
+	for (int i = 0; i < numFiles; i++) {
+		if (batch.results[i] != NULL) {
+			numParsed++;
+		}
+	}
+
+	int size = 256;
+	int len = 0;
+	char* json = malloc(sizeof(char) * size);
+	char numStr[64];
+	json[0] = '\0';
+
+	sprintf(numStr, "{\"numFiles\":%d,\"fileNames\":[", numParsed);
+	appendText(&json, &len, &size, numStr);
+	bool notFirst = false;
+	for (int i = 0; i < numFiles; i++) {
+		if (batch.results[i] != NULL) {
+			if (notFirst) {
+				appendText(&json, &len, &size, ",");
+			}
+			appendJSONString(&json, &len, &size, names[i]);
+			notFirst = true;
+		}
+	}
+
+	appendText(&json, &len, &size, "],\"files\":[");
+	notFirst = false;
+	for (int i = 0; i < numFiles; i++) {
+		if (batch.results[i] != NULL) {
+			if (notFirst) {
+				appendText(&json, &len, &size, ",");
+			}
+			appendJSONString(&json, &len, &size, batch.results[i]);
+			free(batch.results[i]);
+			notFirst = true;
+		}
+	}
+	appendText(&json, &len, &size, "]}");
+
+	free(batch.results);
+	return json;
+}
+
+/** Function to parse a list of GPX files on a pool of worker threads
+ *@pre fileNames holds numFiles strings
+ *@return A JSON string {"numFiles":n,"fileNames":[...],"files":[...]}, with the summary of every file that
+ *        could be parsed as a GPXtoJSON string, in the order they were given
+ *@param Ptr- the names of the files
+ *@param int- the number of files
+ *@param int- the number of threads, 0 or less for one per processor
+ **/
+char* filesToJSON(char** fileNames, int numFiles, int numThreads) {
+	return batchToJSON(fileNames, fileNames, numFiles, numThreads);
+}
+
+/** Function to compare two file names for sortArrayList
+ **/
+static int compareNames(const void* first, const void* second) {
+	return strcmp((const char*)first, (const char*)second);
+}
+
+/** Function to print a file name for arrayListToString
+ *@return a copy of the name
+ **/
+static char* printName(void* name) {
+	char* str = malloc(sizeof(char) * (strlen((char*)name) + 1));
+	strcpy(str, (char*)name);
+	return str;
+}
+
+/** Function to parse every .gpx file in a directory on a pool of worker threads
+ *@pre dirName is not NULL
+ *@return A JSON string like filesToJSON, with the file names relative to the directory and sorted.
+ *        A directory that cannot be opened gives no files.
+ *@param str- the directory
+ *@param int- the number of threads, 0 or less for one per processor
+ **/
+char* directoryToJSON(char* dirName, int numThreads) {
+	ArrayList* names = initializeArrayList(printName, free, compareNames);
+
+	DIR* dir = opendir(dirName);
+	if (dir != NULL) {
+		struct dirent* entry;
+		while ((entry = readdir(dir)) != NULL) {
+			if (gpxFileKind(entry->d_name) == GPX_FILE_NONE) {
+				continue;
+			}
+			char* name = malloc(sizeof(char) * (strlen(entry->d_name) + 1));
+			strcpy(name, entry->d_name);
+			insertArrayBack(names, name);
+		}
+		closedir(dir);
+	}
+	sortArrayList(names);
+
+	int numFiles = getArrayLength(names);
+	ArrayList* paths = initializeArrayList(printName, free, compareNames);
+	reserveArrayList(paths, numFiles);
+	ArrayIterator iter = createArrayIterator(names);
+	char* name;
+	while ((name = nextArrayElement(&iter)) != NULL) {
+		char* path = malloc(sizeof(char) * (strlen(dirName) + strlen(name) + 2));
+		sprintf(path, "%s/%s", dirName, name);
+		insertArrayBack(paths, path);
+	}
+
+	char* json = batchToJSON((char**)paths->elements, (char**)names->elements, numFiles, numThreads);
+
+	freeArrayList(paths);
+	freeArrayList(names);
+	return json;
+}
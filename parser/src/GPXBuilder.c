@@ -0,0 +1,600 @@
+/**
+ * Created by: Alexander Blankenstein
+ **/
+
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <libxml/parser.h>
+#include <libxml/tree.h>
+#include <libxml/xmlreader.h>
+#include <math.h>
+
+#include "GPXBuilder.h"
+#include "GPXNumber.h"
+#include "GPXArena.h"
+#include "GPXColumns.h"
+#include "GPXHelper.h"
+#include "GPXNames.h"
+#include "GPXParser.h"
+
+/** Function to compare a length delimited name against a NUL terminated one
+ *@return true if both names are the same
+ **/
+static bool nameIs(const char* name, int nameLen, const char* wanted) {
+	return (int)strlen(wanted) == nameLen && memcmp(name, wanted, nameLen) == 0;
+}
+
+/** Function to read a number out of a length delimited attribute value
+ *@return the value, or 0.0 if it does not start with a number
+ **/
+static double valueToDouble(const char* value, int valueLen) {
+	return parseGPXNumber(value, valueLen, NULL);
+}
+
+/** Function to set up a builder that fills an existing document
+ *@param Ptr- the builder to set up
+ *@param Obj- the GPX document object to store data into
+ **/
+void initializeBuilder(GPXBuilder* builder, GPXdoc* doc) {
+	memset(builder, 0, sizeof(GPXBuilder));
+	builder->doc = doc;
+	builder->keepText = true;
+	if (doc != NULL && doc->arena != NULL) {
+		builder->startChanges = arenaChanges(doc->arena);
+	}
+}
+
+/** Function to free the memory held by a builder. The counts of the document it filled were carried on with
+ *  every element, so they are marked as matching it, and what it added is marked as built by the parser.
+ *@param Ptr- the builder
+ **/
+void clearBuilder(GPXBuilder* builder) {
+	if (builder->doc != NULL) {
+		markCountsCurrent(builder->doc->counts);
+		if (builder->doc->arena != NULL) {
+			arenaBuilt(builder->doc->arena, builder->startChanges);
+		}
+	}
+	free(builder->text);
+	builder->text = NULL;
+	builder->textLen = 0;
+	builder->textSize = 0;
+}
+
+/** Function to start collecting the text of a child element
+ **/
+static void startData(GPXBuilder* builder, const char* dataName) {
+	builder->dataName = dataName;
+	builder->dataDepth = builder->depth;
+	builder->textLen = 0;
+}
+
+/** Function to read the lat and lon attributes of a point, the first of each counts
+ **/
+static void readLatLon(const GPXAttribute* attrs, int numAttrs, double* lat, double* lon) {
+	bool hasLat = false;
+	bool hasLon = false;
+
+	for (int i = 0; i < numAttrs; i++) {
+		if (!hasLat && nameIs(attrs[i].name, attrs[i].nameLen, "lat")) {
+			*lat = valueToDouble(attrs[i].value, attrs[i].valueLen);
+			hasLat = true;
+		}
+		else if (!hasLon && nameIs(attrs[i].name, attrs[i].nameLen, "lon")) {
+			*lon = valueToDouble(attrs[i].value, attrs[i].valueLen);
+			hasLon = true;
+		}
+	}
+}
+
+/** Function to start a new waypoint, reading its lat and lon attributes
+ **/
+static void startWaypoint(GPXBuilder* builder, const GPXAttribute* attrs, int numAttrs) {
+	Waypoint* waypoint = initializeWaypoint(builder->doc->arena);
+	readLatLon(attrs, numAttrs, &waypoint->latitude, &waypoint->longitude);
+
+	builder->waypoint = waypoint;
+	builder->waypointDepth = builder->depth;
+}
+
+/** Function to count a point of the open part of a lazy document into the totals, without building it
+ **/
+static void countPoint(GPXBuilder* builder, const GPXAttribute* attrs, int numAttrs, GPXTotals* totals) {
+	double lat = 0.0;
+	double lon = 0.0;
+
+	readLatLon(attrs, numAttrs, &lat, &lon);
+	appendTotalsPoint(totals, lat, lon);
+	builder->partPoints++;
+	builder->numPoints++;
+}
+
+/** Function to note where a route or track segment of a lazy document starts, its totals count from here on
+ **/
+static void startPart(GPXBuilder* builder, GPXTotals* totals, PointColumns** columns) {
+	GPXLazyPart* part = initializeLazyPart(builder->doc->arena, builder->lazy);
+	part->outerStart = builder->outerStart;
+	part->outerLen = builder->outerLen;
+	part->start = builder->tagStart - builder->base;
+	part->columns = columns;
+
+	if (totals != NULL && totals->numPoints < 0) {
+		memset(totals, 0, sizeof(GPXTotals));
+	}
+	builder->part = part;
+	builder->partPoints = 0;
+}
+
+/** Function to note where the open part of a lazy document ends, giving its list a length and a loader
+ **/
+static void endPart(GPXBuilder* builder, List* waypoints) {
+	builder->part->end = builder->tagEnd - builder->base;
+	if (builder->partPoints > 0) {
+		setListLoader(waypoints, builder->partPoints, &loadLazyPart, builder->part);
+	}
+	builder->part = NULL;
+	builder->partPoints = 0;
+}
+
+/** Function to read the namespace, version and creator off the gpx element
+ **/
+static void startGPX(GPXBuilder* builder, const char* nsHref, const GPXAttribute* attrs, int numAttrs) {
+	GPXdoc* tmpDoc = builder->doc;
+
+	if (nsHref != NULL) {
+		strncpy(tmpDoc->namespace, nsHref, sizeof(tmpDoc->namespace) - 1);
+	}
+
+	for (int i = 0; i < numAttrs; i++) {
+		if (nameIs(attrs[i].name, attrs[i].nameLen, "version")) {
+			tmpDoc->version = valueToDouble(attrs[i].value, attrs[i].valueLen);
+		}
+		else if (nameIs(attrs[i].name, attrs[i].nameLen, "creator")) {
+			if (tmpDoc->arena == NULL) {
+				free(tmpDoc->creator);
+			}
+			tmpDoc->creator = arenaString(tmpDoc->arena, attrs[i].value, attrs[i].valueLen);
+		}
+	}
+}
+
+/** Function to handle the start of an element
+ *@param Ptr- the builder
+ *@param str- the local name of the element, not NUL terminated
+ *@param int- the length of the name
+ *@param str- the namespace of the element, NULL if it has none. Only read for the gpx element.
+ *@param Ptr- the attributes of the element
+ *@param int- the number of attributes
+ **/
+void builderStartElement(GPXBuilder* builder, const char* name, int nameLen, const char* nsHref, const GPXAttribute* attrs, int numAttrs) {
+	builder->depth = builder->depth + 1;
+	int depth = builder->depth;
+
+	//Nested inside an element whose text is being collected, only its direct text counts
+	if (builder->dataDepth != 0) {
+		return;
+	}
+
+	/* =========================================================   GPX / WPT / RTE / TRK   =========================================================== */
+
+	if (builder->objectDepth == 0) {
+		if (builder->lazy != NULL && depth == 1) {
+			builder->lazy->rootStart = builder->tagStart - builder->base;
+			builder->lazy->rootLen = builder->tagEnd - builder->tagStart;
+		}
+
+		if (nameIs(name, nameLen, "gpx")) {
+			startGPX(builder, nsHref, attrs, numAttrs);
+		}
+		else if (nameIs(name, nameLen, "wpt")) {
+			builder->objectDepth = depth;
+			startWaypoint(builder, attrs, numAttrs);
+		}
+		else if (nameIs(name, nameLen, "rte")) {
+			builder->objectDepth = depth;
+			builder->route = initializeRoute(builder->doc->arena);
+			insertBack(builder->doc->routes, builder->route);
+			builder->doc->counts->numRoutes++;
+			if (builder->lazy != NULL && depth == 2) {
+				startPart(builder, builder->route->totals, &builder->route->columns);
+			}
+		}
+		else if (nameIs(name, nameLen, "trk")) {
+			builder->objectDepth = depth;
+			builder->track = initializeTrack(builder->doc->arena);
+			insertBack(builder->doc->tracks, builder->track);
+			builder->doc->counts->numTracks++;
+			if (builder->lazy != NULL && depth == 2) {
+				builder->outerStart = builder->tagStart - builder->base;
+				builder->outerLen = builder->tagEnd - builder->tagStart;
+				memset(builder->track->totals, 0, sizeof(GPXTotals));
+			}
+		}
+		return;
+	}
+
+	const char* dataName = findSubAttribute(name, nameLen);
+
+	/* =========================================================   Waypoint children   =========================================================== */
+
+	if (builder->waypoint != NULL) {
+		if (depth == builder->waypointDepth + 1 && dataName != NULL) {
+			startData(builder, dataName);
+		}
+	}
+
+	/* =========================================================   RTE children   =========================================================== */
+
+	else if (builder->route != NULL) {
+		if (depth == builder->objectDepth + 1 && dataName != NULL) {
+			if (nameIs(name, nameLen, "rtept")) {
+				if (builder->part != NULL) {
+					countPoint(builder, attrs, numAttrs, builder->route->totals);
+				}
+				else {
+					startWaypoint(builder, attrs, numAttrs);
+				}
+			}
+			else {
+				startData(builder, dataName);
+			}
+		}
+	}
+
+	/* =========================================================   TRK children   =========================================================== */
+
+	else if (builder->track != NULL) {
+		if (builder->segment != NULL) {
+			if (depth == builder->segmentDepth + 1 && nameIs(name, nameLen, "trkpt")) {
+				if (builder->part != NULL) {
+					countPoint(builder, attrs, numAttrs, builder->track->totals);
+				}
+				else {
+					startWaypoint(builder, attrs, numAttrs);
+				}
+			}
+		}
+		else if (depth == builder->objectDepth + 1 && dataName != NULL) {
+			if (nameIs(name, nameLen, "trkseg")) {
+				builder->segment = initializeTrackSegment(builder->doc->arena);
+				builder->segmentDepth = depth;
+				insertBack(builder->track->segments, builder->segment);
+				builder->doc->counts->numSegments++;
+				if (builder->outerLen > 0) {
+					startPart(builder, NULL, &builder->segment->columns);
+				}
+			}
+			else {
+				startData(builder, dataName);
+			}
+		}
+	}
+}
+
+/** Function to handle a run of character data. Only the text directly inside a collected child element is kept.
+ *@param Ptr- the builder
+ *@param str- the text, not NUL terminated
+ *@param int- the length of the text
+ **/
+void builderText(GPXBuilder* builder, const char* text, int len) {
+	if (builder->dataDepth == 0 || builder->depth != builder->dataDepth || len <= 0) {
+		return;
+	}
+
+	if (builder->textLen + len + 1 > builder->textSize) {
+		int size = builder->textSize * 2;
+		if (size < builder->textLen + len + 1) {
+			size = builder->textLen + len + 1;
+		}
+		if (size < 64) {
+			size = 64;
+		}
+		builder->text = realloc(builder->text, sizeof(char) * size);
+		builder->textSize = size;
+	}
+
+	memcpy(builder->text + builder->textLen, text, len);
+	builder->textLen = builder->textLen + len;
+}
+
+/** Function to check if text at the current position would be kept, so a tokenizer can skip decoding it
+ *@return true if builderText would store the text
+ *@param Ptr- the builder
+ **/
+bool builderWantsText(const GPXBuilder* builder) {
+	return builder->dataDepth != 0 && builder->depth == builder->dataDepth;
+}
+
+/** Function to put back the text of a value that was only kept in its typed field
+ **/
+static void restoreData(GPXBuilder* builder, const char* dataName) {
+	Waypoint* waypoint = builder->waypoint;
+	char text[GPX_TYPED_TEXT_SIZE];
+
+	if (strcmp(dataName, "ele") == 0) {
+		formatGPXElevation(waypoint->elevation, text, sizeof(text));
+	}
+	else {
+		formatGPXTime(waypoint->time, text, sizeof(text));
+	}
+	insertBack(waypoint->otherData, initializeGPXData(builder->doc->arena, dataName, text));
+}
+
+/** Function to decode the <ele> or <time> of the open waypoint into its typed field
+ *@return true if the text does not need to be kept
+ **/
+static bool decodeData(GPXBuilder* builder, const char* cont) {
+	Waypoint* waypoint = builder->waypoint;
+	bool decoded;
+	unsigned char dropped;
+	int nameId;
+
+	if (strcmp(builder->dataName, "ele") == 0) {
+		double value;
+		decoded = isnan(waypoint->elevation) && parseGPXNumberExactly(cont, strlen(cont), &value);
+		if (decoded) {
+			waypoint->elevation = value;
+		}
+		dropped = GPX_DROPPED_ELE;
+		nameId = GPX_NAME_ELE;
+	}
+	else if (strcmp(builder->dataName, "time") == 0) {
+		decoded = waypoint->time == GPX_NO_TIME && parseGPXTime(cont, strlen(cont), &waypoint->time);
+		dropped = GPX_DROPPED_TIME;
+		nameId = GPX_NAME_TIME;
+	}
+	else {
+		return false;
+	}
+
+	//The text can only be left out if it is the one element of its name, the writers put it back from the typed
+	//field for waypoints that have none. When a second one shows up, the first is written out again.
+	if (decoded) {
+		if (builder->keepText || hasGPXData(waypoint->otherData, nameId)) {
+			return false;
+		}
+		waypoint->droppedText = waypoint->droppedText | dropped;
+		return true;
+	}
+	if ((waypoint->droppedText & dropped) != 0) {
+		restoreData(builder, builder->dataName);
+		waypoint->droppedText = waypoint->droppedText & ~dropped;
+	}
+	return false;
+}
+
+/** Function to store the collected text as a name or as a GPX data element of the open object
+ **/
+static void endData(GPXBuilder* builder) {
+	char empty[1] = "";
+	char* cont = empty;
+	if (builder->textLen > 0) {
+		builder->text[builder->textLen] = '\0';
+		cont = builder->text;
+	}
+
+	char** name = NULL;
+	List* otherData = NULL;
+
+	if (builder->waypoint != NULL) {
+		name = &builder->waypoint->name;
+		otherData = builder->waypoint->otherData;
+	}
+	else if (builder->route != NULL) {
+		name = &builder->route->name;
+		otherData = builder->route->otherData;
+	}
+	else if (builder->track != NULL) {
+		name = &builder->track->name;
+		otherData = builder->track->otherData;
+	}
+
+	if (strcmp(builder->dataName, "name") == 0) {
+		if (builder->doc->arena == NULL) {
+			free(*name);
+		}
+		*name = arenaString(builder->doc->arena, cont, strlen(cont));
+	}
+	else {
+		//Track data has its trailing whitespace removed
+		if (builder->waypoint == NULL && builder->track != NULL) {
+			trim(cont);
+		}
+		if (builder->waypoint == NULL || !decodeData(builder, cont)) {
+			insertBack(otherData, initializeGPXData(builder->doc->arena, builder->dataName, cont));
+		}
+	}
+
+	builder->dataName = NULL;
+	builder->dataDepth = 0;
+	builder->textLen = 0;
+}
+
+/** Function to handle the end of the innermost open element
+ *@param Ptr- the builder
+ **/
+void builderEndElement(GPXBuilder* builder) {
+	int depth = builder->depth;
+
+	if (builder->dataDepth != 0) {
+		if (depth == builder->dataDepth) {
+			endData(builder);
+		}
+	}
+	else if (builder->waypoint != NULL && depth == builder->waypointDepth) {
+		List* owner = builder->doc->waypoints;
+		PointColumns* columns = NULL;
+		GPXTotals* totals = NULL;
+		if (builder->segment != NULL) {
+			owner = builder->segment->waypoints;
+			columns = builder->segment->columns;
+			totals = builder->track->totals;
+		}
+		else if (builder->route != NULL) {
+			owner = builder->route->waypoints;
+			columns = builder->route->columns;
+			totals = builder->route->totals;
+		}
+		insertBack(owner, builder->waypoint);
+		if (columns != NULL) {
+			appendColumnsPoint(columns, builder->waypoint);
+		}
+		appendTotalsPoint(totals, builder->waypoint->latitude, builder->waypoint->longitude);
+		if (owner == builder->doc->waypoints) {
+			builder->doc->counts->numWaypoints++;
+		}
+		builder->numPoints++;
+		builder->waypoint = NULL;
+		builder->waypointDepth = 0;
+	}
+	else if (builder->segment != NULL && depth == builder->segmentDepth) {
+		if (builder->part != NULL) {
+			endPart(builder, builder->segment->waypoints);
+		}
+		builder->segment = NULL;
+		builder->segmentDepth = 0;
+	}
+
+	if (depth == builder->objectDepth) {
+		if (builder->part != NULL && builder->route != NULL) {
+			endPart(builder, builder->route->waypoints);
+		}
+		builder->outerLen = 0;
+		builder->objectDepth = 0;
+		builder->route = NULL;
+		builder->track = NULL;
+	}
+
+	builder->depth = depth - 1;
+}
+
+/* =========================================================   libxml Drivers   =========================================================== */
+
+/** Function to send the start of a libxml element node, with its attributes, to the builder
+ *@param Ptr- the builder
+ *@param Ptr- the element node
+ **/
+void builderNodeStart(GPXBuilder* builder, xmlNode* node) {
+	GPXAttribute stackAttrs[16];
+	GPXAttribute* attrs = stackAttrs;
+	xmlChar* owned[16];
+	int numAttrs = 0;
+	int numOwned = 0;
+	xmlAttr* attr;
+
+	for (attr = node->properties; attr != NULL; attr = attr->next) {
+		numAttrs = numAttrs + 1;
+	}
+	if (numAttrs > 16) {
+		attrs = malloc(sizeof(GPXAttribute) * numAttrs);
+	}
+
+	numAttrs = 0;
+	for (attr = node->properties; attr != NULL; attr = attr->next) {
+		xmlNode* value = attr->children;
+		const char* str = "";
+
+		//A single text child is read in place, anything else (entities) is flattened
+		if (value != NULL && value->next == NULL && value->type == XML_TEXT_NODE) {
+			str = (char*)value->content;
+		}
+		else if (value != NULL && numOwned < 16) {
+			owned[numOwned] = xmlNodeListGetString(node->doc, value, 1);
+			if (owned[numOwned] != NULL) {
+				str = (char*)owned[numOwned];
+			}
+			numOwned = numOwned + 1;
+		}
+
+		attrs[numAttrs].name = (char*)attr->name;
+		attrs[numAttrs].nameLen = strlen((char*)attr->name);
+		attrs[numAttrs].value = str;
+		attrs[numAttrs].valueLen = strlen(str);
+		numAttrs = numAttrs + 1;
+	}
+
+	const char* nsHref = NULL;
+	if (node->ns != NULL) {
+		nsHref = (char*)node->ns->href;
+	}
+
+	builderStartElement(builder, (char*)node->name, strlen((char*)node->name), nsHref, attrs, numAttrs);
+
+	for (int i = 0; i < numOwned; i++) {
+		xmlFree(owned[i]);
+	}
+	if (attrs != stackAttrs) {
+		free(attrs);
+	}
+}
+
+/** Function to send the text of a libxml text, CDATA or entity reference node to the builder
+ *@param Ptr- the builder
+ *@param Ptr- the node
+ **/
+void builderNodeText(GPXBuilder* builder, xmlNode* node) {
+	if (node->type == XML_ENTITY_REF_NODE) {
+		xmlChar* content = xmlNodeGetContent(node);
+		if (content != NULL) {
+			builderText(builder, (char*)content, strlen((char*)content));
+			xmlFree(content);
+		}
+	}
+	else if (node->content != NULL) {
+		builderText(builder, (char*)node->content, strlen((char*)node->content));
+	}
+}
+
+/** Function to build a GPX document straight from an xmlTextReader, without ever building an xmlDoc
+ *@return the new document, or NULL if the reader reported an error or, when validating, found the file invalid
+ *@param Ptr- the reader, positioned before the first node
+ *@param bool- false to keep waypoint <ele> and <time> only as typed values
+ *@param bool- true if the reader has a schema attached, the build stops at the first node that breaks it
+ **/
+GPXdoc* readerToGPXdoc(xmlTextReaderPtr reader, bool keepText, bool validating) {
+	GPXdoc* tmpDoc = initializeGPXdoc();
+	GPXBuilder builder;
+	int ret;
+
+	initializeBuilder(&builder, tmpDoc);
+	builder.keepText = keepText;
+
+	while ((ret = xmlTextReaderRead(reader)) == 1) {
+		int type = xmlTextReaderNodeType(reader);
+
+		if (validating && xmlTextReaderIsValid(reader) != 1) {
+			ret = -1;
+			break;
+		}
+
+		if (type == XML_READER_TYPE_ELEMENT) {
+			builderNodeStart(&builder, xmlTextReaderCurrentNode(reader));
+			if (xmlTextReaderIsEmptyElement(reader)) {
+				builderEndElement(&builder);
+			}
+		}
+		else if (type == XML_READER_TYPE_END_ELEMENT) {
+			builderEndElement(&builder);
+		}
+		else if (type == XML_READER_TYPE_TEXT || type == XML_READER_TYPE_CDATA || type == XML_READER_TYPE_WHITESPACE || type == XML_READER_TYPE_SIGNIFICANT_WHITESPACE) {
+			const char* value = (char*)xmlTextReaderConstValue(reader);
+			if (value != NULL) {
+				builderText(&builder, value, strlen(value));
+			}
+		}
+		else if (type == XML_READER_TYPE_ENTITY_REFERENCE) {
+			builderNodeText(&builder, xmlTextReaderCurrentNode(reader));
+		}
+	}
+
+	clearBuilder(&builder);
+
+	if (ret != 0) {
+		deleteGPXdoc(tmpDoc);
+		return NULL;
+	}
+
+	return tmpDoc;
+}
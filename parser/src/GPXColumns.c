@@ -0,0 +1,253 @@
+/**
+ * Created by: Alexander Blankenstein
+ **/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "GPXColumns.h"
+#include "GPXNumber.h"
+#include "GPXNames.h"
+#include "GPXHelper.h"
+#include "GPXParser.h"
+
+/** Function to free the arrays of a set of columns. The struct itself lives in the arena.
+ *@param Ptr- the columns
+ **/
+static void freeColumns(void* data) {
+	PointColumns* columns = (PointColumns*)data;
+	free(columns->lat);
+	free(columns->lon);
+	free(columns->ele);
+	free(columns->time);
+	free(columns->dataPoint);
+	free(columns->data);
+}
+
+/** Function to create empty columns for a route or segment of an arena document. The arrays are grown with
+ *  realloc, the arena frees them with the document.
+ *@return the new columns
+ *@param Ptr- the arena of the document
+ **/
+PointColumns* initializeColumns(GPXArena* arena) {
+	PointColumns* columns = arenaAlloc(arena, sizeof(PointColumns));
+	memset(columns, 0, sizeof(PointColumns));
+	arenaAdopt(arena, columns, &freeColumns);
+	return columns;
+}
+
+/** Function to add a point to the end of the columns
+ *@param Ptr- the columns
+ *@param Ptr- the waypoint, its other data is split between the ele and time columns and the sparse table
+ **/
+void appendColumnsPoint(PointColumns* columns, const Waypoint* waypoint) {
+	if (columns->length == columns->size) {
+		int size = columns->size == 0 ? 16 : columns->size * 2;
+		columns->lat = realloc(columns->lat, sizeof(double) * size);
+		columns->lon = realloc(columns->lon, sizeof(double) * size);
+		columns->ele = realloc(columns->ele, sizeof(double) * size);
+		columns->time = realloc(columns->time, sizeof(int64_t) * size);
+		columns->size = size;
+	}
+
+	int index = columns->length;
+	columns->lat[index] = waypoint->latitude;
+	columns->lon[index] = waypoint->longitude;
+	columns->ele[index] = NAN;
+	columns->time[index] = GPX_NO_TIME;
+
+	bool hasEle = false;
+	bool hasTime = false;
+	ListIterator iter = createIterator(waypoint->otherData);
+	GPXData* data;
+
+	while ((data = nextElement(&iter)) != NULL) {
+		//Only the first readable ele and time go into their columns, anything else is kept as is
+		if (!hasEle && data->nameId == GPX_NAME_ELE) {
+			hasEle = parseGPXNumberExactly(data->value, strlen(data->value), &columns->ele[index]);
+			if (hasEle) {
+				continue;
+			}
+			columns->ele[index] = NAN;
+		}
+		else if (!hasTime && data->nameId == GPX_NAME_TIME) {
+			hasTime = parseGPXTime(data->value, strlen(data->value), &columns->time[index]);
+			if (hasTime) {
+				continue;
+			}
+		}
+
+		if (columns->numData == columns->sizeData) {
+			columns->sizeData = columns->sizeData == 0 ? 16 : columns->sizeData * 2;
+			columns->dataPoint = realloc(columns->dataPoint, sizeof(int) * columns->sizeData);
+			columns->data = realloc(columns->data, sizeof(GPXData*) * columns->sizeData);
+		}
+		columns->dataPoint[columns->numData] = index;
+		columns->data[columns->numData] = data;
+		columns->numData++;
+	}
+
+	//Waypoints of createCompactGPXdoc only have the typed values
+	if (!hasEle && !isnan(waypoint->elevation)) {
+		columns->ele[index] = waypoint->elevation;
+	}
+	if (!hasTime && waypoint->time != GPX_NO_TIME) {
+		columns->time[index] = waypoint->time;
+	}
+
+	columns->length++;
+}
+
+/** Function to create empty totals for a route or track of an arena document
+ *@return the new totals, not filled yet
+ *@param Ptr- the arena of the document
+ **/
+GPXTotals* initializeTotals(GPXArena* arena) {
+	GPXTotals* totals = arenaAlloc(arena, sizeof(GPXTotals));
+	memset(totals, 0, sizeof(GPXTotals));
+	totals->numPoints = -1;
+	return totals;
+}
+
+/** Function to carry the totals of a route or track on over a point added after the last one.
+ *  Totals that have not been filled yet are left alone.
+ *@param Ptr- the totals, can be NULL
+ *@param double- the latitude of the point
+ *@param double- the longitude of the point
+ **/
+void appendTotalsPoint(GPXTotals* totals, double lat, double lon) {
+	if (totals == NULL || totals->numPoints < 0) {
+		return;
+	}
+	if (totals->numPoints > 0) {
+		totals->length = totals->length + haversine(lat, lon, totals->lastLat, totals->lastLon);
+	}
+	else {
+		totals->firstLat = lat;
+		totals->firstLon = lon;
+	}
+	totals->lastLat = lat;
+	totals->lastLon = lon;
+	totals->numPoints++;
+}
+
+/** Function to create the counts of an empty document
+ *@return the counts, all 0
+ *@param Ptr- the arena of the document
+ **/
+GPXCounts* initializeCounts(GPXArena* arena) {
+	GPXCounts* counts = arenaAlloc(arena, sizeof(GPXCounts));
+	memset(counts, 0, sizeof(GPXCounts));
+	counts->arena = arena;
+	counts->numChanges = arenaChanges(arena);
+	return counts;
+}
+
+/** Function to check if the counts of a document were right after the last change to its lists
+ *@return true if they can be used as they are
+ *@param Ptr- the counts, can be NULL
+ **/
+bool countsCurrent(const GPXCounts* counts) {
+	return counts != NULL && counts->numChanges == arenaChanges(counts->arena);
+}
+
+/** Function to record that the counts of a document match its lists, after whatever changed them has carried
+ *  the counts on as well
+ *@param Ptr- the counts, can be NULL
+ **/
+void markCountsCurrent(GPXCounts* counts) {
+	if (counts != NULL) {
+		counts->numChanges = arenaChanges(counts->arena);
+	}
+}
+
+/** Function to add the counts of a document that is joined into another one to the counts of that one
+ *@param Ptr- the counts that grow
+ *@param Ptr- the counts of the document joined in
+ **/
+void mergeCounts(GPXCounts* counts, const GPXCounts* other) {
+	counts->numWaypoints = counts->numWaypoints + other->numWaypoints;
+	counts->numRoutes = counts->numRoutes + other->numRoutes;
+	counts->numTracks = counts->numTracks + other->numTracks;
+	counts->numSegments = counts->numSegments >= 0 && other->numSegments >= 0 ? counts->numSegments + other->numSegments : -1;
+}
+
+/** Function to check that columns still hold the points of a waypoint list. A point can be moved in place without
+ *  the list knowing, so their coordinates are compared one by one.
+ *@return true if the columns match the list
+ *@param Ptr- the columns, can be NULL
+ *@param Ptr- the waypoint list, with its points in place
+ **/
+static bool columnsMatch(const PointColumns* columns, List* waypoints) {
+	if (columns == NULL || columns->length != getLength(waypoints)) {
+		return false;
+	}
+
+	ListIterator iter = createIterator(waypoints);
+	Waypoint* wpt;
+	int i = 0;
+
+	while ((wpt = nextElement(&iter)) != NULL) {
+		if (wpt->latitude != columns->lat[i] || wpt->longitude != columns->lon[i]) {
+			return false;
+		}
+		i++;
+	}
+	return true;
+}
+
+/** Function that returns the columnar copy of the points of a route
+ *@return the columns, or NULL if there are none, the points are not read yet or they no longer match the list
+ *@param Ptr- the route
+ **/
+const PointColumns* getRouteColumns(const Route* rt) {
+	//The columns of points that are not read yet are swapped in by whichever thread reads them, so they are only
+	//looked at once the list says it has its points
+	if (rt == NULL || !isListLoaded(rt->waypoints) || !columnsMatch(rt->columns, rt->waypoints)) {
+		return NULL;
+	}
+	return rt->columns;
+}
+
+/** Function that returns the columnar copy of the points of a track segment
+ *@return the columns, or NULL if there are none, the points are not read yet or they no longer match the list
+ *@param Ptr- the segment
+ **/
+const PointColumns* getSegmentColumns(const TrackSegment* seg) {
+	if (seg == NULL || !isListLoaded(seg->waypoints) || !columnsMatch(seg->columns, seg->waypoints)) {
+		return NULL;
+	}
+	return seg->columns;
+}
+
+/** Function that finds the other data of one point in the sparse table
+ *@return the number of GPXData the point has
+ *@param Ptr- the columns
+ *@param int- the point
+ *@param Ptr- set to the first of them
+ **/
+int getPointData(const PointColumns* columns, int index, GPXData* const** data) {
+	int low = 0;
+	int high = columns->numData;
+
+	//First entry at or after the point
+	while (low < high) {
+		int middle = low + (high - low) / 2;
+		if (columns->dataPoint[middle] < index) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+
+	int count = 0;
+	while (low + count < columns->numData && columns->dataPoint[low + count] == index) {
+		count++;
+	}
+	*data = columns->data + low;
+	return count;
+}
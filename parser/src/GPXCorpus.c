@@ -0,0 +1,394 @@
+/**
+ * Created by: Alexander Blankenstein
+ **/
+
+#define _DEFAULT_SOURCE
+
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "GPXParser.h"
+#include "GPXHelper.h"
+#include "GPXIndex.h"
+#include "GPXPool.h"
+#include "ArrayListAPI.h"
+
+/* The routes and tracks of every GPX file in a directory, kept between findPathsToJSON calls with their end
+ * points on one GPXEndTable. The first call reads every file. Later calls list the directory again and only read
+ * the files that are new or whose size or modification time changed, and drop the ones that are gone, so an
+ * upload costs one read of that file. Files are read like createSnapshotGPXdoc, from their .gpxb snapshot while
+ * it is current. */
+
+//A route or track of a corpus file, as its routeToJSON/trackToJSON string
+typedef struct {
+	char* json;
+	bool isTrack;
+	//Position of its file in the corpus, set when the end point table is filled
+	int file;
+} GPXCorpusPath;
+
+//One GPX file of a corpus, with its routes and tracks that have end points, in document order
+typedef struct {
+	char* name;
+	long long size;
+	long long modified;
+
+	GPXCorpusPath* paths;
+	//First lat, first lon, last lat, last lon of every path
+	float* points;
+	int numPaths;
+} GPXCorpusFile;
+
+//The files of one directory sorted by name, and the end points of all of their paths
+typedef struct GPXCorpus {
+	char* dirName;
+	ArrayList* files;
+	GPXEndTable table;
+	bool filled;
+	struct GPXCorpus* next;
+} GPXCorpus;
+
+//Files of one refresh that have to be read, filled in by the workers
+typedef struct {
+	const char* dirName;
+	GPXCorpusFile** files;
+} GPXCorpusRead;
+
+static pthread_mutex_t corpusLock = PTHREAD_MUTEX_INITIALIZER;
+static GPXCorpus* corpora = NULL;
+
+/** Function to free a corpus file and its paths
+ **/
+static void freeCorpusFile(GPXCorpusFile* file) {
+	for (int i = 0; i < file->numPaths; i++) {
+		free(file->paths[i].json);
+	}
+	free(file->paths);
+	free(file->points);
+	free(file->name);
+	free(file);
+}
+
+/** Function to print a corpus file for arrayListToString
+ *@return a copy of its name
+ **/
+static char* printCorpusFile(void* data) {
+	const char* name = ((GPXCorpusFile*)data)->name;
+	char* str = malloc(sizeof(char) * (strlen(name) + 1));
+	strcpy(str, name);
+	return str;
+}
+
+/** Function to compare two corpus files by name
+ **/
+static int compareCorpusFiles(const void* first, const void* second) {
+	return strcmp(((const GPXCorpusFile*)first)->name, ((const GPXCorpusFile*)second)->name);
+}
+
+/** Function to print a found path for toString
+ *@return a copy of its JSON
+ **/
+static char* printCorpusPath(void* data) {
+	const char* json = ((GPXCorpusPath*)data)->json;
+	char* str = malloc(sizeof(char) * (strlen(json) + 1));
+	strcpy(str, json);
+	return str;
+}
+
+/** Function to compare two found paths by their JSON
+ **/
+static int compareCorpusPaths(const void* first, const void* second) {
+	return strcmp(((const GPXCorpusPath*)first)->json, ((const GPXCorpusPath*)second)->json);
+}
+
+/** Function to read the routes and tracks of one file of a refresh, run on a worker thread. A file that cannot
+ *  be read is kept without paths until it changes again.
+ **/
+static void readCorpusFile(void* arg, int index) {
+	GPXCorpusRead* read = (GPXCorpusRead*)arg;
+	GPXCorpusFile* file = read->files[index];
+
+	char* path = malloc(sizeof(char) * (strlen(read->dirName) + strlen(file->name) + 2));
+	sprintf(path, "%s/%s", read->dirName, file->name);
+	GPXdoc* doc = createSnapshotGPXdoc(path);
+	free(path);
+	if (doc == NULL) {
+		return;
+	}
+
+	int numPaths = getLength(doc->routes) + getLength(doc->tracks);
+	file->paths = malloc(sizeof(GPXCorpusPath) * (numPaths > 0 ? numPaths : 1));
+	file->points = malloc(sizeof(float) * 4 * (numPaths > 0 ? numPaths : 1));
+
+	ListIterator iter = createIterator(doc->routes);
+	Route* rt;
+	while ((rt = nextElement(&iter)) != NULL) {
+		if (getRouteEnds(rt, file->points + file->numPaths * 4)) {
+			file->paths[file->numPaths].json = routeToJSON(rt);
+			file->paths[file->numPaths].isTrack = false;
+			file->numPaths++;
+		}
+	}
+
+	iter = createIterator(doc->tracks);
+	Track* tr;
+	while ((tr = nextElement(&iter)) != NULL) {
+		if (getTrackEnds(tr, file->points + file->numPaths * 4)) {
+			file->paths[file->numPaths].json = trackToJSON(tr);
+			file->paths[file->numPaths].isTrack = true;
+			file->numPaths++;
+		}
+	}
+
+	deleteGPXdoc(doc);
+}
+
+/** Function to make an empty corpus file for a file of the directory
+ *@return the file, or NULL if it is not a regular file
+ **/
+static GPXCorpusFile* statCorpusFile(const char* dirName, const char* name) {
+	struct stat info;
+	char* path = malloc(sizeof(char) * (strlen(dirName) + strlen(name) + 2));
+	sprintf(path, "%s/%s", dirName, name);
+	bool found = stat(path, &info) == 0 && S_ISREG(info.st_mode);
+	free(path);
+	if (!found) {
+		return NULL;
+	}
+
+	GPXCorpusFile* file = malloc(sizeof(GPXCorpusFile));
+	memset(file, 0, sizeof(GPXCorpusFile));
+	file->name = malloc(sizeof(char) * (strlen(name) + 1));
+	strcpy(file->name, name);
+	file->size = info.st_size;
+	file->modified = gpxFileModified(&info);
+	return file;
+}
+
+/** Function to bring the files of a corpus in line with its directory. Files that are the same size and time as
+ *  when they were read are kept, the others are read again on a pool of worker threads.
+ *@return true if any file was added, read again or dropped
+ **/
+static bool refreshCorpus(GPXCorpus* corpus) {
+	ArrayList* found = initializeArrayList(printCorpusFile, dummyDelete, compareCorpusFiles);
+	DIR* dir = opendir(corpus->dirName);
+	if (dir != NULL) {
+		struct dirent* entry;
+		while ((entry = readdir(dir)) != NULL) {
+			if (gpxFileKind(entry->d_name) == GPX_FILE_NONE) {
+				continue;
+			}
+			GPXCorpusFile* file = statCorpusFile(corpus->dirName, entry->d_name);
+			if (file != NULL) {
+				insertArrayBack(found, file);
+			}
+		}
+		closedir(dir);
+	}
+	sortArrayList(found);
+
+	//Both lists are sorted by name, so one walk pairs every file with what was kept of it
+	int numOld = getArrayLength(corpus->files);
+	int numFound = getArrayLength(found);
+	GPXCorpusFile** toRead = malloc(sizeof(GPXCorpusFile*) * (numFound > 0 ? numFound : 1));
+	int numToRead = 0;
+	bool changed = false;
+	int i = 0;
+	for (int j = 0; j < numFound; j++) {
+		GPXCorpusFile* file = getFromArray(found, j);
+		while (i < numOld && strcmp(((GPXCorpusFile*)getFromArray(corpus->files, i))->name, file->name) < 0) {
+			freeCorpusFile(getFromArray(corpus->files, i));
+			changed = true;
+			i++;
+		}
+
+		GPXCorpusFile* old = i < numOld ? getFromArray(corpus->files, i) : NULL;
+		if (old != NULL && strcmp(old->name, file->name) == 0) {
+			i++;
+			if (old->size == file->size && old->modified == file->modified) {
+				found->elements[j] = old;
+				freeCorpusFile(file);
+				continue;
+			}
+			freeCorpusFile(old);
+		}
+		toRead[numToRead++] = file;
+		changed = true;
+	}
+	for (; i < numOld; i++) {
+		freeCorpusFile(getFromArray(corpus->files, i));
+		changed = true;
+	}
+
+	GPXCorpusRead read;
+	read.dirName = corpus->dirName;
+	read.files = toRead;
+	GPXThreadPool* pool = NULL;
+	if (numToRead > 1) {
+		int numThreads = defaultThreadCount();
+		pool = createThreadPool(numThreads < numToRead ? numThreads : numToRead);
+	}
+	if (pool != NULL) {
+		runThreadPool(pool, numToRead, readCorpusFile, &read);
+		freeThreadPool(pool);
+	}
+	else {
+		for (int j = 0; j < numToRead; j++) {
+			readCorpusFile(&read, j);
+		}
+	}
+	free(toRead);
+
+	freeArrayList(corpus->files);
+	corpus->files = found;
+	return changed;
+}
+
+/** Function to fill the end point table of a corpus from its files, in file order
+ **/
+static void fillCorpusTable(GPXCorpus* corpus) {
+	int numFiles = getArrayLength(corpus->files);
+	int numPaths = 0;
+	for (int i = 0; i < numFiles; i++) {
+		numPaths = numPaths + ((GPXCorpusFile*)getFromArray(corpus->files, i))->numPaths;
+	}
+
+	void** entities = malloc(sizeof(void*) * (numPaths > 0 ? numPaths : 1));
+	float* points = malloc(sizeof(float) * 4 * (numPaths > 0 ? numPaths : 1));
+	int pos = 0;
+	for (int i = 0; i < numFiles; i++) {
+		GPXCorpusFile* file = getFromArray(corpus->files, i);
+		for (int j = 0; j < file->numPaths; j++) {
+			file->paths[j].file = i;
+			entities[pos] = &file->paths[j];
+			memcpy(points + pos * 4, file->points + j * 4, sizeof(float) * 4);
+			pos++;
+		}
+	}
+
+	fillEndTableWith(&corpus->table, entities, points, numPaths);
+	free(entities);
+	free(points);
+	corpus->filled = true;
+}
+
+/** Function that returns the corpus kept for a directory, making an empty one the first time
+ *@pre corpusLock is held
+ **/
+static GPXCorpus* findCorpus(const char* dirName) {
+	GPXCorpus* corpus = corpora;
+	while (corpus != NULL && strcmp(corpus->dirName, dirName) != 0) {
+		corpus = corpus->next;
+	}
+	if (corpus != NULL) {
+		return corpus;
+	}
+
+	corpus = malloc(sizeof(GPXCorpus));
+	memset(corpus, 0, sizeof(GPXCorpus));
+	corpus->dirName = malloc(sizeof(char) * (strlen(dirName) + 1));
+	strcpy(corpus->dirName, dirName);
+	corpus->files = initializeArrayList(printCorpusFile, dummyDelete, compareCorpusFiles);
+	corpus->next = corpora;
+	corpora = corpus;
+	return corpus;
+}
+
+/** Function to find the routes and tracks of every GPX file in a directory that start within delta of a source
+ *  and end within delta of a destination. What was read of the directory is kept between calls, and a call only
+ *  reads the files that were added or changed since the last one.
+ *@pre dirName is not NULL
+ *@return A JSON string {"numPathFiles":n,"foundPathData":[...]}. foundPathData holds a routeListToJSON string
+ *        of the routes found in a file, then a trackListToJSON string of its tracks, for every file in name
+ *        order that has any. n is the number of strings.
+ *@param str- the directory
+ *@param float- the source latitude and longitude
+ *@param float- the destination latitude and longitude
+ *@param float- the most a first or last point may be from the source or destination, in meters
+ **/
+char* findPathsToJSON(char* dirName, float sourceLat, float sourceLong, float destLat, float destLong, float delta) {
+	int size = 256;
+	int len = 0;
+	char* json = malloc(sizeof(char) * size);
+	json[0] = '\0';
+
+	initGPXParser();
+	List* found = initializeList(printCorpusPath, dummyDelete, compareCorpusPaths);
+
+	pthread_mutex_lock(&corpusLock);
+	GPXCorpus* corpus = findCorpus(dirName);
+	if (refreshCorpus(corpus) || !corpus->filled) {
+		fillCorpusTable(corpus);
+	}
+	if (delta >= 0) {
+		findEndsBetween(&corpus->table, sourceLat, sourceLong, destLat, destLong, delta, found);
+	}
+
+	//The found paths come in table order, so the routes and the tracks of a file are each one run
+	char* groups = malloc(sizeof(char) * size);
+	int groupsLen = 0;
+	int groupsSize = size;
+	char* group = malloc(sizeof(char) * size);
+	int groupLen = 0;
+	int groupSize = size;
+	int numGroups = 0;
+	groups[0] = '\0';
+	group[0] = '\0';
+
+	GPXCorpusPath* last = NULL;
+	ListIterator iter = createIterator(found);
+	GPXCorpusPath* path;
+	while ((path = nextElement(&iter)) != NULL) {
+		if (last != NULL && (path->file != last->file || path->isTrack != last->isTrack)) {
+			appendText(&group, &groupLen, &groupSize, "]");
+			appendText(&groups, &groupsLen, &groupsSize, numGroups > 0 ? "," : "");
+			appendJSONString(&groups, &groupsLen, &groupsSize, group);
+			numGroups++;
+			groupLen = 0;
+		}
+		appendText(&group, &groupLen, &groupSize, groupLen == 0 ? "[" : ",");
+		appendText(&group, &groupLen, &groupSize, path->json);
+		last = path;
+	}
+	if (last != NULL) {
+		appendText(&group, &groupLen, &groupSize, "]");
+		appendText(&groups, &groupsLen, &groupsSize, numGroups > 0 ? "," : "");
+		appendJSONString(&groups, &groupsLen, &groupsSize, group);
+		numGroups++;
+	}
+	pthread_mutex_unlock(&corpusLock);
+
+	char numStr[64];
+	sprintf(numStr, "{\"numPathFiles\":%d,\"foundPathData\":[", numGroups);
+	appendText(&json, &len, &size, numStr);
+	appendText(&json, &len, &size, groups);
+	appendText(&json, &len, &size, "]}");
+
+	free(group);
+	free(groups);
+	freeList(found);
+	return json;
+}
+
+/** Function to free every corpus kept by findPathsToJSON, for cleanupGPXParser
+ **/
+void freeSharedGPXCorpora(void) {
+	pthread_mutex_lock(&corpusLock);
+	while (corpora != NULL) {
+		GPXCorpus* next = corpora->next;
+		for (int i = 0; i < getArrayLength(corpora->files); i++) {
+			freeCorpusFile(getFromArray(corpora->files, i));
+		}
+		freeArrayList(corpora->files);
+		freeEndTable(&corpora->table);
+		free(corpora->dirName);
+		free(corpora);
+		corpora = next;
+	}
+	pthread_mutex_unlock(&corpusLock);
+}
@@ -2,231 +2,341 @@
  * Created by: Alexander Blankenstein
  **/
 
+#define _DEFAULT_SOURCE
+
 #include <stdbool.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include <libxml/parser.h>
 #include <libxml/tree.h>
 #include <math.h>
 
 #include "GPXHelper.h"
 #include "GPXParser.h"
+#include "GPXBuilder.h"
+#include "GPXColumns.h"
+#include "GPXNames.h"
+#include "GPXNumber.h"
+#include "GPXIndex.h"
+
+//Same order as the built in ids of GPXNames.h
+static const char* const subAttributes[] = { "name","desc","rtept","trkseg","trkpt","ele","time" };
 
-char subAttributes[7][1024] = { "name","desc","rtept","trkseg","trkpt","ele","time" };
-char nodeAttributes[2][1024] = {"lat","lon" };
+//libxml parses performed by this thread since the last resetParseCount(), see getParseCount()
+static _Thread_local int parseCount = 0;
+
+/** Function to walk a list of sibling nodes and their children, sending every element and text node to the builder
+*@param Ptr- the builder filling the document
+*@param Ptr- the first node of the list
+**/
+static void walkNodes(GPXBuilder* builder, xmlNode* a_node) {
+	while (a_node) {
+		if (a_node->type == XML_ELEMENT_NODE) {
+			builderNodeStart(builder, a_node);
+			walkNodes(builder, a_node->children);
+			builderEndElement(builder);
+		}
+		else if (a_node->type == XML_TEXT_NODE || a_node->type == XML_CDATA_SECTION_NODE || a_node->type == XML_ENTITY_REF_NODE) {
+			builderNodeText(builder, a_node);
+		}
+		a_node = a_node->next;
+	}
+}
 
 /** Function to initialize the list metadata and fills it with data from the parsed file. 
+* The tree is walked exactly once and fed to the same builder the streaming reader uses.
 *@param Ptr- a pointer to a single node of the linked list
 *@param Obj- the GPX document object to store data into
-*@param Str- the filename to parse data from
 **/
-void fillDoc(xmlNode* a_node, GPXdoc* tmpDoc, char* filename) {
-	xmlChar* sub;
-	xmlDocPtr doc = xmlParseFile(filename);
-	while (a_node) {
-		if (a_node->type == XML_ELEMENT_NODE) {
-			/* =========================================================   GPX   =========================================================== */
-
-			if (strcmp((char*)a_node->name, "gpx") == 0) {
-				xmlAttr* attr;
-				//namespace
-				char* cont = (char*)(a_node->ns->href);
-				strcpy(((tmpDoc)->namespace), cont);
-
-				for (attr = a_node->properties; attr != NULL; attr = attr->next)
-				{
-					xmlNode* value = attr->children;
-					if (strcmp((char*)attr->name, "version") == 0) {
-						char* valueData = (char*)(value->content);
-						double data = strtod(valueData, NULL);
-						((tmpDoc)->version) = data;
-					}
+void fillDoc(xmlNode* a_node, GPXdoc* tmpDoc) {
+	GPXBuilder builder;
 
-					else if (strcmp((char*)attr->name, "creator") == 0) {
-						char* creatorData = (char*)(value->content);
-						int size = strlen(creatorData) + 1;
-						((tmpDoc)->creator) = realloc((tmpDoc)->creator, sizeof(char) * size);
-						strcpy(((tmpDoc)->creator), creatorData);
-					}
-				}
-			}
+	initializeBuilder(&builder, tmpDoc);
+	walkNodes(&builder, a_node);
+	clearBuilder(&builder);
+}
 
-			/* =========================================================   WPT   =========================================================== */
+/** Function to look up an element name in the table of children the parser keeps
+ *@return the entry of the subAttributes table, or NULL if the name is not in it
+ *@param str- the element name, not NUL terminated
+ *@param int- the length of the name
+ **/
+const char* findSubAttribute(const char* name, int nameLen) {
+	for (int i = 0; i < 7; i++) {
+		if ((int)strlen(subAttributes[i]) == nameLen && memcmp(name, subAttributes[i], nameLen) == 0) {
+			return subAttributes[i];
+		}
+	}
+	return NULL;
+}
 
-			else if (strcmp((char*)a_node->name, "wpt") == 0) {
-				Waypoint* waypoint = malloc(sizeof(Waypoint));
-				waypoint->otherData = initializeList(&gpxDataToString, &deleteGpxData, &compareGpxData);
-				waypoint->latitude = 0.0;
-				waypoint->longitude = 0.0;
-				waypoint->name = malloc(2 * sizeof(char*));
-				strcpy(waypoint->name, "");
+/* =========================================================   Constructor Helper Functions   =========================================================== */
+/* Every constructor takes the arena of the document the object is for. Objects for a document come out of its arena
+ * and their lists take nodes from it, so nothing in them is freed on its own. With a NULL arena the object is
+ * allocated with malloc like before, for objects that are built on their own (JSONtoWaypoint, JSONtoRoute, ...). */
 
-				createWaypoint(waypoint, a_node, doc);
-				insertBack(tmpDoc->waypoints, waypoint);
-			}
+/** Function to create a list, in the arena when there is one
+ *@return the new list
+ **/
+static List* createList(GPXArena* arena, char* (*printFunction)(void* toBePrinted), void (*deleteFunction)(void* toBeDeleted), int (*compareFunction)(const void* first, const void* second)) {
+	if (arena == NULL) {
+		return initializeList(printFunction, deleteFunction, compareFunction);
+	}
+	//The arena frees the contents, so the list must not. Changes to it are changes to the document.
+	List* list = initializeListInPool(printFunction, &dummyDelete, compareFunction, &arenaPoolAlloc, arena);
+	watchList(list, &arenaChanged, arena);
+	return list;
+}
 
-			/* =========================================================   RTE   =========================================================== */
-
-			else if (strcmp((char*)a_node->name, "rte") == 0) {
-				Route* route = malloc(sizeof(Route));
-				route->name = malloc(2 * sizeof(char*));
-				strcpy(route->name, "");
-				route->otherData = initializeList(&gpxDataToString, &deleteGpxData, &compareGpxData);
-				route->waypoints = initializeList(&waypointToString, &deleteWaypoint, &compareWaypoints);
-				xmlNode* b_node = a_node->children;
-				while (b_node)
-				{
-					for (int i = 0; i < 7; i++) {
-						if ((!xmlStrcmp(b_node->name, (const xmlChar*)subAttributes[i]))) {
-							sub = xmlNodeListGetString(doc, b_node->xmlChildrenNode, 1);
-							if ((!xmlStrcmp(b_node->name, (const xmlChar*)"name"))) {
-								char* nameData = (char*)(sub);
-								int size = strlen(nameData) + 1;
-								route->name = realloc(route->name, sizeof(char) * size);
-								strcpy(route->name, nameData);
-							}
-							else if ((!xmlStrcmp(b_node->name, (const xmlChar*)"rtept"))) {
-								Waypoint* waypoint = malloc(sizeof(Waypoint));
-								waypoint->otherData = initializeList(&gpxDataToString, &deleteGpxData, &compareGpxData);
-								waypoint->latitude = 0.0;
-								waypoint->longitude = 0.0;
-								waypoint->name = malloc(2 * sizeof(char*));
-								strcpy(waypoint->name, "");
-
-								createWaypoint(waypoint, b_node, doc);
-								insertBack(route->waypoints, waypoint);
-							}
-							else{
-								char* cont = (char*)(sub);
-								GPXData* otherData = malloc(sizeof(GPXData) + sizeof(char) * (strlen(cont)+5));
-								//trim(cont);
-								strcpy((otherData)->name, (char*)b_node->name);
-								strcpy(((otherData)->value), cont);
-								insertBack(route->otherData, otherData);
-							}
-							xmlFree(sub);
-						}
-					}
-					b_node = b_node->next;
-				}
-				insertBack(tmpDoc->routes, route);
-			}
+/** Function to allocate an empty GPX document with all of its lists initialized. The document owns a new arena.
+ *@return pointer to the new document
+ **/
+GPXdoc* initializeGPXdoc(void) {
+	return initializeSharedGPXdoc(createArena());
+}
 
-			/* =========================================================   TRK   =========================================================== */
-
-			else if (strcmp((char*)a_node->name, "trk") == 0) {
-				Track* track = malloc(sizeof(Track));
-				track->name = malloc(2 * sizeof(char*));
-				strcpy(track->name, "");
-				track->otherData = initializeList(&gpxDataToString, &deleteGpxData, &compareGpxData);
-				track->segments = initializeList(&trackSegmentToString, &deleteTrackSegment, &compareTrackSegments);
-
-				xmlNode* b_node = a_node->children;
-				while (b_node)
-				{
-					for (int i = 0; i < 7; i++) {
-						if ((!xmlStrcmp(b_node->name, (const xmlChar*)subAttributes[i]))) {
-							sub = xmlNodeListGetString(doc, b_node->xmlChildrenNode, 1);
-							if ((!xmlStrcmp(b_node->name, (const xmlChar*)"name"))) {
-								char* nameData = (char*)(sub);
-								int size = strlen(nameData) +1;
-								track->name = realloc(track->name, sizeof(char) * size);
-								strcpy(track->name, nameData);
-							}
-							else if ((!xmlStrcmp(b_node->name, (const xmlChar*)"trkseg"))) {
-								TrackSegment* trackSeg = malloc(sizeof(TrackSegment));
-								trackSeg->waypoints = initializeList(&waypointToString, &deleteWaypoint, &compareWaypoints);
-								xmlNode* c_node = b_node->children;
-								while (c_node) {
-									if ((!xmlStrcmp(c_node->name, (const xmlChar*)"trkpt"))) {
-										Waypoint* waypoint = malloc(sizeof(Waypoint));
-										waypoint->otherData = initializeList(&gpxDataToString, &deleteGpxData, &compareGpxData);
-										waypoint->latitude = 0.0;
-										waypoint->longitude = 0.0;
-										waypoint->name = malloc(2 * sizeof(char*));
-										strcpy(waypoint->name, "");
-
-										createWaypoint(waypoint, c_node, doc);
-										insertBack(trackSeg->waypoints, waypoint);
-									}
-									c_node = c_node->next;
-								}
-								insertBack(track->segments, trackSeg);
-							}
-							else {
-								char* cont = (char*)(sub);
-								GPXData* otherData = malloc(sizeof(GPXData) + sizeof(char) * (strlen(cont) + 5));
-								trim(cont);
-								strcpy((otherData)->name, (char*)b_node->name);
-								strcpy(((otherData)->value), cont);
-								insertBack(track->otherData, otherData);
-							}
-							xmlFree(sub);
-						}
-					}
-					b_node = b_node->next;
-				}
-				insertBack(tmpDoc->tracks, track);
-			}
+/** Function to allocate an empty GPX document out of an existing arena, for building objects that are then
+ *  moved into the document owning that arena. It goes away with the arena, never call deleteGPXdoc on it.
+ *@return pointer to the new document
+ *@param Ptr- the arena
+ **/
+GPXdoc* initializeSharedGPXdoc(GPXArena* arena) {
+	GPXdoc* tmpDoc = arenaAlloc(arena, sizeof(GPXdoc));
+	tmpDoc->arena = arena;
+	strcpy(tmpDoc->namespace, "");
+	tmpDoc->version = 0.0;
+	tmpDoc->creator = arenaString(arena, "", 0);
+	tmpDoc->waypoints = createList(arena, &waypointToString, &deleteWaypoint, &compareWaypoints);
+	tmpDoc->routes = createList(arena, &routeToString, &deleteRoute, &compareRoutes);
+	tmpDoc->tracks = createList(arena, &trackToString, &deleteTrack, compareTracks);
+	tmpDoc->counts = initializeCounts(arena);
+	tmpDoc->names = initializeNameIndex(arena);
+	tmpDoc->ends = initializeEndIndex(arena);
+	return tmpDoc;
+}
+
+/** Function to allocate an empty waypoint with no name and no other data
+ *@return pointer to the new waypoint
+ *@param Ptr- the arena of the document it is for, or NULL
+ **/
+Waypoint* initializeWaypoint(GPXArena* arena) {
+	Waypoint* waypoint = arenaAlloc(arena, sizeof(Waypoint));
+	waypoint->otherData = createList(arena, &gpxDataToString, &deleteGpxData, &compareGpxData);
+	waypoint->latitude = 0.0;
+	waypoint->longitude = 0.0;
+	waypoint->name = arenaString(arena, "", 0);
+	waypoint->elevation = NAN;
+	waypoint->time = GPX_NO_TIME;
+	waypoint->droppedText = 0;
+	return waypoint;
+}
+
+/** Function to allocate an empty route with no name, waypoints or other data
+ *@return pointer to the new route
+ *@param Ptr- the arena of the document it is for, or NULL
+ **/
+Route* initializeRoute(GPXArena* arena) {
+	Route* route = arenaAlloc(arena, sizeof(Route));
+	route->name = arenaString(arena, "", 0);
+	route->otherData = createList(arena, &gpxDataToString, &deleteGpxData, &compareGpxData);
+	route->waypoints = createList(arena, &waypointToString, &deleteWaypoint, &compareWaypoints);
+	route->columns = arena != NULL ? initializeColumns(arena) : NULL;
+	route->totals = arena != NULL ? initializeTotals(arena) : NULL;
+	return route;
+}
+
+/** Function to allocate an empty track with no name, segments or other data
+ *@return pointer to the new track
+ *@param Ptr- the arena of the document it is for, or NULL
+ **/
+Track* initializeTrack(GPXArena* arena) {
+	Track* track = arenaAlloc(arena, sizeof(Track));
+	track->name = arenaString(arena, "", 0);
+	track->otherData = createList(arena, &gpxDataToString, &deleteGpxData, &compareGpxData);
+	track->segments = createList(arena, &trackSegmentToString, &deleteTrackSegment, &compareTrackSegments);
+	track->totals = arena != NULL ? initializeTotals(arena) : NULL;
+	return track;
+}
+
+/** Function to allocate an empty track segment
+ *@return pointer to the new segment
+ *@param Ptr- the arena of the document it is for, or NULL
+ **/
+TrackSegment* initializeTrackSegment(GPXArena* arena) {
+	TrackSegment* trackSeg = arenaAlloc(arena, sizeof(TrackSegment));
+	trackSeg->waypoints = createList(arena, &waypointToString, &deleteWaypoint, &compareWaypoints);
+	trackSeg->columns = arena != NULL ? initializeColumns(arena) : NULL;
+	return trackSeg;
+}
+
+/** Function to allocate a GPX data element holding a copy of the name and value
+ *@return pointer to the new data element
+ *@param Ptr- the arena of the document it is for, or NULL
+ *@param str- the element name
+ *@param str- the element value
+ **/
+GPXData* initializeGPXData(GPXArena* arena, const char* name, const char* value) {
+	GPXData* otherData = arenaAlloc(arena, sizeof(GPXData) + sizeof(char) * (strlen(value) + 1));
+	otherData->nameId = internGPXName(name, strlen(name));
+	strcpy(otherData->value, value);
+	return otherData;
+}
+
+/** Function to check if a list of GPX data holds an element with the given name
+ *@return true if it does
+ *@param Ptr- the list of GPXData
+ *@param int- the interned name
+ **/
+bool hasGPXData(const List* list, int nameId) {
+	if (list == NULL) {
+		return false;
+	}
+	for (Node* node = list->head; node != NULL; node = node->next) {
+		if (((GPXData*)node->data)->nameId == nameId) {
+			return true;
 		}
-		fillDoc(a_node->children, tmpDoc, filename);
-		a_node = a_node->next;
 	}
-	xmlFreeDoc(doc);
+	return false;
 }
 
-/** Function to initialize a waypoint object and fill it with data from the linked list
-*@return pointer to the waypoint
-*@param Ptr- a pointer to a waypoint object
-*@param Ptr- a pointer to a single node of the linked list
-*@param Ptr- a pointer to an XML document
-**/
-void createWaypoint(Waypoint* waypoint, xmlNode* a_node, xmlDocPtr doc) {
-	xmlChar* nod,* sub;
-	for (int j = 0; j < 2; j++) {
-		nod = xmlGetProp(a_node, (const xmlChar*)nodeAttributes[j]);
-		if ((nod) != NULL) {
-			if (strcmp(nodeAttributes[j], "lat") == 0) {
-				char* valueData = (char*)nod;
-				double data = strtod(valueData, NULL);
-				waypoint->latitude = data;
-			}
-			else if (strcmp(nodeAttributes[j], "lon") == 0) {
-				char* valueData = (char*)nod;
-				double data = strtod(valueData, NULL);
-				waypoint->longitude = data;
-			}
+/** Function to check if a typed value of a waypoint stands for text that createCompactGPXdoc dropped
+ *@return true if the text has to be written back from the typed field
+ *@param Ptr- the waypoint
+ *@param int- GPX_DROPPED_ELE or GPX_DROPPED_TIME
+ *@param int- the interned name of the element
+ **/
+static bool hasDroppedText(const Waypoint* waypoint, int dropped, int nameId) {
+	return (waypoint->droppedText & dropped) != 0 && !hasGPXData(waypoint->otherData, nameId);
+}
+
+/** Function to write the typed elevation and time of a waypoint back out as text, for each one whose text
+ *  createCompactGPXdoc dropped and that has no GPX data element of its own
+ *@return the number of values written, 0 to 2, ele first
+ *@param Ptr- the waypoint
+ *@param Ptr- set to the element names
+ *@param Ptr- set to the element values
+ **/
+int typedPointText(const Waypoint* waypoint, const char* names[2], char values[2][GPX_TYPED_TEXT_SIZE]) {
+	int num = 0;
+
+	if (hasDroppedText(waypoint, GPX_DROPPED_ELE, GPX_NAME_ELE)) {
+		if (formatGPXElevation(waypoint->elevation, values[num], GPX_TYPED_TEXT_SIZE) >= 0) {
+			names[num] = gpxNameString(GPX_NAME_ELE);
+			num++;
 		}
-		xmlFree(nod);
 	}
-	xmlNode* b_node = a_node->children;
-	while (b_node)
-	{
-		for (int i = 0; i < 7; i++) {
-			if ((!xmlStrcmp(b_node->name, (const xmlChar*)subAttributes[i]))) {
-				sub = xmlNodeListGetString(doc, b_node->xmlChildrenNode, 1);
-				if (strcmp(subAttributes[i], "name") == 0) {
-					char* creatorData = (char*)(sub);
-					int size = strlen(creatorData) + 1;
-					waypoint->name = realloc(waypoint->name, sizeof(char) * size);
-					strcpy(waypoint->name, creatorData);
-				}
-				else{
-					char* cont = (char*)(sub);
-					GPXData* otherData = malloc(sizeof(GPXData) + sizeof(char) * (strlen(cont) + 5));
+	if (hasDroppedText(waypoint, GPX_DROPPED_TIME, GPX_NAME_TIME)) {
+		if (formatGPXTime(waypoint->time, values[num], GPX_TYPED_TEXT_SIZE) >= 0) {
+			names[num] = gpxNameString(GPX_NAME_TIME);
+			num++;
+		}
+	}
+	return num;
+}
 
-					strcpy((otherData)->name, (char*)b_node->name);
-					strcpy(((otherData)->value), cont);
-					insertBack(waypoint->otherData, otherData);
-				}
-				xmlFree(sub);
-			}
+/** Function to add the typed elevation and time of a waypoint to its XML node, see typedPointText
+ **/
+static void addTypedChildren(xmlNodePtr node, const Waypoint* waypoint) {
+	const char* names[2];
+	char values[2][GPX_TYPED_TEXT_SIZE];
+	int num = typedPointText(waypoint, names, values);
+
+	for (int i = 0; i < num; i++) {
+		xmlNewChild(node, NULL, BAD_CAST names[i], BAD_CAST values[i]);
+	}
+}
+
+/* =========================================================   Parse Counter   =========================================================== */
+/** Function to parse a file with libxml, counting every parse so callers can check a file is only read once
+ *@return the parsed document, or NULL if the file could not be parsed
+ *@param str- the filename to parse
+ *@param int- the libxml parser options
+ **/
+xmlDocPtr readXMLFile(char* fileName, int options) {
+	parseCount = parseCount + 1;
+	return xmlReadFile(fileName, NULL, options);
+}
+
+/** Function to parse a file with libxml on a parser context of the caller's, counting it like readXMLFile
+ *@return the tree, or NULL if the file could not be read or is not well formed
+ *@param Ptr- the parser context, reused from one file to the next
+ *@param str- the filename to parse
+ *@param int- the libxml parser options
+ **/
+xmlDocPtr readXMLFileWith(xmlParserCtxtPtr ctxt, char* fileName, int options) {
+	parseCount = parseCount + 1;
+	return xmlCtxtReadFile(ctxt, fileName, NULL, options);
+}
+
+/** Function to check the extension of a GPX file name
+ *@return GPX_FILE_PLAIN for .gpx, GPX_FILE_GZIP for .gpx.gz, GPX_FILE_NONE for anything else
+ *@param str- the file name
+ **/
+int gpxFileKind(const char* fileName) {
+	int len = strlen(fileName);
+
+	if (len >= 4 && strcmp(fileName + len - 4, ".gpx") == 0) {
+		return GPX_FILE_PLAIN;
+	}
+	if (len >= 7 && strcmp(fileName + len - 7, ".gpx.gz") == 0) {
+		return GPX_FILE_GZIP;
+	}
+	return GPX_FILE_NONE;
+}
+
+/** Function that returns the modification time of a file, for telling if a file was changed since it was read
+ *@return the time in nanoseconds since 1970
+ *@param Ptr- the status of the file from stat or fstat
+ **/
+long long gpxFileModified(const struct stat* info) {
+	return (long long)info->st_mtim.tv_sec * 1000000000LL + info->st_mtim.tv_nsec;
+}
+
+/** Function to read len bytes at an offset of a file, all of them or none
+ *@return true if all of them were read
+ *@param int- the file descriptor
+ *@param Ptr- where the bytes go
+ *@param int- the number of bytes
+ *@param int- the offset in the file
+ **/
+bool readFileAt(int fd, char* buffer, long len, long offset) {
+	while (len > 0) {
+		ssize_t got = pread(fd, buffer, len, offset);
+		if (got <= 0) {
+			return false;
 		}
-		b_node = b_node->next;
+		buffer = buffer + got;
+		len = len - got;
+		offset = offset + got;
 	}
+	return true;
 }
 
+/** Function to open a streaming reader on a file with libxml, counting it like readXMLFile
+ *@return the reader, or NULL if the file could not be opened
+ *@param str- the filename to parse
+ *@param int- the libxml parser options
+ **/
+xmlTextReaderPtr readXMLStream(char* fileName, int options) {
+	parseCount = parseCount + 1;
+	return xmlReaderForFile(fileName, NULL, options);
+}
+
+/** Function to reset the parse counter at the start of a public parse call
+ **/
+void resetParseCount(void) {
+	parseCount = 0;
+}
+
+/** Function that returns the number of libxml parses since the last public parse call started
+ *@return the number of parses
+ **/
+int getParseCount(void) {
+	return parseCount;
+}
 
 /*
 =========================================================   Trim function   ===========================================================
@@ -317,18 +427,17 @@ bool compareTracksBool(const void* first, const void* second) {
 	return toReturn;
 }
 
-/** Function to convert a GPX object to XML
+/** Function to build the XML tree of a GPX object in memory
  *@pre Doc Object is not NULL
  *@post Doc object have not been modified in any way
- *@return A Boolean based off the success
+ *@return the tree, to be freed with xmlFreeDoc, or NULL if there is no document
  *@param ptr- a pointer object that points to the GPX document
-		str- the filename that the resulting XML should be called. 
  **/
-bool convertToXML(GPXdoc* doc, char* fileName) {
+xmlDocPtr convertToXMLDoc(GPXdoc* doc) {
 	xmlDocPtr docPtr = NULL;       /* document pointer */
 	xmlNodePtr root_node = NULL, wpt_node = NULL, rte_node = NULL, trk_node = NULL, rtept_node = NULL, trkpt_node = NULL, trkseg_node = NULL, child_node = NULL;/* node pointers */
 
-	LIBXML_TEST_VERSION;
+	initGPXParser();
 
 	/*
 	 * Creates a new document, a node and set it as a root node
@@ -378,12 +487,13 @@ bool convertToXML(GPXdoc* doc, char* fileName) {
 					child_node = xmlNewChild(wpt_node, NULL, BAD_CAST "name", BAD_CAST tmpWpt->name);
 					xmlAddChild(wpt_node, child_node);
 				}
+				addTypedChildren(wpt_node, tmpWpt);
 				if (tmpWpt->otherData != NULL) {
 					ListIterator iterOD = createIterator(tmpWpt->otherData);
 					void* elemOD;
 					while ((elemOD = nextElement(&iterOD)) != NULL) {
 						GPXData* tmpOD = (GPXData*)elemOD;
-						child_node = xmlNewChild(wpt_node, NULL, BAD_CAST tmpOD->name, BAD_CAST tmpOD->value);
+						child_node = xmlNewChild(wpt_node, NULL, BAD_CAST getGPXDataName(tmpOD), BAD_CAST tmpOD->value);
 						xmlAddChild(wpt_node, child_node);
 					}
 				}
@@ -410,7 +520,7 @@ bool convertToXML(GPXdoc* doc, char* fileName) {
 					void* elemOD;
 					while ((elemOD = nextElement(&iterOD)) != NULL) {
 						GPXData* tmpOD = (GPXData*)elemOD;
-						child_node = xmlNewChild(rte_node, NULL, BAD_CAST tmpOD->name, BAD_CAST tmpOD->value);
+						child_node = xmlNewChild(rte_node, NULL, BAD_CAST getGPXDataName(tmpOD), BAD_CAST tmpOD->value);
 						xmlAddChild(rte_node, child_node);
 					}
 				}
@@ -436,12 +546,13 @@ bool convertToXML(GPXdoc* doc, char* fileName) {
 							child_node = xmlNewChild(rtept_node, NULL, BAD_CAST "name", BAD_CAST tmpWpt2->name);
 							xmlAddChild(rtept_node, child_node);
 						}
+						addTypedChildren(rtept_node, tmpWpt2);
 						if (tmpWpt2->otherData != NULL) {
 							ListIterator iterOD = createIterator(tmpWpt2->otherData);
 							void* elemOD;
 							while ((elemOD = nextElement(&iterOD)) != NULL) {
 								GPXData* tmpOD = (GPXData*)elemOD;
-								child_node = xmlNewChild(rtept_node, NULL, BAD_CAST tmpOD->name, BAD_CAST tmpOD->value);
+								child_node = xmlNewChild(rtept_node, NULL, BAD_CAST getGPXDataName(tmpOD), BAD_CAST tmpOD->value);
 								xmlAddChild(rtept_node, child_node);
 							}
 						}
@@ -471,7 +582,7 @@ bool convertToXML(GPXdoc* doc, char* fileName) {
 					void* elemOD;
 					while ((elemOD = nextElement(&iterOD)) != NULL) {
 						GPXData* tmpOD = (GPXData*)elemOD;
-						child_node = xmlNewChild(trk_node, NULL, BAD_CAST tmpOD->name, BAD_CAST tmpOD->value);
+						child_node = xmlNewChild(trk_node, NULL, BAD_CAST getGPXDataName(tmpOD), BAD_CAST tmpOD->value);
 						xmlAddChild(trk_node, child_node);
 					}
 				}
@@ -504,12 +615,13 @@ bool convertToXML(GPXdoc* doc, char* fileName) {
 									child_node = xmlNewChild(trkpt_node, NULL, BAD_CAST "name", BAD_CAST tmpWpt3->name);
 									xmlAddChild(trkpt_node, child_node);
 								}
+								addTypedChildren(trkpt_node, tmpWpt3);
 								if (tmpWpt3->otherData != NULL) {
 									ListIterator iterOD = createIterator(tmpWpt3->otherData);
 									void* elemOD;
 									while ((elemOD = nextElement(&iterOD)) != NULL) {
 										GPXData* tmpOD = (GPXData*)elemOD;
-										child_node = xmlNewChild(trkpt_node, NULL, BAD_CAST tmpOD->name, BAD_CAST tmpOD->value);
+										child_node = xmlNewChild(trkpt_node, NULL, BAD_CAST getGPXDataName(tmpOD), BAD_CAST tmpOD->value);
 										xmlAddChild(trkpt_node, child_node);
 									}
 								}
@@ -523,6 +635,26 @@ bool convertToXML(GPXdoc* doc, char* fileName) {
 			}
 		}
 	}
+	return docPtr;
+}
+
+/** Function to convert a GPX object to XML
+ *@pre Doc Object is not NULL
+ *@post Doc object have not been modified in any way
+ *@return A Boolean based off the success
+ *@param ptr- a pointer object that points to the GPX document
+		str- the filename that the resulting XML should be called. 
+ **/
+bool convertToXML(GPXdoc* doc, char* fileName) {
+	xmlDocPtr docPtr = convertToXMLDoc(doc);
+	if (docPtr == NULL) {
+		return false;
+	}
+
+	//libxml deflates the output as it writes it
+	if (gpxFileKind(fileName) == GPX_FILE_GZIP) {
+		xmlSetDocCompressMode(docPtr, 6);
+	}
 	int num = xmlSaveFormatFileEnc(fileName, docPtr, "UTF-8", 1);
 	
 	xmlFreeDoc(docPtr);
@@ -534,7 +666,8 @@ bool convertToXML(GPXdoc* doc, char* fileName) {
 	return false;
 }
 
-/** Function to confirm the XML tree is correctly made
+/** Function to confirm the XML tree is correctly made. The schema is compiled on the first call and kept,
+ * see sharedGPXValidator, and nothing is printed.
  *@pre Strings are not NULL
  *@return A Boolean based off the success
  *@param 
@@ -542,57 +675,30 @@ bool convertToXML(GPXdoc* doc, char* fileName) {
 	str- the filename of the XML tree needing to be checked.  
  **/
 bool validateXMLTree(char* fileName, char* gpxSchemaFile) {
-	bool result = false;
-	xmlDocPtr doc;
-	xmlSchemaPtr schema = NULL;
-	xmlSchemaParserCtxtPtr ctxt;
-
-	xmlLineNumbersDefault(1);
-
-	ctxt = xmlSchemaNewParserCtxt(gpxSchemaFile);
-
-	xmlSchemaSetParserErrors(ctxt, (xmlSchemaValidityErrorFunc)fprintf, (xmlSchemaValidityWarningFunc)fprintf, stderr);
-	schema = xmlSchemaParse(ctxt);
-	xmlSchemaFreeParserCtxt(ctxt);
-
-	doc = xmlReadFile(fileName, NULL, 0);
-
-	if (doc == NULL) {
-		fprintf(stderr, "Could not parse file\n");
+	GPXValidator* validator = sharedGPXValidator(gpxSchemaFile);
+	if (validator == NULL) {
+		return false;
 	}
-	else {
-		xmlSchemaValidCtxtPtr ctxt;
-		int ret;
 
-		ctxt = xmlSchemaNewValidCtxt(schema);
-		xmlSchemaSetValidErrors(ctxt, (xmlSchemaValidityErrorFunc)fprintf, (xmlSchemaValidityWarningFunc)fprintf, stderr);
-		ret = xmlSchemaValidateDoc(ctxt, doc);
-		if (ret == 0)
-		{
-			printf("file validates\n");
-			result = true;
-		}
-		else if (ret > 0)
-		{
-			printf("file fails to validate\n");
-		}
-		else
-		{
-			printf("file validation generated an internal error\n");
-		}
-		xmlSchemaFreeValidCtxt(ctxt);
-		xmlFreeDoc(doc);
-	}
+	return validateGPXFile(validator, fileName).result == GPX_VALID;
+}
 
-	if (schema != NULL) {
-		xmlSchemaFree(schema);
+/** Function to validate an already parsed XML tree against the schema, so a file that is
+ * going to be built into a GPXdoc afterwards does not have to be parsed a second time
+ *@pre Doc and String are not NULL
+ *@return A Boolean based off the success
+ *@param 
+	ptr- the parsed XML document
+	str- a pointer object that points to the GPX schema
+ **/
+bool validateXMLDoc(xmlDocPtr doc, char* gpxSchemaFile) {
+	GPXValidation result;
+	GPXValidator* validator = sharedGPXValidator(gpxSchemaFile);
+	if (validator == NULL) {
+		return false;
 	}
 
-	xmlSchemaCleanupTypes();
-	xmlCleanupParser();
-	xmlMemoryDump();
-
-	return result;
+	return validateXMLWith(validator, doc, &result) == GPX_VALID;
 }
 
 /** Function to calculate the haversine between two points
@@ -616,6 +722,50 @@ float haversine(float lat1, float lon1, float lat2, float lon2) {
 	return distance;
 }
 
+/** Function to append a string to a growing buffer as a JSON string literal
+ *@param Ptr- the buffer, its length and its size, grown as needed
+ *@param str- the string
+ **/
+void appendJSONString(char** json, int* len, int* size, const char* str) {
+	int needed = *len + strlen(str) * 6 + 3;
+	if (needed > *size) {
+		*size = needed * 2;
+		*json = realloc(*json, sizeof(char) * *size);
+	}
+
+	char* out = *json + *len;
+	*out++ = '"';
+	for (const unsigned char* p = (const unsigned char*)str; *p != '\0'; p++) {
+		if (*p == '"' || *p == '\\') {
+			*out++ = '\\';
+			*out++ = *p;
+		}
+		else if (*p < 0x20) {
+			out = out + sprintf(out, "\\u%04x", *p);
+		}
+		else {
+			*out++ = *p;
+		}
+	}
+	*out++ = '"';
+	*out = '\0';
+	*len = out - *json;
+}
+
+/** Function to append plain text to a growing buffer
+ *@param Ptr- the buffer, its length and its size, grown as needed
+ *@param str- the text
+ **/
+void appendText(char** json, int* len, int* size, const char* str) {
+	int strLen = strlen(str);
+	if (*len + strLen + 1 > *size) {
+		*size = (*len + strLen + 1) * 2;
+		*json = realloc(*json, sizeof(char) * *size);
+	}
+	memcpy(*json + *len, str, strLen + 1);
+	*len = *len + strLen;
+}
+
 /** Function used since we always need to provide a delte function even when we dont wish to delete. 
  *@param ptr- any data pointer. 
  **/
@@ -629,18 +779,11 @@ void dummyDelete(void* data) {
  *@param ptr- the route pointer
  **/
 int numPointsRoutes(const Route* rt) {
-	ListIterator iter;
-	iter.current = rt->waypoints->head;
-	int num = 0;
-	void* elem;
-
-	if (rt != NULL) {
-		while ((elem = nextElement(&iter)) != NULL) {
-			num = num + 1;
-		}
+	if (rt == NULL) {
+		return 0;
 	}
-
-	return num;
+	//The list knows its length before a lazy route has read its points
+	return getLength(rt->waypoints);
 }
 
 /** Function to count the number of points withing a track
@@ -649,21 +792,77 @@ int numPointsRoutes(const Route* rt) {
  *@param ptr- the track pointer
  **/
 int numPointsTracks(const Track* tr) {
+	if (tr == NULL) {
+		return 0;
+	}
+
 	ListIterator iter = createIterator(tr->segments);
 	int num = 0;
 	void* elem;
 
-	if (tr != NULL) {
-		while ((elem = nextElement(&iter)) != NULL) {
-			TrackSegment* tmpTrSeg = (TrackSegment*)elem;
-			ListIterator iter2 = createIterator(tmpTrSeg->waypoints);
-			void* elem2;
+	while ((elem = nextElement(&iter)) != NULL) {
+		TrackSegment* tmpTrSeg = (TrackSegment*)elem;
+		num = num + getLength(tmpTrSeg->waypoints);
+	}
 
-			while ((elem2 = nextElement(&iter2)) != NULL) {
-				num = num + 1;
-			}
-		}
+	return num;
+}
+
+/** Function to count the GPXData of a waypoint the way getNumGPXData does: its other data, the elevation and
+ *  time whose text createCompactGPXdoc dropped, and its name when it has one
+ *@return the count
+ *@param ptr- the waypoint
+ **/
+int numWaypointData(const Waypoint* waypoint) {
+	int num = getLength(waypoint->otherData);
+	if (hasDroppedText(waypoint, GPX_DROPPED_ELE, GPX_NAME_ELE)) {
+		num++;
+	}
+	if (hasDroppedText(waypoint, GPX_DROPPED_TIME, GPX_NAME_TIME)) {
+		num++;
+	}
+	if (strcmp(waypoint->name, "") != 0) {
+		num++;
+	}
+	return num;
+}
+
+/** Function to count the GPXData of a route, its points included, by walking it
+ *@return the count
+ *@param ptr- the route
+ **/
+int numRouteData(const Route* rt) {
+	int num = getLength(rt->otherData);
+	if (strcmp(rt->name, "") != 0) {
+		num++;
 	}
 
+	ListIterator iter = createIterator(rt->waypoints);
+	void* elem;
+	while ((elem = nextElement(&iter)) != NULL) {
+		num = num + numWaypointData((Waypoint*)elem);
+	}
+	return num;
+}
+
+/** Function to count the GPXData of a track, the points of all its segments included, by walking it
+ *@return the count
+ *@param ptr- the track
+ **/
+int numTrackData(const Track* tr) {
+	int num = getLength(tr->otherData);
+	if (strcmp(tr->name, "") != 0) {
+		num++;
+	}
+
+	ListIterator iter = createIterator(tr->segments);
+	void* seg;
+	while ((seg = nextElement(&iter)) != NULL) {
+		ListIterator iter2 = createIterator(((TrackSegment*)seg)->waypoints);
+		void* elem;
+		while ((elem = nextElement(&iter2)) != NULL) {
+			num = num + numWaypointData((Waypoint*)elem);
+		}
+	}
 	return num;
-}
\ No newline at end of file
+}
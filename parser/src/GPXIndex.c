@@ -0,0 +1,844 @@
+/**
+ * Created by: Alexander Blankenstein
+ **/
+
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "GPXIndex.h"
+#include "GPXHelper.h"
+#include "GPXParser.h"
+#include "LinkedListAPI.h"
+
+//Fewest slots a filled table has
+#define GPX_INDEX_MIN_SIZE 16
+
+/** Function to free the slots of the name tables. The struct itself lives in the arena.
+ *@param Ptr- the index
+ **/
+static void freeNameIndex(void* data) {
+	GPXNameIndex* index = (GPXNameIndex*)data;
+	free(index->waypoints.slots);
+	free(index->routes.slots);
+	free(index->tracks.slots);
+	pthread_mutex_destroy(&index->lock);
+}
+
+/** Function to create the empty name index of an arena document. The tables are filled by the first lookup,
+ *  the arena frees them with the document.
+ *@return the new index
+ *@param Ptr- the arena of the document
+ **/
+GPXNameIndex* initializeNameIndex(GPXArena* arena) {
+	GPXNameIndex* index = arenaAlloc(arena, sizeof(GPXNameIndex));
+	memset(index, 0, sizeof(GPXNameIndex));
+	pthread_mutex_init(&index->lock, NULL);
+	arenaAdopt(arena, index, &freeNameIndex);
+	return index;
+}
+
+/** Function to hash a name (32 bit FNV-1a)
+ *@return the hash
+ *@param str- the name
+ **/
+static unsigned int hashName(const char* name) {
+	unsigned int hash = 2166136261u;
+	for (const unsigned char* p = (const unsigned char*)name; *p != '\0'; p++) {
+		hash = (hash ^ *p) * 16777619u;
+	}
+	return hash;
+}
+
+/** Functions to get the name of a waypoint, route or track
+ **/
+static const char* waypointName(const void* entity) {
+	return ((const Waypoint*)entity)->name;
+}
+
+static const char* routeName(const void* entity) {
+	return ((const Route*)entity)->name;
+}
+
+static const char* trackName(const void* entity) {
+	return ((const Track*)entity)->name;
+}
+
+/** Function to find the slot of a name, or the empty slot it would go in
+ *@return the slot
+ **/
+static GPXNameSlot* findSlot(const GPXNameTable* table, const char* (*nameOf)(const void*), const char* name, unsigned int hash) {
+	unsigned int mask = table->size - 1;
+	unsigned int i = hash & mask;
+	while (table->slots[i].entity != NULL) {
+		if (table->slots[i].hash == hash && strcmp(nameOf(table->slots[i].entity), name) == 0) {
+			break;
+		}
+		i = (i + 1) & mask;
+	}
+	return &table->slots[i];
+}
+
+/** Function to add an entity to a table that has room for it. An entity whose name is already in the table is
+ *  left out, so the table keeps the first one of every name.
+ **/
+static void addName(GPXNameTable* table, const char* (*nameOf)(const void*), void* entity) {
+	const char* name = nameOf(entity);
+	if (name == NULL) {
+		return;
+	}
+
+	unsigned int hash = hashName(name);
+	GPXNameSlot* slot = findSlot(table, nameOf, name, hash);
+	if (slot->entity == NULL) {
+		slot->hash = hash;
+		slot->entity = entity;
+		table->numNames++;
+	}
+}
+
+/** Function to fill a table from a list, in list order
+ **/
+static void fillTable(GPXNameTable* table, List* list, const char* (*nameOf)(const void*)) {
+	int length = getLength(list);
+	int size = GPX_INDEX_MIN_SIZE;
+	while (size < length * 2) {
+		size = size * 2;
+	}
+
+	if (size != table->size) {
+		free(table->slots);
+		table->slots = malloc(sizeof(GPXNameSlot) * size);
+		table->size = size;
+	}
+	memset(table->slots, 0, sizeof(GPXNameSlot) * size);
+	table->numNames = 0;
+
+	ListIterator iter = createIterator(list);
+	void* entity;
+	while ((entity = nextElement(&iter)) != NULL) {
+		addName(table, nameOf, entity);
+	}
+	table->filled = true;
+	table->numChanges = list->numChanges;
+}
+
+/** Function to find the first entity of a list with a name by walking the list
+ *@return the entity, NULL if there is none
+ **/
+static void* scanName(List* list, const char* (*nameOf)(const void*), const char* name) {
+	ListIterator iter = createIterator(list);
+	void* entity;
+	while ((entity = nextElement(&iter)) != NULL) {
+		const char* entityName = nameOf(entity);
+		if (entityName != NULL && strcmp(entityName, name) == 0) {
+			return entity;
+		}
+	}
+	return NULL;
+}
+
+/** Function to look a name up in a table, filling it first if the list has changed since
+ *@return the first entity of the list with the name, NULL if there is none
+ **/
+static void* findName(GPXNameIndex* index, GPXNameTable* table, List* list, const char* (*nameOf)(const void*), const char* name) {
+	pthread_mutex_lock(&index->lock);
+	if (!table->filled || table->numChanges != list->numChanges) {
+		fillTable(table, list, nameOf);
+	}
+
+	//findSlot checks the name an entity has now, so an entity renamed in place since the table was filled is
+	//not returned under its old name. It is not found under its new one either, nor is an entity the table left
+	//out for having the same name as it, so a name that is not found is looked for in the list, and the table is
+	//filled again when it is there.
+	GPXNameSlot* slot = findSlot(table, nameOf, name, hashName(name));
+	void* entity = slot->entity;
+	if (entity == NULL) {
+		entity = scanName(list, nameOf, name);
+		if (entity != NULL) {
+			fillTable(table, list, nameOf);
+		}
+	}
+	pthread_mutex_unlock(&index->lock);
+	return entity;
+}
+
+/** Function to find the first waypoint of a document with a name, through the name index of the document.
+ *  The first lookup fills the index, and adding, removing or reordering waypoints fills it again. A name that
+ *  is not in the index is looked for in the list, which finds names changed in place since.
+ *@pre doc and name are not NULL
+ *@return the waypoint, NULL if there is none
+ *@param Ptr- the document
+ *@param str- the name
+ **/
+Waypoint* findNamedWaypoint(const GPXdoc* doc, const char* name) {
+	if (doc->names == NULL) {
+		return findElement(doc->waypoints, &compareWaypointsBool, name);
+	}
+	return findName(doc->names, &doc->names->waypoints, doc->waypoints, &waypointName, name);
+}
+
+/** Function to find the first route of a document with a name, like findNamedWaypoint
+ *@pre doc and name are not NULL
+ *@return the route, NULL if there is none
+ *@param Ptr- the document
+ *@param str- the name
+ **/
+Route* findNamedRoute(const GPXdoc* doc, const char* name) {
+	if (doc->names == NULL) {
+		return findElement(doc->routes, &compareRoutesBool, name);
+	}
+	return findName(doc->names, &doc->names->routes, doc->routes, &routeName, name);
+}
+
+/** Function to find the first track of a document with a name, like findNamedWaypoint
+ *@pre doc and name are not NULL
+ *@return the track, NULL if there is none
+ *@param Ptr- the document
+ *@param str- the name
+ **/
+Track* findNamedTrack(const GPXdoc* doc, const char* name) {
+	if (doc->names == NULL) {
+		return findElement(doc->tracks, &compareTracksBool, name);
+	}
+	return findName(doc->names, &doc->names->tracks, doc->tracks, &trackName, name);
+}
+
+/** Function to add a route that was just put at the end of the routes of a document to their name table, so
+ *  the table does not have to be filled again. A table that is not filled or has no room is left to the next
+ *  lookup.
+ *@pre rt is the last route of doc
+ *@param Ptr- the document
+ *@param Ptr- the route
+ **/
+void addNamedRoute(GPXdoc* doc, Route* rt) {
+	if (doc->names == NULL) {
+		return;
+	}
+
+	GPXNameTable* table = &doc->names->routes;
+	if (!table->filled || table->numChanges + 1 != doc->routes->numChanges) {
+		return;
+	}
+	if ((table->numNames + 1) * 2 > table->size) {
+		table->filled = false;
+		return;
+	}
+	addName(table, &routeName, rt);
+	table->numChanges++;
+}
+
+/* ******************************* End point grid *************************** */
+
+//Radius of the earth haversine measures with, in meters
+#define GPX_EARTH_RADIUS 6371e3
+
+//Fewest degrees of latitude in a row
+#define GPX_MIN_ROW_HEIGHT 1e-6
+
+//Latitude and longitude ranges that hold every point within a distance of a query point
+typedef struct {
+	int loRow;
+	int hiRow;
+	int numRanges;
+	double lo[2];
+	double hi[2];
+} GPXEndQuery;
+
+/** Function to free the arrays of a grid
+ **/
+static void freeEndGrid(GPXEndGrid* grid) {
+	free(grid->entries);
+	free(grid->rowIds);
+	free(grid->rowStarts);
+}
+
+/** Function to free the arrays of an end point table, not the table itself
+ *@param Ptr- the table
+ **/
+void freeEndTable(GPXEndTable* table) {
+	free(table->entities);
+	free(table->points);
+	free(table->endPoints);
+	free(table->outside);
+	freeEndGrid(&table->starts);
+	freeEndGrid(&table->ends);
+}
+
+/** Function to free the tables of an end point index. The struct itself lives in the arena.
+ *@param Ptr- the index
+ **/
+static void freeEndIndex(void* data) {
+	GPXEndIndex* index = (GPXEndIndex*)data;
+	freeEndTable(&index->routes);
+	freeEndTable(&index->tracks);
+	pthread_mutex_destroy(&index->lock);
+}
+
+/** Function to create the empty end point index of an arena document. The tables are filled by the first query,
+ *  the arena frees them with the document.
+ *@return the new index
+ *@param Ptr- the arena of the document
+ **/
+GPXEndIndex* initializeEndIndex(GPXArena* arena) {
+	GPXEndIndex* index = arenaAlloc(arena, sizeof(GPXEndIndex));
+	memset(index, 0, sizeof(GPXEndIndex));
+	pthread_mutex_init(&index->lock, NULL);
+	arenaAdopt(arena, index, &freeEndIndex);
+	return index;
+}
+
+/** Function to get the first and last point of a route. They are read off the waypoints, which can be changed in
+ *  place, unless the points of a lazy document were not read yet, then the totals read from the file have them.
+ *@return false if the route has no points
+ *@param Ptr- the route
+ *@param Ptr- the points, first lat, first lon, last lat, last lon
+ *@param Ptr- set to the first and last waypoint, or to NULL when the points came from the totals
+ **/
+static bool routeEnds(const Route* rt, float points[4], const Waypoint* ends[2]) {
+	int numPoints = rt->waypoints != NULL ? getLength(rt->waypoints) : 0;
+	if (numPoints == 0) {
+		return false;
+	}
+
+	if (!isListLoaded(rt->waypoints) && rt->totals != NULL && rt->totals->numPoints == numPoints) {
+		points[0] = rt->totals->firstLat;
+		points[1] = rt->totals->firstLon;
+		points[2] = rt->totals->lastLat;
+		points[3] = rt->totals->lastLon;
+		ends[0] = NULL;
+		ends[1] = NULL;
+	}
+	else {
+		ends[0] = getFromFront(rt->waypoints);
+		ends[1] = getFromBack(rt->waypoints);
+		points[0] = ends[0]->latitude;
+		points[1] = ends[0]->longitude;
+		points[2] = ends[1]->latitude;
+		points[3] = ends[1]->longitude;
+	}
+	return true;
+}
+
+/** Function to get the first point of the first segment and the last point of the last segment of a track, like
+ *  routeEnds
+ *@return false if the track has no segments, or its first or last segment has no points
+ **/
+static bool trackEnds(const Track* tr, float points[4], const Waypoint* ends[2]) {
+	if (tr->segments == NULL || getLength(tr->segments) == 0) {
+		return false;
+	}
+
+	const TrackSegment* firstSeg = getFromFront(tr->segments);
+	const TrackSegment* lastSeg = getFromBack(tr->segments);
+	if (getLength(firstSeg->waypoints) == 0 || getLength(lastSeg->waypoints) == 0) {
+		return false;
+	}
+
+	//Once either end segment has read its points, they can have been moved in place
+	bool loaded = isListLoaded(firstSeg->waypoints) || isListLoaded(lastSeg->waypoints);
+	if (!loaded && tr->totals != NULL && tr->totals->numPoints == numPointsTracks(tr)) {
+		points[0] = tr->totals->firstLat;
+		points[1] = tr->totals->firstLon;
+		points[2] = tr->totals->lastLat;
+		points[3] = tr->totals->lastLon;
+		ends[0] = NULL;
+		ends[1] = NULL;
+	}
+	else {
+		ends[0] = getFromFront(firstSeg->waypoints);
+		ends[1] = getFromBack(lastSeg->waypoints);
+		points[0] = ends[0]->latitude;
+		points[1] = ends[0]->longitude;
+		points[2] = ends[1]->latitude;
+		points[3] = ends[1]->longitude;
+	}
+	return true;
+}
+
+/** Function to get the first and last point of a route, read off its waypoints, or its totals while a lazy
+ *  document has not read them
+ *@return false if the route has no points
+ *@param Ptr- the route
+ *@param Ptr- the points, first lat, first lon, last lat, last lon
+ **/
+bool getRouteEnds(const Route* rt, float points[4]) {
+	const Waypoint* ends[2];
+	return routeEnds(rt, points, ends);
+}
+
+/** Function to get the first point of the first segment and the last point of the last segment of a track, like
+ *  getRouteEnds
+ *@return false if the track has no segments, or its first or last segment has no points
+ *@param Ptr- the track
+ *@param Ptr- the points, first lat, first lon, last lat, last lon
+ **/
+bool getTrackEnds(const Track* tr, float points[4]) {
+	const Waypoint* ends[2];
+	return trackEnds(tr, points, ends);
+}
+
+/** Function to tell if a point can go on a grid
+ *@return true for a real latitude and a finite longitude
+ **/
+static bool onGrid(double lat, double lon) {
+	return isfinite(lat) && isfinite(lon) && lat >= -90.0 && lat <= 90.0;
+}
+
+/** Function to move a longitude into [-180, 180), where haversine sees it the same
+ **/
+static double wrapLon(double lon) {
+	double wrapped = lon - 360.0 * floor((lon + 180.0) / 360.0);
+	return wrapped < 180.0 ? wrapped : -180.0;
+}
+
+/** Function to get the row of a latitude
+ **/
+static int rowOf(const GPXEndTable* table, double lat) {
+	return (int)floor((lat + 90.0) / table->rowHeight);
+}
+
+/** Function to order grid entries by row, then longitude
+ **/
+static int compareEntries(const void* first, const void* second) {
+	const GPXEndEntry* a = (const GPXEndEntry*)first;
+	const GPXEndEntry* b = (const GPXEndEntry*)second;
+	if (a->row != b->row) {
+		return a->row < b->row ? -1 : 1;
+	}
+	if (a->lon != b->lon) {
+		return a->lon < b->lon ? -1 : 1;
+	}
+	return a->pos - b->pos;
+}
+
+/** Function to order list positions
+ **/
+static int comparePositions(const void* first, const void* second) {
+	return *(const int*)first - *(const int*)second;
+}
+
+/** Function to fill a grid with the start or end points of a table
+ *@param Ptr- the grid
+ *@param Ptr- the table, with its entities, points and row height filled
+ *@param int- 0 for the start points, 2 for the end points
+ **/
+static void fillEndGrid(GPXEndGrid* grid, const GPXEndTable* table, int which) {
+	grid->entries = realloc(grid->entries, sizeof(GPXEndEntry) * (table->numEntities > 0 ? table->numEntities : 1));
+	grid->numEntries = 0;
+	for (int pos = 0; pos < table->numEntities; pos++) {
+		const float* points = table->points + pos * 4;
+		if (table->entities[pos] == NULL || !onGrid(points[0], points[1]) || !onGrid(points[2], points[3])) {
+			continue;
+		}
+		GPXEndEntry* entry = &grid->entries[grid->numEntries++];
+		entry->row = rowOf(table, points[which]);
+		entry->lon = wrapLon(points[which + 1]);
+		entry->pos = pos;
+	}
+	qsort(grid->entries, grid->numEntries, sizeof(GPXEndEntry), &compareEntries);
+
+	grid->rowIds = realloc(grid->rowIds, sizeof(int) * (grid->numEntries + 1));
+	grid->rowStarts = realloc(grid->rowStarts, sizeof(int) * (grid->numEntries + 1));
+	grid->numRows = 0;
+	for (int i = 0; i < grid->numEntries; i++) {
+		if (i == 0 || grid->entries[i].row != grid->entries[i - 1].row) {
+			grid->rowIds[grid->numRows] = grid->entries[i].row;
+			grid->rowStarts[grid->numRows] = i;
+			grid->numRows++;
+		}
+	}
+	grid->rowStarts[grid->numRows] = grid->numEntries;
+}
+
+/** Function to make room in an end point table for a number of entities
+ **/
+static void resizeEndTable(GPXEndTable* table, int numEntities) {
+	int size = numEntities > 0 ? numEntities : 1;
+	table->entities = realloc(table->entities, sizeof(void*) * size);
+	table->points = realloc(table->points, sizeof(float) * 4 * size);
+	table->endPoints = realloc(table->endPoints, sizeof(Waypoint*) * 2 * size);
+	table->outside = realloc(table->outside, sizeof(int) * size);
+	table->sizeOutside = size;
+	table->numEntities = numEntities;
+}
+
+/** Function to add a position to the points that are always measured
+ **/
+static void addOutside(GPXEndTable* table, int pos) {
+	if (table->numOutside == table->sizeOutside) {
+		table->sizeOutside = table->sizeOutside * 2;
+		table->outside = realloc(table->outside, sizeof(int) * table->sizeOutside);
+	}
+	table->outside[table->numOutside++] = pos;
+}
+
+/** Function to work out the points off the grids and the row height of a table whose entities and points are
+ *  filled. The grids are made by the second query.
+ **/
+static void placeEnds(GPXEndTable* table) {
+	double minLat = 90.0;
+	double maxLat = -90.0;
+	int numOnGrid = 0;
+
+	table->numOutside = 0;
+	table->numMoved = 0;
+	for (int pos = 0; pos < table->numEntities; pos++) {
+		const float* points = table->points + pos * 4;
+		if (table->entities[pos] == NULL) {
+			continue;
+		}
+		if (onGrid(points[0], points[1]) && onGrid(points[2], points[3])) {
+			minLat = fmin(minLat, fmin(points[0], points[2]));
+			maxLat = fmax(maxLat, fmax(points[0], points[2]));
+			numOnGrid++;
+		}
+		else {
+			table->outside[table->numOutside++] = pos;
+		}
+	}
+
+	//About as many rows as points in a row, over the latitudes the points cover
+	table->rowHeight = 1.0;
+	if (numOnGrid > 0 && maxLat > minLat) {
+		table->rowHeight = fmax((maxLat - minLat) / ceil(sqrt(numOnGrid)), GPX_MIN_ROW_HEIGHT);
+	}
+	table->hasGrids = false;
+	table->numQueries = 0;
+}
+
+/** Function to fill an end point table from a list, in list order
+ *@param Ptr- the table
+ *@param Ptr- the routes or tracks
+ *@param bool- true for tracks
+ *@param int- the number of changes the arena of the document has seen
+ **/
+static void fillEndTable(GPXEndTable* table, List* list, bool tracks, unsigned int numDocChanges) {
+	int length = getLength(list);
+	resizeEndTable(table, length);
+
+	ListIterator iter = createIterator(list);
+	void* entity;
+	int pos = 0;
+	while ((entity = nextElement(&iter)) != NULL) {
+		float* points = table->points + pos * 4;
+		const Waypoint** ends = table->endPoints + pos * 2;
+		bool hasEnds = tracks ? trackEnds((Track*)entity, points, ends) : routeEnds((Route*)entity, points, ends);
+		table->entities[pos] = hasEnds ? entity : NULL;
+		pos++;
+	}
+	placeEnds(table);
+
+	table->filled = true;
+	table->numChanges = list->numChanges;
+	table->numDocChanges = numDocChanges;
+}
+
+/** Function to record that the first or last point of a route or track has moved since the grids were made
+ **/
+static void moveEnds(GPXEndTable* table, int pos, void* entity, const float points[4]) {
+	table->entities[pos] = entity;
+	if (entity != NULL) {
+		memcpy(table->points + pos * 4, points, sizeof(float) * 4);
+	}
+	addOutside(table, pos);
+	table->numMoved++;
+}
+
+/** Function to bring the points of a filled table up to date with its routes or tracks. While no list of the
+ *  document has changed, the first and last waypoints are the ones the table was filled from and only their
+ *  coordinates are compared, as they can be changed in place. Otherwise the first and last waypoints of every
+ *  route or track are found again. Nothing is measured. A route or track whose points moved is measured by
+ *  every query from then on, the grids keep it at its old place.
+ *@return false once so many have moved that the table is better filled again
+ *@param Ptr- the table
+ *@param Ptr- the routes or tracks it was filled from
+ *@param bool- true for tracks
+ *@param int- the number of changes the arena of the document has seen
+ **/
+static bool sweepEndTable(GPXEndTable* table, List* list, bool tracks, unsigned int numDocChanges) {
+	float points[4];
+
+	if (table->numDocChanges == numDocChanges) {
+		//Without a change to a list, only the coordinates of the same two waypoints can have changed
+		for (int pos = 0; pos < table->numEntities; pos++) {
+			void* entity = table->entities[pos];
+			const Waypoint** ends = table->endPoints + pos * 2;
+			if (entity == NULL) {
+				continue;
+			}
+			if (ends[0] == NULL) {
+				//The points came from the totals of a lazy list, which may have been read since
+				tracks ? trackEnds((Track*)entity, points, ends) : routeEnds((Route*)entity, points, ends);
+			}
+			else {
+				points[0] = ends[0]->latitude;
+				points[1] = ends[0]->longitude;
+				points[2] = ends[1]->latitude;
+				points[3] = ends[1]->longitude;
+			}
+			if (memcmp(table->points + pos * 4, points, sizeof(points)) != 0) {
+				moveEnds(table, pos, entity, points);
+			}
+		}
+	}
+	else {
+		ListIterator iter = createIterator(list);
+		void* entity;
+		int pos = 0;
+		while ((entity = nextElement(&iter)) != NULL) {
+			const Waypoint** ends = table->endPoints + pos * 2;
+			bool hasEnds = tracks ? trackEnds((Track*)entity, points, ends) : routeEnds((Route*)entity, points, ends);
+			if (table->entities[pos] != (hasEnds ? entity : NULL) || (hasEnds && memcmp(table->points + pos * 4, points, sizeof(points)) != 0)) {
+				moveEnds(table, pos, hasEnds ? entity : NULL, points);
+			}
+			pos++;
+		}
+		table->numDocChanges = numDocChanges;
+	}
+
+	return table->numMoved <= table->numEntities / 8 + 16;
+}
+
+/** Function to fill an end point table from arrays of entities and their points, for tables that are not kept
+ *  by a document
+ *@param Ptr- the table, zeroed before its first fill
+ *@param Ptr- the entities, NULL for ones without end points
+ *@param Ptr- their points, first lat, first lon, last lat, last lon for every entity
+ *@param int- the number of entities
+ **/
+void fillEndTableWith(GPXEndTable* table, void* const* entities, const float* points, int numEntities) {
+	resizeEndTable(table, numEntities);
+	memcpy(table->entities, entities, sizeof(void*) * numEntities);
+	memcpy(table->points, points, sizeof(float) * 4 * numEntities);
+	placeEnds(table);
+	table->filled = true;
+}
+
+/** Function to work out the rows and longitudes to look at for the points within a distance of a query point.
+ *  The distance is made a little larger, so a point haversine puts within it is never left out by rounding.
+ *@return false if the query point or distance cannot be looked up on a grid
+ **/
+static bool makeEndQuery(const GPXEndTable* table, float lat, float lon, float delta, GPXEndQuery* query) {
+	if (!onGrid(lat, lon) || !isfinite(delta)) {
+		return false;
+	}
+
+	double pi = 3.141592653589793;
+	double radius = (delta * (1.0 + 1e-6) + 1.0) / GPX_EARTH_RADIUS;
+	double radiusDeg = radius * 180.0 / pi;
+	double loLat = lat - radiusDeg;
+	double hiLat = lat + radiusDeg;
+
+	query->loRow = rowOf(table, fmax(loLat, -90.0));
+	query->hiRow = rowOf(table, fmin(hiLat, 90.0));
+
+	//Every longitude when the circle reaches a pole, otherwise the widest it gets at its latitude
+	double spanDeg = 180.0;
+	if (loLat > -90.0 && hiLat < 90.0 && radius < pi / 2) {
+		double ratio = sin(radius) / cos(lat * pi / 180.0);
+		if (ratio < 1.0) {
+			spanDeg = asin(ratio) * 180.0 / pi + 1e-9;
+		}
+	}
+
+	if (spanDeg >= 180.0) {
+		query->numRanges = 1;
+		query->lo[0] = -180.0;
+		query->hi[0] = 180.0;
+	}
+	else {
+		double lo = wrapLon(lon - spanDeg);
+		double hi = lo + 2 * spanDeg;
+		query->lo[0] = lo;
+		query->hi[0] = fmin(hi, 180.0);
+		query->numRanges = 1;
+		if (hi >= 180.0) {
+			query->lo[1] = -180.0;
+			query->hi[1] = hi - 360.0;
+			query->numRanges = 2;
+		}
+	}
+	return true;
+}
+
+/** Function to find the first entry of a row from an index on with a longitude of at least lon
+ **/
+static int firstFrom(const GPXEndGrid* grid, int start, int end, double lon) {
+	while (start < end) {
+		int mid = start + (end - start) / 2;
+		if (grid->entries[mid].lon < lon) {
+			start = mid + 1;
+		}
+		else {
+			end = mid;
+		}
+	}
+	return start;
+}
+
+/** Function to find the entries of a grid inside a query
+ *@return the number of entries
+ *@param Ptr- the grid
+ *@param Ptr- the query
+ *@param Ptr- where to put their positions, or NULL to only count them
+ **/
+static int walkEndGrid(const GPXEndGrid* grid, const GPXEndQuery* query, int* positions) {
+	int lo = 0;
+	int hi = grid->numRows;
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (grid->rowIds[mid] < query->loRow) {
+			lo = mid + 1;
+		}
+		else {
+			hi = mid;
+		}
+	}
+
+	int count = 0;
+	for (int row = lo; row < grid->numRows && grid->rowIds[row] <= query->hiRow; row++) {
+		for (int r = 0; r < query->numRanges; r++) {
+			int start = firstFrom(grid, grid->rowStarts[row], grid->rowStarts[row + 1], query->lo[r]);
+			for (int i = start; i < grid->rowStarts[row + 1] && grid->entries[i].lon <= query->hi[r]; i++) {
+				if (positions != NULL) {
+					positions[count] = grid->entries[i].pos;
+				}
+				count++;
+			}
+		}
+	}
+	return count;
+}
+
+/** Function to measure one route or track the way getRoutesBetween always has, and add it if it matches
+ **/
+static void checkEnds(const GPXEndTable* table, int pos, float sourceLat, float sourceLong, float destLat, float destLong, float delta, List* found) {
+	if (table->entities[pos] == NULL) {
+		return;
+	}
+
+	const float* points = table->points + pos * 4;
+	float sourceDist = haversine(points[0], points[1], sourceLat, sourceLong);
+	float destDist = haversine(points[2], points[3], destLat, destLong);
+	if (sourceDist <= delta && destDist <= delta) {
+		insertBack(found, table->entities[pos]);
+	}
+}
+
+/** Function to find the entities of a table that start within delta of the source and end within delta of the
+ *  destination. Only the points on the start or end grid near their query point (whichever are fewer) and the
+ *  points off the grids are measured, in table order. The first query after the table is filled measures every
+ *  point.
+ *@pre the table is filled, delta is not negative
+ *@param Ptr- the table
+ *@param float- the source latitude and longitude
+ *@param float- the destination latitude and longitude
+ *@param float- the most a first or last point may be from the source or destination, in meters
+ *@param Ptr- the list to add the entities to
+ **/
+void findEndsBetween(GPXEndTable* table, float sourceLat, float sourceLong, float destLat, float destLong, float delta, List* found) {
+	if (table->numQueries > 0 && !table->hasGrids) {
+		fillEndGrid(&table->starts, table, 0);
+		fillEndGrid(&table->ends, table, 2);
+		table->hasGrids = true;
+	}
+	table->numQueries++;
+
+	GPXEndQuery sourceQuery;
+	GPXEndQuery destQuery;
+	bool hasSource = table->hasGrids && makeEndQuery(table, sourceLat, sourceLong, delta, &sourceQuery);
+	bool hasDest = table->hasGrids && makeEndQuery(table, destLat, destLong, delta, &destQuery);
+	if (!hasSource && !hasDest) {
+		for (int pos = 0; pos < table->numEntities; pos++) {
+			checkEnds(table, pos, sourceLat, sourceLong, destLat, destLong, delta, found);
+		}
+		return;
+	}
+
+	int numSource = hasSource ? walkEndGrid(&table->starts, &sourceQuery, NULL) : -1;
+	int numDest = hasDest ? walkEndGrid(&table->ends, &destQuery, NULL) : -1;
+	bool useSource = hasSource && (!hasDest || numSource <= numDest);
+	int numCandidates = useSource ? numSource : numDest;
+
+	int* positions = malloc(sizeof(int) * (numCandidates + table->numOutside + 1));
+	if (useSource) {
+		walkEndGrid(&table->starts, &sourceQuery, positions);
+	}
+	else {
+		walkEndGrid(&table->ends, &destQuery, positions);
+	}
+	memcpy(positions + numCandidates, table->outside, sizeof(int) * table->numOutside);
+	numCandidates = numCandidates + table->numOutside;
+	qsort(positions, numCandidates, sizeof(int), &comparePositions);
+
+	//A point that moved can be both on a grid and outside
+	for (int i = 0; i < numCandidates; i++) {
+		if (i == 0 || positions[i] != positions[i - 1]) {
+			checkEnds(table, positions[i], sourceLat, sourceLong, destLat, destLong, delta, found);
+		}
+	}
+	free(positions);
+}
+
+/** Function to find the routes or tracks of a document list between two points, filling the table first if the
+ *  list has changed since, or bringing its points up to date otherwise
+ **/
+static void findBetween(const GPXdoc* doc, GPXEndTable* table, List* list, bool tracks, float sourceLat, float sourceLong, float destLat, float destLong, float delta, List* found) {
+	unsigned int numDocChanges = arenaChanges(doc->arena);
+	pthread_mutex_lock(&doc->ends->lock);
+	if (!table->filled || table->numChanges != list->numChanges || !sweepEndTable(table, list, tracks, numDocChanges)) {
+		fillEndTable(table, list, tracks, numDocChanges);
+	}
+	findEndsBetween(table, sourceLat, sourceLong, destLat, destLong, delta, found);
+	pthread_mutex_unlock(&doc->ends->lock);
+}
+
+/** Function to find the routes of a document from a source to a destination, through the end point index of the
+ *  document. The first query fills the index, and adding, removing or reordering routes fills it again. Every
+ *  query reads the first and last point of every route to catch points changed in place, only the ones near
+ *  the source or destination (and the ones that changed) are measured. Routes without points are left out.
+ *@pre doc and found are not NULL, delta is not negative
+ *@param Ptr- the document
+ *@param float- the source latitude and longitude
+ *@param float- the destination latitude and longitude
+ *@param float- the most a first or last point may be from the source or destination, in meters
+ *@param Ptr- the list to add the routes to, in document order
+ **/
+void findRoutesBetween(const GPXdoc* doc, float sourceLat, float sourceLong, float destLat, float destLong, float delta, List* found) {
+	if (doc->ends == NULL) {
+		GPXEndTable table;
+		memset(&table, 0, sizeof(GPXEndTable));
+		fillEndTable(&table, doc->routes, false, 0);
+		for (int pos = 0; pos < table.numEntities; pos++) {
+			checkEnds(&table, pos, sourceLat, sourceLong, destLat, destLong, delta, found);
+		}
+		freeEndTable(&table);
+		return;
+	}
+	findBetween(doc, &doc->ends->routes, doc->routes, false, sourceLat, sourceLong, destLat, destLong, delta, found);
+}
+
+/** Function to find the tracks of a document from a source to a destination, like findRoutesBetween. Tracks
+ *  without segments, or whose first or last segment has no points, are left out.
+ *@pre doc and found are not NULL, delta is not negative
+ *@param Ptr- the document
+ *@param float- the source latitude and longitude
+ *@param float- the destination latitude and longitude
+ *@param float- the most a first or last point may be from the source or destination, in meters
+ *@param Ptr- the list to add the tracks to, in document order
+ **/
+void findTracksBetween(const GPXdoc* doc, float sourceLat, float sourceLong, float destLat, float destLong, float delta, List* found) {
+	if (doc->ends == NULL) {
+		GPXEndTable table;
+		memset(&table, 0, sizeof(GPXEndTable));
+		fillEndTable(&table, doc->tracks, true, 0);
+		for (int pos = 0; pos < table.numEntities; pos++) {
+			checkEnds(&table, pos, sourceLat, sourceLong, destLat, destLong, delta, found);
+		}
+		freeEndTable(&table);
+		return;
+	}
+	findBetween(doc, &doc->ends->tracks, doc->tracks, true, sourceLat, sourceLong, destLat, destLong, delta, found);
+}
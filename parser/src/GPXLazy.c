@@ -0,0 +1,185 @@
+/**
+ * Created by: Alexander Blankenstein
+ **/
+
+#define _DEFAULT_SOURCE
+
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "GPXLazy.h"
+#include "GPXParser.h"
+#include "GPXBuilder.h"
+#include "GPXScanner.h"
+#include "GPXHelper.h"
+#include "GPXArena.h"
+
+/** Function to note the file a lazy document is read from
+ *@return the new file, out of the arena
+ *@param Ptr- the arena of the document
+ *@param str- the name of the file
+ *@param int- the size of the file
+ *@param int- the modification time of the file in nanoseconds
+ **/
+GPXLazyFile* initializeLazyFile(GPXArena* arena, const char* fileName, long long size, long long modified) {
+	GPXLazyFile* file = arenaAlloc(arena, sizeof(GPXLazyFile));
+	memset(file, 0, sizeof(GPXLazyFile));
+	file->fileName = arenaString(arena, fileName, strlen(fileName));
+	file->size = size;
+	file->modified = modified;
+	return file;
+}
+
+/** Function to allocate the location of a route or track segment in a lazy document's file
+ *@return the new part, out of the arena
+ *@param Ptr- the arena of the document
+ *@param Ptr- the file the part is in
+ **/
+GPXLazyPart* initializeLazyPart(GPXArena* arena, GPXLazyFile* file) {
+	GPXLazyPart* part = arenaAlloc(arena, sizeof(GPXLazyPart));
+	memset(part, 0, sizeof(GPXLazyPart));
+	part->file = file;
+	return part;
+}
+
+/** Function to read the bytes of a part, after the start tags it is inside of
+ *@return the bytes, or NULL if the file is gone or is no longer the one the document was read from
+ **/
+static char* readPart(const GPXLazyPart* part, long* len) {
+	const GPXLazyFile* file = part->file;
+	struct stat info;
+
+	int fd = open(file->fileName, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+	if (fstat(fd, &info) != 0 || info.st_size != file->size || gpxFileModified(&info) != file->modified) {
+		close(fd);
+		return NULL;
+	}
+
+	long partLen = part->end - part->start;
+	*len = file->rootLen + part->outerLen + partLen;
+	char* buffer = malloc(sizeof(char) * *len);
+
+	bool ok = readFileAt(fd, buffer, file->rootLen, file->rootStart)
+		&& readFileAt(fd, buffer + file->rootLen, part->outerLen, part->outerStart)
+		&& readFileAt(fd, buffer + file->rootLen + part->outerLen, partLen, part->start);
+	close(fd);
+
+	if (!ok) {
+		free(buffer);
+		return NULL;
+	}
+	return buffer;
+}
+
+/** Function to add the points of a route or track segment of a lazy document to its waypoint list, reading them
+ *  from the file. Meant for setListLoader. If the file has changed since the document was made, the list stays empty.
+ *@param Ptr- the waypoint list, its pool is the arena of the document
+ *@param Ptr- the GPXLazyPart it was given
+ **/
+void loadLazyPart(List* list, void* source) {
+	GPXLazyPart* part = source;
+	GPXArena* arena = list->pool;
+	long len = 0;
+
+	if (arena == NULL) {
+		return;
+	}
+	char* buffer = readPart(part, &len);
+	if (buffer == NULL) {
+		return;
+	}
+
+	//The part is built on its own, straight out of the document's arena, then its points are moved over
+	GPXdoc* partDoc = initializeSharedGPXdoc(arena);
+	GPXBuilder builder;
+	GPXScanner scanner;
+	initializeBuilder(&builder, partDoc);
+	initializeScanner(&scanner, &builder);
+
+	bool ok = scanGPXPrefix(&scanner, buffer, len, false) == len;
+
+	clearScanner(&scanner);
+	clearBuilder(&builder);
+	free(buffer);
+
+	List* waypoints = NULL;
+	PointColumns* columns = NULL;
+	if (ok && part->outerLen == 0 && getLength(partDoc->routes) == 1) {
+		Route* route = getFromFront(partDoc->routes);
+		waypoints = route->waypoints;
+		columns = route->columns;
+	}
+	else if (ok && part->outerLen > 0 && getLength(partDoc->tracks) == 1) {
+		Track* track = getFromFront(partDoc->tracks);
+		if (getLength(track->segments) == 1) {
+			TrackSegment* segment = getFromFront(track->segments);
+			waypoints = segment->waypoints;
+			columns = segment->columns;
+		}
+	}
+
+	if (waypoints == NULL) {
+		return;
+	}
+	appendList(list, waypoints);
+	if (part->columns != NULL) {
+		*part->columns = columns;
+	}
+}
+
+/** Function to build a lazy GPX document by mapping a file into memory and tokenizing it once. Routes and track
+ *  segments that are children of the root and of a track get their names, data, point counts and lengths, and a
+ *  loader in place of their points.
+ *@return the new document, or NULL when handled is set to false
+ *@param str- the name of the GPX file
+ *@param Ptr- set to false if the file could not be read this way
+ **/
+GPXdoc* scanLazyGPXFile(char* fileName, bool* handled) {
+	struct stat info;
+
+	*handled = false;
+	int fd = open(fileName, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+	if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0) {
+		close(fd);
+		return NULL;
+	}
+	char* buffer = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (buffer == MAP_FAILED) {
+		return NULL;
+	}
+	madvise(buffer, info.st_size, MADV_SEQUENTIAL);
+
+	GPXBuilder builder;
+	GPXScanner scanner;
+	GPXdoc* tmpDoc = initializeGPXdoc();
+	initializeBuilder(&builder, tmpDoc);
+	builder.lazy = initializeLazyFile(tmpDoc->arena, fileName, info.st_size, gpxFileModified(&info));
+	builder.base = buffer;
+	initializeScanner(&scanner, &builder);
+
+	bool ok = scanGPXBuffer(&scanner, buffer, info.st_size);
+
+	clearScanner(&scanner);
+	clearBuilder(&builder);
+	munmap(buffer, info.st_size);
+
+	if (!ok) {
+		deleteGPXdoc(tmpDoc);
+		return NULL;
+	}
+	*handled = true;
+	return tmpDoc;
+}
@@ -0,0 +1,46 @@
+/**
+ * Created by: Alexander Blankenstein
+ **/
+
+#include <stdbool.h>
+#include <pthread.h>
+#include <libxml/parser.h>
+
+#include "GPXParser.h"
+#include "GPXHelper.h"
+
+static pthread_once_t initOnce = PTHREAD_ONCE_INIT;
+static pthread_mutex_t cleanupLock = PTHREAD_MUTEX_INITIALIZER;
+static bool cleanedUp = false;
+
+/** Function that sets up libxml, run once for the whole process
+ **/
+static void initLibrary(void) {
+	xmlInitParser();
+	LIBXML_TEST_VERSION
+}
+
+/** Function to set up the library before it is used. It can be called from any thread, any number of times,
+ *  and every entry point that uses libxml calls it on its own. Calling it first from the main thread only
+ *  makes sure the set up does not happen inside a worker.
+ **/
+void initGPXParser(void) {
+	pthread_once(&initOnce, initLibrary);
+}
+
+/** Function to free what the library keeps for the whole process: the compiled schemas shared by
+ *  createValidGPXdoc, validateGPXDoc and the other validating calls, the directories findPathsToJSON keeps and
+ *  the globals of libxml.
+ *  Call it once, after the last thread using the library is done. Documents that are still held stay valid,
+ *  but no function of the library can be used afterwards.
+ **/
+void cleanupGPXParser(void) {
+	pthread_mutex_lock(&cleanupLock);
+	if (!cleanedUp) {
+		cleanedUp = true;
+		freeSharedGPXValidators();
+		freeSharedGPXCorpora();
+		xmlCleanupParser();
+	}
+	pthread_mutex_unlock(&cleanupLock);
+}
@@ -0,0 +1,96 @@
+/**
+ * Created by: Alexander Blankenstein
+ **/
+
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "GPXNames.h"
+
+static const char* const builtinNames[] = { "name","desc","rtept","trkseg","trkpt","ele","time" };
+
+#define NUM_BUILTIN ((int)(sizeof(builtinNames) / sizeof(builtinNames[0])))
+
+//Added names go in fixed size chunks that never move, so a string handed out stays valid
+#define CHUNK_SIZE 256
+#define MAX_CHUNKS 256
+
+static char** addedNames[MAX_CHUNKS];
+static int numAdded = 0;
+static pthread_mutex_t namesLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** Function to find a name among the built in ones
+ *@return the id, or -1
+ **/
+static int findBuiltin(const char* name, int len) {
+	for (int i = 0; i < NUM_BUILTIN; i++) {
+		if ((int)strlen(builtinNames[i]) == len && memcmp(name, builtinNames[i], len) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/** Function to get the id of an element name, adding the name to the table if it is new
+ *@return the id, or -1 if the table is full
+ *@param str- the name, does not need to be NUL terminated
+ *@param int- the length of the name
+ **/
+int internGPXName(const char* name, int len) {
+	if (len > GPX_NAME_MAX) {
+		len = GPX_NAME_MAX;
+	}
+
+	int id = findBuiltin(name, len);
+	if (id >= 0) {
+		return id;
+	}
+
+	pthread_mutex_lock(&namesLock);
+	for (int i = 0; i < numAdded; i++) {
+		const char* added = addedNames[i / CHUNK_SIZE][i % CHUNK_SIZE];
+		if ((int)strlen(added) == len && memcmp(name, added, len) == 0) {
+			pthread_mutex_unlock(&namesLock);
+			return NUM_BUILTIN + i;
+		}
+	}
+
+	if (numAdded == CHUNK_SIZE * MAX_CHUNKS) {
+		pthread_mutex_unlock(&namesLock);
+		return -1;
+	}
+	if (numAdded % CHUNK_SIZE == 0) {
+		addedNames[numAdded / CHUNK_SIZE] = malloc(sizeof(char*) * CHUNK_SIZE);
+	}
+
+	char* copy = malloc(sizeof(char) * (len + 1));
+	memcpy(copy, name, len);
+	copy[len] = '\0';
+	addedNames[numAdded / CHUNK_SIZE][numAdded % CHUNK_SIZE] = copy;
+	id = NUM_BUILTIN + numAdded;
+	numAdded++;
+
+	pthread_mutex_unlock(&namesLock);
+	return id;
+}
+
+/** Function to get the name behind an id
+ *@return the name, "" for an unknown id. The string lives as long as the process.
+ *@param int- the id
+ **/
+const char* gpxNameString(int id) {
+	if (id >= 0 && id < NUM_BUILTIN) {
+		return builtinNames[id];
+	}
+
+	const char* name = "";
+	pthread_mutex_lock(&namesLock);
+	if (id >= NUM_BUILTIN && id - NUM_BUILTIN < numAdded) {
+		int index = id - NUM_BUILTIN;
+		name = addedNames[index / CHUNK_SIZE][index % CHUNK_SIZE];
+	}
+	pthread_mutex_unlock(&namesLock);
+	return name;
+}
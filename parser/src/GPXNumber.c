@@ -0,0 +1,387 @@
+/**
+ * Created by: Alexander Blankenstein
+ **/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <locale.h>
+
+#include "GPXNumber.h"
+
+//Every power of ten up to 1e22 is exactly representable as a double
+static const double powersOfTen[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+#define MAX_EXACT_MANTISSA ((uint64_t)1 << 53)
+#define MAX_EXACT_POWER 22
+
+static bool isDigit(char c) {
+	return c >= '0' && c <= '9';
+}
+
+static bool isSpace(char c) {
+	return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+/** Function to read a number with strtod, as if the C locale was active
+ *@return the value
+ **/
+static double slowNumber(const char* str, int len, const char** end) {
+	const char* point = localeconv()->decimal_point;
+	int pointLen = strlen(point);
+	char stackBuffer[128];
+	char* buffer = stackBuffer;
+	int dotAt = -1;
+	int j = 0;
+
+	if (len * pointLen + 1 > (int)sizeof(stackBuffer)) {
+		buffer = malloc(sizeof(char) * (len * pointLen + 1));
+	}
+
+	//Swap the '.' for the locale's decimal point, and stop where the C locale's strtod would stop anyway
+	//if the locale uses something else, like ',', as its decimal point
+	for (int i = 0; i < len; i++) {
+		if (str[i] == '.') {
+			if (dotAt < 0) {
+				dotAt = j;
+			}
+			memcpy(buffer + j, point, pointLen);
+			j = j + pointLen;
+		}
+		else if (str[i] == point[0] || str[i] == '\0') {
+			break;
+		}
+		else {
+			buffer[j] = str[i];
+			j++;
+		}
+	}
+	buffer[j] = '\0';
+
+	char* stop;
+	double value = strtod(buffer, &stop);
+
+	if (end != NULL) {
+		int used = stop - buffer;
+		if (dotAt >= 0 && used > dotAt) {
+			used = used - (pointLen - 1);
+		}
+		*end = str + used;
+	}
+	if (buffer != stackBuffer) {
+		free(buffer);
+	}
+	return value;
+}
+
+/** Function to read a decimal number at the start of a length delimited string.
+ *  Leading whitespace, a sign, a fraction and an exponent are accepted, the same input strtod takes.
+ *  Values with up to 19 significant digits whose mantissa fits in 53 bits and whose power of ten is
+ *  at most 22 are converted with one exact multiply or divide, which rounds correctly. Everything else
+ *  (more digits, huge exponents, hex, inf, nan) goes through strtod.
+ *@return the value, 0.0 if the string does not start with a number
+ *@param str- the string, does not need to be NUL terminated
+ *@param int- the length of the string
+ *@param Ptr- set to the first character after the number, can be NULL
+ **/
+double parseGPXNumber(const char* str, int len, const char** end) {
+	const char* p = str;
+	const char* stop = str + len;
+	uint64_t mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	bool negative = false;
+	bool seenDigit = false;
+
+	while (p < stop && isSpace(*p)) {
+		p++;
+	}
+	if (p < stop && (*p == '-' || *p == '+')) {
+		negative = *p == '-';
+		p++;
+	}
+
+	while (p < stop && isDigit(*p)) {
+		if (mantissa != 0 || *p != '0') {
+			digits++;
+		}
+		if (digits <= 19) {
+			mantissa = mantissa * 10 + (*p - '0');
+		}
+		seenDigit = true;
+		p++;
+	}
+	if (p < stop && *p == '.') {
+		p++;
+		while (p < stop && isDigit(*p)) {
+			if (mantissa != 0 || *p != '0') {
+				digits++;
+			}
+			if (digits <= 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+			}
+			exponent--;
+			seenDigit = true;
+			p++;
+		}
+	}
+
+	//Hex, inf, nan or no number at all
+	if (!seenDigit || (p < stop && (*p == 'x' || *p == 'X'))) {
+		return slowNumber(str, len, end);
+	}
+
+	if (p < stop && (*p == 'e' || *p == 'E')) {
+		const char* e = p + 1;
+		bool negativeExp = false;
+		int exp = 0;
+		if (e < stop && (*e == '-' || *e == '+')) {
+			negativeExp = *e == '-';
+			e++;
+		}
+		if (e < stop && isDigit(*e)) {
+			while (e < stop && isDigit(*e)) {
+				if (exp < 100000) {
+					exp = exp * 10 + (*e - '0');
+				}
+				e++;
+			}
+			exponent = negativeExp ? exponent - exp : exponent + exp;
+			p = e;
+		}
+	}
+
+	if (digits > 19 || mantissa > MAX_EXACT_MANTISSA || exponent > MAX_EXACT_POWER || exponent < -MAX_EXACT_POWER) {
+		return slowNumber(str, len, end);
+	}
+
+	double value = (double)mantissa;
+	if (exponent < 0) {
+		value = value / powersOfTen[-exponent];
+	}
+	else {
+		value = value * powersOfTen[exponent];
+	}
+
+	if (end != NULL) {
+		*end = p;
+	}
+	return negative ? -value : value;
+}
+
+/** Function to read a string that holds nothing but a number, with optional surrounding whitespace
+ *@return true if the whole string was a number
+ *@param str- the string, does not need to be NUL terminated
+ *@param int- the length of the string
+ *@param Ptr- set to the value
+ **/
+bool parseGPXNumberExactly(const char* str, int len, double* value) {
+	const char* end;
+	const char* stop = str + len;
+
+	*value = parseGPXNumber(str, len, &end);
+	if (end == str) {
+		return false;
+	}
+	while (end < stop && isSpace(*end)) {
+		end++;
+	}
+	return end == stop;
+}
+
+/** Function to read a fixed number of digits
+ *@return false if one of them is not a digit
+ **/
+static bool readDigits(const char* p, int count, int* value) {
+	*value = 0;
+	for (int i = 0; i < count; i++) {
+		if (!isDigit(p[i])) {
+			return false;
+		}
+		*value = *value * 10 + (p[i] - '0');
+	}
+	return true;
+}
+
+/** Function to count the days from 1970-01-01 to a date of the proleptic Gregorian calendar
+ *@return the number of days, negative before 1970
+ **/
+static int64_t daysFromCivil(int year, int month, int day) {
+	year = month <= 2 ? year - 1 : year;
+	int64_t era = (year >= 0 ? year : year - 399) / 400;
+	int64_t yearOfEra = year - era * 400;
+	int64_t dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+	int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+	return era * 146097 + dayOfEra - 719468;
+}
+
+/** Function to read an xsd:dateTime into milliseconds since the epoch. Fractions below a millisecond are dropped.
+ *@return false if the string is not a date and time
+ *@param str- the string, does not need to be NUL terminated, surrounding whitespace is skipped
+ *@param int- the length of the string
+ *@param Ptr- set to the time
+ **/
+bool parseGPXTime(const char* str, int len, int64_t* ms) {
+	static const int daysInMonth[] = {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+	const char* p = str;
+	const char* stop = str + len;
+	int year, month, day, hour, minute, second;
+	int millis = 0;
+	int offset = 0;
+
+	while (p < stop && isSpace(*p)) {
+		p++;
+	}
+	while (stop > p && isSpace(stop[-1])) {
+		stop--;
+	}
+
+	if (stop - p < 19 || !readDigits(p, 4, &year) || p[4] != '-' || !readDigits(p + 5, 2, &month) || p[7] != '-'
+		|| !readDigits(p + 8, 2, &day) || p[10] != 'T' || !readDigits(p + 11, 2, &hour) || p[13] != ':'
+		|| !readDigits(p + 14, 2, &minute) || p[16] != ':' || !readDigits(p + 17, 2, &second)) {
+		return false;
+	}
+	if (month < 1 || month > 12 || day < 1 || day > daysInMonth[month - 1] || hour > 23 || minute > 59 || second > 59) {
+		return false;
+	}
+	if (month == 2 && day == 29 && !(year % 4 == 0 && (year % 100 != 0 || year % 400 == 0))) {
+		return false;
+	}
+	p = p + 19;
+
+	if (p < stop && *p == '.') {
+		p++;
+		int digits = 0;
+		while (p < stop && isDigit(*p)) {
+			if (digits < 3) {
+				millis = millis * 10 + (*p - '0');
+			}
+			digits++;
+			p++;
+		}
+		if (digits == 0) {
+			return false;
+		}
+		for (; digits < 3; digits++) {
+			millis = millis * 10;
+		}
+	}
+
+	if (p < stop && *p == 'Z') {
+		p++;
+	}
+	else if (p < stop && (*p == '+' || *p == '-')) {
+		int zoneHour, zoneMinute;
+		if (stop - p < 6 || !readDigits(p + 1, 2, &zoneHour) || p[3] != ':' || !readDigits(p + 4, 2, &zoneMinute)
+			|| zoneHour > 14 || zoneMinute > 59) {
+			return false;
+		}
+		offset = (zoneHour * 60 + zoneMinute) * (*p == '-' ? -1 : 1);
+		p = p + 6;
+	}
+	if (p != stop) {
+		return false;
+	}
+
+	int64_t seconds = daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second - offset * 60;
+	*ms = seconds * 1000 + millis;
+	return true;
+}
+
+/** Function to turn a day count since 1970-01-01 back into a date of the proleptic Gregorian calendar
+ **/
+static void civilFromDays(int64_t days, int64_t* year, int* month, int* day) {
+	days = days + 719468;
+	int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+	int64_t dayOfEra = days - era * 146097;
+	int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+	int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+	int64_t monthIndex = (5 * dayOfYear + 2) / 153;
+
+	*day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+	*month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+	*year = yearOfEra + era * 400 + (*month <= 2 ? 1 : 0);
+}
+
+/** Function to write an elevation as a plain decimal (xsd:decimal has no exponent), with the fewest
+ *  fraction digits that read back to the same float. The decimal point is always '.'.
+ *@return the length of the text, or -1 if it does not fit
+ *@param float- the elevation
+ *@param Ptr- the buffer to write to
+ *@param int- the size of the buffer
+ **/
+int formatGPXElevation(float value, char* buffer, int size) {
+	const char* point = localeconv()->decimal_point;
+	char text[64];
+	int len = 0;
+
+	for (int decimals = 0; decimals <= 9; decimals++) {
+		len = snprintf(text, sizeof(text), "%.*f", decimals, value);
+		if (len < 0 || len >= (int)sizeof(text)) {
+			return -1;
+		}
+
+		char* at = strstr(text, point);
+		if (at != NULL && strcmp(point, ".") != 0) {
+			int pointLen = strlen(point);
+			*at = '.';
+			memmove(at + 1, at + pointLen, strlen(at + pointLen) + 1);
+			len = len - (pointLen - 1);
+		}
+		if ((float)parseGPXNumber(text, len, NULL) == value) {
+			break;
+		}
+	}
+
+	if (len + 1 > size) {
+		return -1;
+	}
+	memcpy(buffer, text, len + 1);
+	return len;
+}
+
+/** Function to write milliseconds since the epoch as an xsd:dateTime in UTC, YYYY-MM-DDThh:mm:ss[.fff]Z.
+ *  The fraction is only written when it is not zero.
+ *@return the length of the text, or -1 if it does not fit
+ *@param int- the time
+ *@param Ptr- the buffer to write to
+ *@param int- the size of the buffer
+ **/
+int formatGPXTime(int64_t ms, char* buffer, int size) {
+	int64_t seconds = ms / 1000;
+	int millis = ms % 1000;
+	if (millis < 0) {
+		millis = millis + 1000;
+		seconds--;
+	}
+
+	int64_t days = seconds / 86400;
+	int secondOfDay = seconds % 86400;
+	if (secondOfDay < 0) {
+		secondOfDay = secondOfDay + 86400;
+		days--;
+	}
+
+	int64_t year;
+	int month, day;
+	civilFromDays(days, &year, &month, &day);
+
+	int len;
+	if (millis != 0) {
+		len = snprintf(buffer, size, "%04lld-%02d-%02dT%02d:%02d:%02d.%03dZ", (long long)year, month, day,
+			secondOfDay / 3600, secondOfDay / 60 % 60, secondOfDay % 60, millis);
+	}
+	else {
+		len = snprintf(buffer, size, "%04lld-%02d-%02dT%02d:%02d:%02dZ", (long long)year, month, day,
+			secondOfDay / 3600, secondOfDay / 60 % 60, secondOfDay % 60);
+	}
+	if (len < 0 || len >= size) {
+		return -1;
+	}
+	return len;
+}
@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
+#include <pthread.h>
 #include <libxml/parser.h>
 #include <libxml/tree.h>
 #include <libxml/encoding.h>
@@ -15,6 +16,78 @@
 #include "assert.h"
 #include "LinkedListAPI.h"
 #include "GPXHelper.h"
+#include "GPXBuilder.h"
+#include "GPXScanner.h"
+#include "GPXLazy.h"
+#include "GPXNumber.h"
+#include "GPXArena.h"
+#include "GPXColumns.h"
+#include "GPXNames.h"
+#include "GPXIndex.h"
+
+/** Function to build a GPX object by streaming the file through libxml
+ *@return the new document, or NULL
+ *@param str- the name of the GPX file
+ *@param bool- false to keep waypoint <ele> and <time> only as typed values
+ **/
+static GPXdoc* streamGPXFile(char* fileName, bool keepText) {
+    xmlTextReaderPtr reader = NULL;
+    
+    if (fileName == NULL) {
+        return NULL;
+    }
+    resetParseCount();
+
+    //libxml inflates .gpx.gz files as it reads them
+    if (gpxFileKind(fileName) == GPX_FILE_NONE) {
+        return NULL;
+    }
+    initGPXParser();
+    reader = readXMLStream(fileName, 64);
+    if (reader == NULL) {
+        return NULL;
+    }
+    
+    //Build the data tree straight from the reader, no xmlDoc is ever held in memory
+    GPXdoc* tmpDoc = readerToGPXdoc(reader, keepText, false);
+
+    //No xmlCleanupParser here, other threads may be parsing at the same time
+    xmlFreeTextReader(reader);
+
+    return tmpDoc;
+}
+
+/** Function to build a GPX object with the memory mapped tokenizer, falling back to libxml
+ *@return the new document, or NULL
+ *@param str- the name of the GPX file
+ *@param bool- false to keep waypoint <ele> and <time> only as typed values
+ **/
+static GPXdoc* scanOrStreamGPXFile(char* fileName, bool keepText) {
+    bool handled = false;
+
+    if (fileName == NULL) {
+        return NULL;
+    }
+    resetParseCount();
+
+    GPXdoc* tmpDoc = NULL;
+    int kind = gpxFileKind(fileName);
+    if (kind == GPX_FILE_PLAIN) {
+        tmpDoc = scanGPXFile(fileName, keepText, &handled);
+    }
+    else if (kind == GPX_FILE_GZIP) {
+        tmpDoc = scanGzipGPXFile(fileName, keepText, &handled);
+    }
+    else {
+        return NULL;
+    }
+    if (handled) {
+        return tmpDoc;
+    }
+
+    //Let libxml decide what the file means and report its errors
+    return streamGPXFile(fileName, keepText);
+}
 
 /** Function to create an GPX object based on the contents of an GPX file.
  *@pre File name cannot be an empty string or NULL.
@@ -27,46 +100,98 @@
  *@param fileName - a string containing the name of the GPX file
 **/
 GPXdoc* createGPXdoc(char* fileName) {
-    xmlDoc* doc = NULL;
-    
+    return streamGPXFile(fileName, true);
+}
+
+/** Function to create an GPX object based on the contents of an GPX file, using the memory mapped tokenizer
+ * when the file allows it and createGPXdoc otherwise.
+ *@pre File name cannot be an empty string or NULL.
+       File represented by this name must exist and must be readable.
+ *@post Either:
+        A valid GPXdoc has been created and its address was returned
+        or
+        An error occurred, and NULL was returned
+ *@return the pinter to the new struct or NULL
+ *@param fileName - a string containing the name of the GPX file
+**/
+GPXdoc* createFastGPXdoc(char* fileName) {
+    return scanOrStreamGPXFile(fileName, true);
+}
+
+/** Function to create an GPX object whose waypoints keep <ele> and <time> only as typed values.
+ *@pre File name cannot be an empty string or NULL.
+       File represented by this name must exist and must be readable.
+ *@post Either:
+        A valid GPXdoc has been created and its address was returned
+        or
+        An error occurred, and NULL was returned
+ *@return the pinter to the new struct or NULL
+ *@param fileName - a string containing the name of the GPX file
+**/
+GPXdoc* createCompactGPXdoc(char* fileName) {
+    return scanOrStreamGPXFile(fileName, false);
+}
+
+/** Function to create an GPX object, reading large files in parts on several threads.
+ *@pre File name cannot be an empty string or NULL.
+       File represented by this name must exist and must be readable.
+ *@post Either:
+        A valid GPXdoc has been created and its address was returned
+        or
+        An error occurred, and NULL was returned
+ *@return the pinter to the new struct or NULL
+ *@param fileName - a string containing the name of the GPX file
+ *@param numThreads - the number of threads, 0 or less for one per processor
+**/
+GPXdoc* createParallelGPXdoc(char* fileName, int numThreads) {
+    bool handled = false;
+
     if (fileName == NULL) {
         return NULL;
     }
+    resetParseCount();
 
-    char* point;
-    if ((point = strrchr(fileName, '.')) != NULL) {
-        if (strcmp(point, ".gpx") == 0) {
-            LIBXML_TEST_VERSION
-            doc = xmlReadFile(fileName, NULL, 64);
-        }
-        else {
-            return NULL;
-        }
+    //A compressed file can only be read from the start
+    int kind = gpxFileKind(fileName);
+    if (kind != GPX_FILE_PLAIN) {
+        return kind == GPX_FILE_GZIP ? scanOrStreamGPXFile(fileName, true) : NULL;
     }
-    else {
-        xmlFreeDoc(doc);
-        return NULL;
+
+    GPXdoc* tmpDoc = scanGPXFileParallel(fileName, true, numThreads, &handled);
+    if (handled) {
+        return tmpDoc;
     }
-    if (doc == NULL) {
+    return streamGPXFile(fileName, true);
+}
+
+/** Function to create an GPX object whose route and track points are read from the file when first used
+ *@pre File name cannot be an empty string or NULL.
+       File represented by this name must exist and must be readable.
+ *@post Either:
+        A valid GPXdoc has been created and its address was returned
+        or
+        An error occurred, and NULL was returned
+ *@return the pinter to the new struct or NULL
+ *@param fileName - a string containing the name of the GPX file
+**/
+GPXdoc* createLazyGPXdoc(char* fileName) {
+    bool handled = false;
+
+    if (fileName == NULL) {
         return NULL;
     }
-    
-    //Init data tree
-    GPXdoc* tmpDoc = malloc(sizeof(GPXdoc));
-    tmpDoc->version = 0.0;
-    tmpDoc->creator = malloc(2 * sizeof(char*));
-    strcpy(tmpDoc->creator, "");
-    tmpDoc->waypoints = initializeList(&waypointToString, &deleteWaypoint, &compareWaypoints);
-    tmpDoc->routes = initializeList(&routeToString, &deleteRoute, &compareRoutes);
-    tmpDoc->tracks = initializeList(&trackToString, &deleteTrack, compareTracks);
-
-    xmlNode* root_element = xmlDocGetRootElement(doc);
-    fillDoc(root_element,tmpDoc, fileName);
+    resetParseCount();
 
-    xmlFreeDoc(doc);
-    xmlCleanupParser();
+    //Parts can only be read back out of a plain file
+    if (gpxFileKind(fileName) != GPX_FILE_PLAIN) {
+        return scanOrStreamGPXFile(fileName, true);
+    }
 
-    return tmpDoc;
+    GPXdoc* tmpDoc = scanLazyGPXFile(fileName, &handled);
+    if (handled) {
+        return tmpDoc;
+    }
+    return streamGPXFile(fileName, true);
 }
 
 /** Function to create a string representation of an GPX object.
@@ -143,6 +268,48 @@ char* GPXdocToString(GPXdoc* doc) {
     return docString;
 }
 
+/** Function that returns the arena an object was made in, told by one of its lists: the lists of an object the
+ *  parser made come out of the same arena as the object, those of an object made on its own from malloc
+ *@return the arena, or NULL for an object made with malloc
+ *@param list - one of the lists of the object
+ **/
+static GPXArena* madeInArena(const List* list) {
+    if (list == NULL || list->allocate != &arenaPoolAlloc) {
+        return NULL;
+    }
+    return list->pool;
+}
+
+/** Function to call a delete function on everything in a list of a document, without taking it out. The lists
+ *  of a document delete nothing themselves. Points a lazy document never read were all made by the parser.
+ *@param list - the list
+ *@param deleteData - the delete function
+ **/
+static void deleteEach(List* list, void (*deleteData)(void* toBeDeleted)) {
+    if (list == NULL || !isListLoaded(list)) {
+        return;
+    }
+    ListIterator iter = createIterator(list);
+    void* elem;
+    while ((elem = nextElement(&iter)) != NULL) {
+        deleteData(elem);
+    }
+}
+
+/** Function to free the GPXData of an object made in an arena that were put there from outside
+ *@param arena - the arena the object was made in
+ *@param otherData - the GPXData of the object
+ **/
+static void releaseOutside(GPXArena* arena, List* otherData) {
+    ListIterator iter = createIterator(otherData);
+    void* elem;
+    while ((elem = nextElement(&iter)) != NULL) {
+        if (!arenaOwns(arena, elem)) {
+            deleteGpxData(elem);
+        }
+    }
+}
+
 /** Function to delete doc content and free all the memory.
  *@pre GPX object exists, is not null, and has not been freed
  *@post GPX object had been freed
@@ -154,6 +321,21 @@ void deleteGPXdoc(GPXdoc* doc) {
         return;
     }
 
+    //Everything the parser made, the doc itself included, lives in the arena. Objects and GPXData from outside
+    //only get in through the lists, so once one was changed they are found by the delete functions, which leave
+    //the rest to the arena.
+    if (doc->arena != NULL) {
+        if (arenaUntouched(doc->arena)) {
+            freeArena(doc->arena);
+            return;
+        }
+        deleteEach(doc->waypoints, &deleteWaypoint);
+        deleteEach(doc->routes, &deleteRoute);
+        deleteEach(doc->tracks, &deleteTrack);
+        freeArena(doc->arena);
+        return;
+    }
+
     if (doc != NULL) {
         if (doc->creator != NULL) {
             free(doc->creator);
@@ -174,6 +356,27 @@ void deleteGPXdoc(GPXdoc* doc) {
     free(doc);
 }
 
+/** Function that reports the memory a document built by the parser holds
+ *@pre GPX object exists and is not null
+ *@return the counts, all zero if the document has no arena
+ *@param obj - a pointer to an GPX struct
+**/
+GPXMemoryStats getGPXdocMemory(const GPXdoc* doc) {
+    GPXMemoryStats stats;
+    memset(&stats, 0, sizeof(GPXMemoryStats));
+
+    if (doc == NULL || doc->arena == NULL) {
+        return stats;
+    }
+
+    //The arena struct itself is one more allocation
+    stats.objects = doc->arena->allocations;
+    stats.systemAllocations = arenaBlockCount(doc->arena) + 1;
+    stats.bytes = doc->arena->bytes;
+    stats.reserved = arenaReserved(doc->arena) + sizeof(GPXArena);
+    return stats;
+}
+
 /* For the five "get..." functions below, return the count of specified entities from the file.
 They all share the same format and only differ in what they have to count.
 
@@ -188,18 +391,7 @@ int getNumWaypoints(const GPXdoc* doc) {
     if (doc == NULL) {
         return 0;
     }
-
-    ListIterator iter = createIterator(doc->waypoints);
-    int num = 0;
-    void* elem;
-
-    if (doc != NULL) {
-        while ((elem = nextElement(&iter)) != NULL) {
-            num = num + 1;
-        }
-    }
-
-    return num;
+    return getLength(doc->waypoints);
 }
 
 //Total number of routes in the GPX file
@@ -207,17 +399,7 @@ int getNumRoutes(const GPXdoc* doc) {
     if (doc == NULL) {
         return 0;
     }
-    ListIterator iter = createIterator(doc->routes);
-    int num = 0;
-    void* elem;
-
-    if (doc != NULL) {
-        while ((elem = nextElement(&iter)) != NULL) {
-            num = num + 1;
-        }
-    }
-
-    return num;
+    return getLength(doc->routes);
 }
 
 //Total number of tracks in the GPX file
@@ -225,17 +407,30 @@ int getNumTracks(const GPXdoc* doc) {
     if (doc == NULL) {
         return 0;
     }
-    ListIterator iter = createIterator(doc->tracks);
-    int num = 0;
-    void* elem;
+    return getLength(doc->tracks);
+}
 
-    if (doc != NULL) {
-        while ((elem = nextElement(&iter)) != NULL) {
-            num = num + 1;
-        }
+//Counts and totals that a read fills in are written under this lock, so documents can be read from many threads
+static pthread_mutex_t cacheLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** Function that returns the counts of a document, made to match its lists again when they were changed
+ *  straight through the lists instead of the functions of this file. Called with cacheLock held.
+ *@return the counts, NULL for a document without any
+ **/
+static GPXCounts* checkedCounts(const GPXdoc* doc) {
+    GPXCounts* counts = doc->counts;
+    if (counts == NULL) {
+        return NULL;
     }
 
-    return num;
+    if (!countsCurrent(counts)) {
+        counts->numWaypoints = getLength(doc->waypoints);
+        counts->numRoutes = getLength(doc->routes);
+        counts->numTracks = getLength(doc->tracks);
+        counts->numSegments = -1;
+        markCountsCurrent(counts);
+    }
+    return counts;
 }
 
 //Total number of segments in all tracks in the document
@@ -243,22 +438,34 @@ int getNumSegments(const GPXdoc* doc) {
     if (doc == NULL) {
         return 0;
     }
+
+    //Counted as the document was read and changed
+    pthread_mutex_lock(&cacheLock);
+    GPXCounts* counts = checkedCounts(doc);
+    if (counts != NULL && counts->numSegments >= 0) {
+        int num = counts->numSegments;
+        pthread_mutex_unlock(&cacheLock);
+        return num;
+    }
+
     ListIterator iter = createIterator(doc->tracks);
     int num = 0;
     void* elem;
 
-    if (doc != NULL) {
-        while ((elem = nextElement(&iter)) != NULL) {
-            Track* tmpTRK = (Track*)elem;
-            ListIterator iter2 = createIterator(tmpTRK->segments);
-            void* elem2;
+    while ((elem = nextElement(&iter)) != NULL) {
+        Track* tmpTRK = (Track*)elem;
+        num = num + getLength(tmpTRK->segments);
 
-            while ((elem2 = nextElement(&iter2)) != NULL) {
-                num = num + 1;
-            }
+        //A track put in the document with insertBack brings a segment list the arena does not watch yet
+        if (counts != NULL && tmpTRK->segments->watchContext != counts->arena) {
+            watchList(tmpTRK->segments, &arenaChanged, counts->arena);
         }
     }
 
+    if (counts != NULL) {
+        counts->numSegments = num;
+    }
+    pthread_mutex_unlock(&cacheLock);
     return num;
 }
 
@@ -267,102 +474,26 @@ int getNumGPXData(const GPXdoc* doc) {
     if (doc == NULL) {
         return 0;
     }
+
+    //Counted on every call, a name changed in place would go unseen by anything kept from an earlier count.
+    //Walking a lazy document reads its points.
     ListIterator iter = createIterator(doc->waypoints);
     int num = 0;
     void* elem;
 
-    if (doc != NULL) {
-        while ((elem = nextElement(&iter)) != NULL) {
-            Waypoint* tmpWPT = (Waypoint*)elem;
-            ListIterator iter2 = createIterator(tmpWPT->otherData);
-            void* elem2;
-
-            while ((elem2 = nextElement(&iter2)) != NULL) {
-                num = num + 1;
-            }
-
-            if (strcmp(tmpWPT->name, "") != 0) {
-                num = num + 1;
-            }
-        }
+    while ((elem = nextElement(&iter)) != NULL) {
+        num = num + numWaypointData((Waypoint*)elem);
     }
 
     iter = createIterator(doc->routes);
-
-    if (doc != NULL) {
-        while ((elem = nextElement(&iter)) != NULL) {
-            Route* tmpRTE = (Route*)elem;
-            ListIterator iter2 = createIterator(tmpRTE->otherData);
-            void* elem2;
-
-            while ((elem2 = nextElement(&iter2)) != NULL) {
-                num = num + 1;
-            }
-
-            ListIterator iter3 = createIterator(tmpRTE->waypoints);
-            void* elem3;
-
-            while ((elem3 = nextElement(&iter3)) != NULL) {
-                Waypoint* tmpWPT = (Waypoint*)elem3;
-                ListIterator iter4 = createIterator(tmpWPT->otherData);
-                void* elem4;
-
-                while ((elem4 = nextElement(&iter4)) != NULL) {
-                    num = num + 1;
-                }
-
-                if (strcmp(tmpWPT->name, "") != 0) {
-                    num = num + 1;
-                }
-            }
-
-            if (strcmp(tmpRTE->name, "") != 0) {
-                num = num + 1;
-            }
-        }
+    while ((elem = nextElement(&iter)) != NULL) {
+        num = num + numRouteData((Route*)elem);
     }
 
     iter = createIterator(doc->tracks);
-
-    if (doc != NULL) {
-        while ((elem = nextElement(&iter)) != NULL) {
-            Track* tmpTRK = (Track*)elem;
-            ListIterator iter2 = createIterator(tmpTRK->otherData);
-            void* elem2;
-
-            while ((elem2 = nextElement(&iter2)) != NULL) {
-                num = num + 1;
-            }
-
-            ListIterator iter3 = createIterator(tmpTRK->segments);
-            void* elem3;
-
-            while ((elem3 = nextElement(&iter3)) != NULL) {
-                TrackSegment* tmpTS = (TrackSegment*)elem3;
-                ListIterator iter4 = createIterator(tmpTS->waypoints);
-                void* elem4;
-
-                while ((elem4 = nextElement(&iter4)) != NULL) {
-                    Waypoint* tmpWPT = (Waypoint*)elem4;
-                    ListIterator iter5 = createIterator(tmpWPT->otherData);
-                    void* elem5;
-
-                    while ((elem5 = nextElement(&iter5)) != NULL) {
-                        num = num + 1;
-                    }
-
-                    if (strcmp(tmpWPT->name, "") != 0) {
-                        num = num + 1;
-                    }
-                }
-            }
-
-            if (strcmp(tmpTRK->name, "") != 0) {
-                num = num + 1;
-            }
-        }
+    while ((elem = nextElement(&iter)) != NULL) {
+        num = num + numTrackData((Track*)elem);
     }
-
     return num;
 }
 
@@ -381,17 +512,8 @@ Waypoint* getWaypoint(const GPXdoc* doc, char* name) {
         return NULL;
     }
 
-    ListIterator itr = createIterator(doc->waypoints);
-    void* data = nextElement(&itr);
-    while (data != NULL)
-    {
-        if (compareWaypointsBool(data, name))
-            return data;
-
-        data = nextElement(&itr);
-    }
-
-    return NULL;
+    //The name index of the document keeps the first waypoint of every name
+    return findNamedWaypoint(doc, name);
 }
 
 
@@ -405,21 +527,13 @@ Waypoint* getWaypoint(const GPXdoc* doc, char* name) {
 	name - a string containing the name of the track
  */
 Track* getTrack(const GPXdoc* doc, char* name) {
-    if (doc == NULL)
+    if (doc == NULL || name == NULL)
     {
         return NULL;
     }
 
-    ListIterator itr = createIterator(doc->tracks);
-    void* data = nextElement(&itr);
-    while (data != NULL)
-    {
-        if (compareTracksBool(data, name))
-            return data;
-
-        data = nextElement(&itr);
-    }
-    return NULL;
+    //The name index of the document keeps the first track of every name
+    return findNamedTrack(doc, name);
 }
 /* Function that returns a route with the given name.  If more than one exists, return the first one. 
 
@@ -431,26 +545,18 @@ Track* getTrack(const GPXdoc* doc, char* name) {
 	name - a string containing the name of the route
  */
 Route* getRoute(const GPXdoc* doc, char* name) {
-    if (doc == NULL)
+    if (doc == NULL || name == NULL)
     {
         return NULL;
     }
 
-    ListIterator itr = createIterator(doc->routes);
-    void* data = nextElement(&itr);
-    while (data != NULL)
-    {
-        if (compareRoutesBool(data, name))
-            return data;
-
-        data = nextElement(&itr);
-    }
-    return NULL;
+    //The name index of the document keeps the first route of every name
+    return findNamedRoute(doc, name);
 }
 
 /** Function to create an GPX object based on the contents of an GPX file.
- * This function must validate the XML tree generated by libxml against a GPX schema file
- * before attempting to traverse the tree and create an GPXdoc struct
+ * The file is validated against a GPX schema file while it is read, in the same pass that builds the
+ * GPXdoc struct. The schema is compiled once and kept. A file that breaks the schema gives NULL.
  *@pre File name cannot be an empty string or NULL.
        File represented by this name must exist and must be readable.
  *@post Either:
@@ -465,43 +571,29 @@ GPXdoc* createValidGPXdoc(char* fileName, char* gpxSchemaFile) {
     if (fileName == NULL || gpxSchemaFile == NULL) {
         return NULL;
     }
+    resetParseCount();
 
-    xmlDoc* doc = NULL;
-    bool valid = false;
-
-    GPXdoc* tmpDoc = malloc(sizeof(GPXdoc));
-    tmpDoc->version = 0.0;
-    tmpDoc->creator = malloc(2 * sizeof(char*));
-    strcpy(tmpDoc->creator, "");
-    tmpDoc->waypoints = initializeList(&waypointToString, &deleteWaypoint, &compareWaypoints);
-    tmpDoc->routes = initializeList(&routeToString, &deleteRoute, &compareRoutes);
-    tmpDoc->tracks = initializeList(&trackToString, &deleteTrack, compareTracks);
-
-    char* point;
-    if ((point = strrchr(fileName, '.')) != NULL) {
-        if (strcmp(point, ".gpx") == 0) {
-            valid = validateXMLTree(fileName, gpxSchemaFile);
-        }
-        else {
-            xmlFreeDoc(doc);
-            return NULL;
-        }
+    if (gpxFileKind(fileName) == GPX_FILE_NONE) {
+        return NULL;
     }
-    else {
-        xmlFreeDoc(doc);
+
+    GPXValidator* validator = sharedGPXValidator(gpxSchemaFile);
+    if (validator == NULL) {
         return NULL;
     }
 
-    if (valid)
-    {
-        LIBXML_TEST_VERSION
-        doc = xmlReadFile(fileName, NULL, 64);
-        
-        xmlNode* root_element = xmlDocGetRootElement(doc);
-        fillDoc(root_element, tmpDoc, fileName);
+    initGPXParser();
+    xmlTextReaderPtr reader = readXMLStream(fileName, 64);
+    if (reader == NULL) {
+        return NULL;
     }
 
-    xmlFreeDoc(doc);
+    //The reader checks each node against the schema as it hands it to the builder, so the file is read once
+    //and the build stops at the first node that breaks the schema
+    GPXValidation result;
+    GPXdoc* tmpDoc = readValidGPXdoc(validator, reader, &result);
+
+    xmlFreeTextReader(reader);
     return tmpDoc;
 }
 
@@ -520,14 +612,15 @@ bool validateGPXDoc(GPXdoc* doc, char* gpxSchemaFile) {
         return false;
     }
 
-    char* fileName = "Validationfile.gpx";
-
-    bool valid = convertToXML(doc, fileName);
-
-    if (valid) {
-        valid = validateXMLTree(fileName, gpxSchemaFile);
+    //The tree the writer would save is validated as it is, nothing is written to disk
+    xmlDocPtr tree = convertToXMLDoc(doc);
+    if (tree == NULL) {
+        return false;
     }
 
+    bool valid = validateXMLDoc(tree, gpxSchemaFile);
+    xmlFreeDoc(tree);
+
     return valid;
 }
 
@@ -547,18 +640,76 @@ bool writeGPXdoc(GPXdoc* doc, char* fileName) {
     {
         return false;
     }
-    char* point;
-    if ((point = strrchr(fileName, '.')) != NULL) {
-        if (strcmp(point, ".gpx") != 0) {
-            return false;
-        }
+    if (strrchr(fileName, '.') != NULL && gpxFileKind(fileName) == GPX_FILE_NONE) {
+        return false;
     }
 
     bool result = convertToXML(doc, fileName);
 
+    //The file is not the one its summary and snapshot were made from any more, even if the write failed part way.
+    //The snapshot stamp alone would miss a rewrite of the same size within the same mtime tick.
+    dropGPXSummary(fileName);
+    dropGPXSnapshot(fileName);
+
     return result;
 }
 
+/** Function to copy the totals of a route or track while they hold the number of points it has now
+ *@return true if they were copied
+ *@param Ptr- the totals, can be NULL
+ *@param int- the number of points
+ *@param Ptr- the copy
+ **/
+static bool readTotals(const GPXTotals* totals, int numPoints, GPXTotals* copy) {
+    if (totals == NULL) {
+        return false;
+    }
+    pthread_mutex_lock(&cacheLock);
+    bool filled = totals->numPoints == numPoints;
+    if (filled) {
+        *copy = *totals;
+    }
+    pthread_mutex_unlock(&cacheLock);
+    return filled;
+}
+
+/** Function to fill the totals of a route or track, with a length summed from columns that match its points
+ *@param Ptr- the totals, can be NULL
+ *@param int- the number of points
+ *@param float- the length
+ *@param Ptr- the first lat, first lon, last lat and last lon
+ **/
+static void storeTotals(GPXTotals* totals, int numPoints, float length, const double ends[4]) {
+    if (totals == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&cacheLock);
+    totals->numPoints = numPoints;
+    totals->length = length;
+    totals->firstLat = ends[0];
+    totals->firstLon = ends[1];
+    totals->lastLat = ends[2];
+    totals->lastLon = ends[3];
+    pthread_mutex_unlock(&cacheLock);
+}
+
+/** Function that checks if every segment of a track either has not read its points yet or still matches its
+ *  columns, so the totals of the track were summed from the points it has now
+ *@return true if the totals can be used
+ **/
+static bool trackColumnsMatch(const Track* tr) {
+    ListIterator iter = createIterator(tr->segments);
+    void* seg;
+
+    while ((seg = nextElement(&iter)) != NULL) {
+        TrackSegment* tmpSeg = (TrackSegment*)seg;
+        if (isListLoaded(tmpSeg->waypoints) && getSegmentColumns(tmpSeg) == NULL) {
+            return false;
+        }
+    }
+    return true;
+}
+
 /** Function that returns the length of a Route
  *@pre Route object exists, is not null, and has not been freed
  *@post Route object had been freed
@@ -571,6 +722,32 @@ float getRouteLen(const Route* rt) {
     if (rt == NULL || rt->waypoints == NULL) {
         return toReturn;
     }
+
+    //The length from an earlier call, carried on by the parser over any points appended since. Points can be
+    //moved in place, so it is only used while the columns it was summed from still match them.
+    int numPoints = getLength(rt->waypoints);
+    bool unread = !isListLoaded(rt->waypoints);
+    const PointColumns* columns = getRouteColumns(rt);
+    GPXTotals totals;
+    if ((unread || columns != NULL) && readTotals(rt->totals, numPoints, &totals)) {
+        return totals.length;
+    }
+
+    double ends[4] = {0.0, 0.0, 0.0, 0.0};
+
+    //Same sums in the same order as the list walk below, straight down the coordinate columns
+    if (columns != NULL) {
+        for (int i = 1; i < columns->length; i++) {
+            toReturn = toReturn + haversine(columns->lat[i], columns->lon[i], columns->lat[i - 1], columns->lon[i - 1]);
+        }
+        if (columns->length > 0) {
+            ends[0] = columns->lat[0];
+            ends[1] = columns->lon[0];
+            ends[2] = columns->lat[columns->length - 1];
+            ends[3] = columns->lon[columns->length - 1];
+        }
+        storeTotals(rt->totals, numPoints, toReturn, ends);
+    }
     else {
         Waypoint* tmpWpt2 = NULL;
         ListIterator iter = createIterator(rt->waypoints);
@@ -603,27 +780,67 @@ float getTrackLen(const Track* tr) {
         return toReturn;
     }
     else {
-        Waypoint* tmpWpt2 = NULL;
+        //The length from an earlier call, carried on by the parser over any points appended since, while the
+        //columns of every segment it was summed from still match their points
+        int numPoints = 0;
+        if (tr->totals != NULL) {
+            numPoints = numPointsTracks(tr);
+            GPXTotals totals;
+            if (trackColumnsMatch(tr) && readTotals(tr->totals, numPoints, &totals)) {
+                return totals.length;
+            }
+        }
+
+        //The distance runs on across segments, from the last point of one to the first of the next
+        bool hasPrevious = false;
+        bool fromColumns = true;
+        double ends[4] = {0.0, 0.0, 0.0, 0.0};
 
         ListIterator iter = createIterator(tr->segments);
         void* seg;
 
         while ((seg = nextElement(&iter)) != NULL) {
             TrackSegment* tmpSeg = (TrackSegment*)seg;
+            const PointColumns* columns = getSegmentColumns(tmpSeg);
 
+            if (columns != NULL) {
+                for (int i = 0; i < columns->length; i++) {
+                    if (hasPrevious)
+                    {
+                        toReturn = toReturn + haversine(columns->lat[i], columns->lon[i], ends[2], ends[3]);
+                    }
+                    else {
+                        ends[0] = columns->lat[i];
+                        ends[1] = columns->lon[i];
+                    }
+                    ends[2] = columns->lat[i];
+                    ends[3] = columns->lon[i];
+                    hasPrevious = true;
+                }
+                continue;
+            }
+
+            fromColumns = false;
             ListIterator iter2 = createIterator(tmpSeg->waypoints);
             void* wpt;
 
             while ((wpt = nextElement(&iter2)) != NULL) {
                 Waypoint* tmpWpt1 = (Waypoint*)wpt;
                 
-                if (tmpWpt2 != NULL)
+                if (hasPrevious)
                 {
-                    toReturn = toReturn + haversine(tmpWpt1->latitude, tmpWpt1->longitude, tmpWpt2->latitude, tmpWpt2->longitude);
+                    toReturn = toReturn + haversine(tmpWpt1->latitude, tmpWpt1->longitude, ends[2], ends[3]);
                 }
-                tmpWpt2 = tmpWpt1;
+                ends[2] = tmpWpt1->latitude;
+                ends[3] = tmpWpt1->longitude;
+                hasPrevious = true;
             }
         }
+
+        //Only a length summed from the columns can be checked against the points later on
+        if (fromColumns) {
+            storeTotals(tr->totals, numPoints, toReturn, ends);
+        }
     }
 
     return toReturn;
@@ -735,6 +952,26 @@ bool isLoopRoute(const Route* route, float delta) {
     {
         return result;
     }
+
+    //The totals hold the end points of a lazy route that has not read its points yet
+    GPXTotals totals;
+    if (!isListLoaded(route->waypoints) && readTotals(route->totals, getLength(route->waypoints), &totals)) {
+        if (totals.numPoints < 4) {
+            return result;
+        }
+        int len = haversine(totals.firstLat, totals.firstLon, totals.lastLat, totals.lastLon);
+        return len <= delta;
+    }
+
+    const PointColumns* columns = getRouteColumns(route);
+    if (columns != NULL) {
+        if (columns->length < 4) {
+            return result;
+        }
+        int last = columns->length - 1;
+        int len = haversine(columns->lat[0], columns->lon[0], columns->lat[last], columns->lon[last]);
+        return len <= delta;
+    }
     else {
         ListIterator iter = createIterator(route->waypoints);
         int numRte = 0;
@@ -743,12 +980,15 @@ bool isLoopRoute(const Route* route, float delta) {
         while ((elem = nextElement(&iter)) != NULL) {
             numRte = numRte + 1;
         }
+        if (numRte < 4) {
+            return result;
+        }
 
         Waypoint* firstWpt = getFromFront(route->waypoints);
         Waypoint* lastWpt = getFromBack(route->waypoints);
         int len = haversine(firstWpt->latitude, firstWpt->longitude, lastWpt->latitude, lastWpt->longitude);
 
-        if (numRte >= 4 && len <= delta)
+        if (len <= delta)
         {
             result = true;
         }
@@ -778,28 +1018,47 @@ bool isLoopTrack(const Track* tr, float delta) {
 
         while ((seg = nextElement(&iter)) != NULL) {
             TrackSegment* tmpSeg = (TrackSegment*)seg;
-            int numRte = 0;
-
-            ListIterator iter2 = createIterator(tmpSeg->waypoints);
-            void* wpt;
-
-            while ((wpt = nextElement(&iter2)) != NULL) {
-                numRte = numRte + 1;
-            }
 
-            if (numRte >= 4)
+            if (getLength(tmpSeg->waypoints) >= 4)
             {
                 reqLen = true;
             }
         }
+        if (!reqLen) {
+            return result;
+        }
 
         TrackSegment* firstSeg = getFromFront(tr->segments);
         TrackSegment* lastSeg = getFromBack(tr->segments);
+        const PointColumns* firstColumns = getSegmentColumns(firstSeg);
+        const PointColumns* lastColumns = getSegmentColumns(lastSeg);
+        GPXTotals totals;
+        int len;
+
+        //The totals hold the end points of a lazy track while neither end segment has read its points yet
+        bool unread = !isListLoaded(firstSeg->waypoints) && !isListLoaded(lastSeg->waypoints);
+        if (unread && readTotals(tr->totals, numPointsTracks(tr), &totals)) {
+            if (getLength(firstSeg->waypoints) == 0 || getLength(lastSeg->waypoints) == 0) {
+                return result;
+            }
+            len = haversine(totals.firstLat, totals.firstLon, totals.lastLat, totals.lastLon);
+        }
+        else if (firstColumns != NULL && lastColumns != NULL) {
+            if (firstColumns->length == 0 || lastColumns->length == 0) {
+                return result;
+            }
+            int last = lastColumns->length - 1;
+            len = haversine(firstColumns->lat[0], firstColumns->lon[0], lastColumns->lat[last], lastColumns->lon[last]);
+        }
+        else {
+            Waypoint* firstWpt = getFromFront(firstSeg->waypoints);
+            Waypoint* lastWpt = getFromBack(lastSeg->waypoints);
+            if (firstWpt == NULL || lastWpt == NULL) {
+                return result;
+            }
 
-        Waypoint* firstWpt = getFromFront(firstSeg->waypoints);
-        Waypoint* lastWpt = getFromBack(lastSeg->waypoints);
-
-        int len = haversine(firstWpt->latitude, firstWpt->longitude, lastWpt->latitude, lastWpt->longitude);
+            len = haversine(firstWpt->latitude, firstWpt->longitude, lastWpt->latitude, lastWpt->longitude);
+        }
 
         if (reqLen && len <= delta)
         {
@@ -822,46 +1081,19 @@ bool isLoopTrack(const Track* tr, float delta) {
  *@param delta - the tolerance used for comparing distances between waypoints
 */
 List* getRoutesBetween(const GPXdoc* doc, float sourceLat, float sourceLong, float destLat, float destLong, float delta) {
-    GPXdoc* tmpDoc = malloc(sizeof(GPXdoc));
-    tmpDoc->routes = initializeList(&routeToString, &dummyDelete, &compareRoutes);
-
-    bool hasContent = false;
-
-    //see if source loaction exists. 
-    //float sourceDist = 0.0;
-    //float destDist = 0.0;
-    //bool hasSource = false;
-
     if (doc == NULL || delta < 0) {
         return NULL;
     }
-    else {
-        ListIterator iter = createIterator(doc->routes);
-        void* rte;
 
-        while ((rte = nextElement(&iter)) != NULL) {
-            Route* tmpRte = (Route*)rte;
-
-            Waypoint* firstWpt = getFromFront(tmpRte->waypoints);
-            Waypoint* lastWpt = getFromBack(tmpRte->waypoints);
-
-            float sourceDist = haversine(firstWpt->latitude, firstWpt->longitude, sourceLat, sourceLong);
-            float destDist = haversine(lastWpt->latitude, lastWpt->longitude, destLat, destLong);
-
-            if (sourceDist <= delta && destDist <= delta)
-            {
-                insertBack(tmpDoc->routes, tmpRte);
-                hasContent = true;
-            }
-        }
-    }
+    //Only routes the end point index of the document puts near the source or destination are measured
+    List* routes = initializeList(&routeToString, &dummyDelete, &compareRoutes);
+    findRoutesBetween(doc, sourceLat, sourceLong, destLat, destLong, delta, routes);
 
-    if (hasContent) {
-        return tmpDoc->routes;
-    }
-    else {
+    if (getLength(routes) == 0) {
+        freeList(routes);
         return NULL;
     }
+    return routes;
 }
 
 /** Function that returns all Tracks between the specified start and end locations
@@ -876,44 +1108,19 @@ List* getRoutesBetween(const GPXdoc* doc, float sourceLat, float sourceLong, flo
  *@param delta - the tolerance used for comparing distances between waypoints
 */
 List* getTracksBetween(const GPXdoc* doc, float sourceLat, float sourceLong, float destLat, float destLong, float delta) {
-    GPXdoc* tmpDoc = malloc(sizeof(GPXdoc));
-    tmpDoc->tracks = initializeList(&trackToString, &dummyDelete, compareTracks);
-
-    bool hasContent = false;
-
     if (doc == NULL || delta < 0) {
         return NULL;
     }
-    else {
-        ListIterator iter = createIterator(doc->tracks);
-        void* trk;
-
-        while ((trk = nextElement(&iter)) != NULL) {
-            Track* tmpTrk = (Track*)trk;
-
-            TrackSegment* firstSeg = getFromFront(tmpTrk->segments);
-            TrackSegment* lastSeg = getFromBack(tmpTrk->segments);
-
-            Waypoint* firstWpt = getFromFront(firstSeg->waypoints);
-            Waypoint* lastWpt = getFromBack(lastSeg->waypoints);
-
-            float sourceDist = haversine(firstWpt->latitude, firstWpt->longitude, sourceLat, sourceLong);
-            float destDist = haversine(lastWpt->latitude, lastWpt->longitude, destLat, destLong);
 
-            if (sourceDist <= delta && destDist <= delta)
-            {
-                insertBack(tmpDoc->tracks, tmpTrk);
-                hasContent = true;
-            }
-        }
-    }
+    //Only tracks the end point index of the document puts near the source or destination are measured
+    List* tracks = initializeList(&trackToString, &dummyDelete, compareTracks);
+    findTracksBetween(doc, sourceLat, sourceLong, destLat, destLong, delta, tracks);
 
-    if (hasContent) {
-        return tmpDoc->tracks;
-    }
-    else {
+    if (getLength(tracks) == 0) {
+        freeList(tracks);
         return NULL;
     }
+    return tracks;
 }
 
 /** Function to converting a Track into a JSON string
@@ -1045,7 +1252,7 @@ char* routeListToJSON(const List* list) {
 
     if (list == NULL)
     {
-        size = strlen(json) + strlen("[]");
+        size = strlen(json) + strlen("[]") + 1;
         json = realloc(json, (sizeof(char) * size));
         strcat(json, "[]");
     }
@@ -1055,9 +1262,7 @@ char* routeListToJSON(const List* list) {
         json = realloc(json, (sizeof(char) * size));
         strcat(json, "[");
 
-        ListIterator iter;
-
-        iter.current = list->head;
+        ListIterator iter = createIterator((List*)list);
         void* rte;
 
         while ((rte = nextElement(&iter)) != NULL) {
@@ -1071,6 +1276,7 @@ char* routeListToJSON(const List* list) {
                 strcat(json, ",");
             }
             strcat(json, jsonRteStr);
+            free(jsonRteStr);
             notFirst = true;
         }
 
@@ -1096,7 +1302,7 @@ char* trackListToJSON(const List* list) {
 
     if (list == NULL)
     {
-        size = strlen(json) + strlen("[]");
+        size = strlen(json) + strlen("[]") + 1;
         json = realloc(json, (sizeof(char) * size));
         strcat(json, "[]");
     }
@@ -1106,9 +1312,7 @@ char* trackListToJSON(const List* list) {
         json = realloc(json, (sizeof(char) * size));
         strcat(json, "[");
         
-        ListIterator iter;
-
-        iter.current = list->head;
+        ListIterator iter = createIterator((List*)list);
         void* trk;
 
         while ((trk = nextElement(&iter)) != NULL) {
@@ -1122,6 +1326,7 @@ char* trackListToJSON(const List* list) {
                 strcat(json, ",");
             }
             strcat(json, jsonTrkStr);
+            free(jsonTrkStr);
             notFirst = true;
         }
 
@@ -1146,7 +1351,7 @@ char* GPXtoJSON(const GPXdoc* gpx) {
 
     if (gpx == NULL)
     {
-        size = strlen(json) + strlen("{}");
+        size = strlen(json) + strlen("{}") + 1;
         json = realloc(json, (sizeof(char) * size));
         strcat(json, "{}");
     }
@@ -1183,6 +1388,21 @@ char* GPXtoJSON(const GPXdoc* gpx) {
 
 
 
+/** Function to have the arena of a document watch the lists of a route that was made outside of it
+ *@param rt - a Route struct
+ *@param arena - the arena of the document
+ **/
+static void watchRoute(Route* rt, GPXArena* arena) {
+    watchList(rt->waypoints, &arenaChanged, arena);
+    watchList(rt->otherData, &arenaChanged, arena);
+
+    ListIterator iter = createIterator(rt->waypoints);
+    Waypoint* pt;
+    while ((pt = nextElement(&iter)) != NULL) {
+        watchList(pt->otherData, &arenaChanged, arena);
+    }
+}
+
 /** Function to adding an Waypont struct to an existing Route struct
  *@pre arguments are not NULL
  *@post The new waypoint has been added to the Route's waypoint list
@@ -1193,7 +1413,19 @@ char* GPXtoJSON(const GPXdoc* gpx) {
 void addWaypoint(Route* rt, Waypoint* pt) {
     if (rt != NULL && pt != NULL)
     {
+        //Its data is watched along with the points of the route
+        if (rt->waypoints->watch != NULL) {
+            watchList(pt->otherData, rt->waypoints->watch, rt->waypoints->watchContext);
+        }
         insertBack(rt->waypoints, pt);
+
+        //Keep the columns and the cached length in step with the list while they still match it
+        if (rt->columns != NULL && rt->columns->length == getLength(rt->waypoints) - 1) {
+            appendColumnsPoint(rt->columns, pt);
+        }
+        if (rt->totals != NULL && rt->totals->numPoints == getLength(rt->waypoints) - 1) {
+            appendTotalsPoint(rt->totals, pt->latitude, pt->longitude);
+        }
     }
 }
 
@@ -1207,7 +1439,24 @@ void addWaypoint(Route* rt, Waypoint* pt) {
 void addRoute(GPXdoc* doc, Route* rt) {
     if (doc != NULL && rt != NULL)
     {
+        //A route from outside the document is watched like its lists
+        if (doc->arena != NULL && !arenaOwns(doc->arena, rt)) {
+            watchRoute(rt, doc->arena);
+        }
+        bool current = countsCurrent(doc->counts);
         insertBack(doc->routes, rt);
+        addNamedRoute(doc, rt);
+
+        //A route made on its own gets totals of its own here, filled by getRouteLen and kept by addWaypoint
+        if (rt->totals == NULL && doc->arena != NULL) {
+            rt->totals = initializeTotals(doc->arena);
+        }
+        if (doc->counts != NULL) {
+            doc->counts->numRoutes++;
+        }
+        if (current) {
+            markCountsCurrent(doc->counts);
+        }
     }
 }
 
@@ -1223,13 +1472,7 @@ GPXdoc* JSONtoGPX(const char* gpxString) {
         return NULL;
     }
 
-    GPXdoc* tmpDoc = malloc(sizeof(GPXdoc));
-    tmpDoc->version = 0.0;
-    tmpDoc->creator = malloc(2 * sizeof(char*));
-    strcpy(tmpDoc->creator, "");
-    tmpDoc->waypoints = initializeList(&waypointToString, &deleteWaypoint, &compareWaypoints);
-    tmpDoc->routes = initializeList(&routeToString, &deleteRoute, &compareRoutes);
-    tmpDoc->tracks = initializeList(&trackToString, &deleteTrack, compareTracks);
+    GPXdoc* tmpDoc = initializeGPXdoc();
 
     int i, j, ctr;
     char newString[10][10];
@@ -1258,15 +1501,13 @@ GPXdoc* JSONtoGPX(const char* gpxString) {
         if (strcmp(newString[i], (char*)"version") == 0)
         {
             char* valueData = (char*)(newString[i+1]);
-            double data = strtod(valueData, NULL);
+            double data = parseGPXNumber(valueData, strlen(valueData), NULL);
             ((tmpDoc)->version) = data;
         }
         if (strcmp(newString[i], (char*)"creator") == 0)
         {
             char* creatorData = (char*)(newString[i + 1]);
-            int size = strlen(creatorData) + 1;
-            ((tmpDoc)->creator) = realloc((tmpDoc)->creator, sizeof(char) * size);
-            strcpy(((tmpDoc)->creator), creatorData);
+            ((tmpDoc)->creator) = arenaString(tmpDoc->arena, creatorData, strlen(creatorData));
         }
     }
 
@@ -1288,12 +1529,7 @@ Waypoint* JSONtoWaypoint(const char* gpxString) {
         return NULL;
     }
 
-    Waypoint* waypoint = malloc(sizeof(Waypoint));
-    waypoint->otherData = initializeList(&gpxDataToString, &deleteGpxData, &compareGpxData);
-    waypoint->latitude = 0.0;
-    waypoint->longitude = 0.0;
-    waypoint->name = malloc(2 * sizeof(char*));
-    strcpy(waypoint->name, "");
+    Waypoint* waypoint = initializeWaypoint(NULL);
 
     int i, j, ctr;
     char newString[10][10];
@@ -1322,13 +1558,13 @@ Waypoint* JSONtoWaypoint(const char* gpxString) {
         if (strcmp(newString[i], (char*)"lat") == 0)
         {
             char* valueData = (char*)(newString[i + 1]);
-            double data = strtod(valueData, NULL);
+            double data = parseGPXNumber(valueData, strlen(valueData), NULL);
             (waypoint->latitude) = data;
         }
         if (strcmp(newString[i], (char*)"lon") == 0)
         {
             char* valueData = (char*)(newString[i + 1]);
-            double data = strtod(valueData, NULL);
+            double data = parseGPXNumber(valueData, strlen(valueData), NULL);
             (waypoint->longitude) = data;
         }
     }
@@ -1348,11 +1584,7 @@ Route* JSONtoRoute(const char* gpxString) {
         return NULL;
     }
 
-    Route* route = malloc(sizeof(Route));
-    route->name = malloc(2 * sizeof(char*));
-    strcpy(route->name, "");
-    route->otherData = initializeList(&gpxDataToString, &deleteGpxData, &compareGpxData);
-    route->waypoints = initializeList(&waypointToString, &deleteWaypoint, &compareWaypoints);
+    Route* route = initializeRoute(NULL);
 
     int i, j, ctr;
     char newString[10][10];
@@ -1394,7 +1626,7 @@ Route* JSONtoRoute(const char* gpxString) {
 /* ******************************* List helper functions *************************** */
 /*GPXData reference
 typedef struct {
-    char 	name[256];
+    int 	nameId;
     char	value[];
 } GPXData;
 */
@@ -1426,7 +1658,7 @@ char* gpxDataToString(void* data) {
     char* stringToReturn = malloc(sizeof(char));
     strcpy(stringToReturn, "");
 
-    char* nameStr = tmpGPX->name;
+    const char* nameStr = getGPXDataName(tmpGPX);
     char* valueStr = tmpGPX->value;
     int size = strlen(stringToReturn) + strlen(": ") + strlen(nameStr) + strlen(valueStr) +  2;
     stringToReturn = realloc(stringToReturn, (sizeof(char) * size));
@@ -1455,7 +1687,17 @@ int compareGpxData(const void* first, const void* second) {
     tmpGPX1 = (GPXData*)first;
     tmpGPX2 = (GPXData*)second;
 
-    return strcmp((char*)tmpGPX1->name, (char*)tmpGPX2->name);
+    //Names are interned, so equal names have equal ids
+    return tmpGPX1->nameId - tmpGPX2->nameId;
+}
+
+/** Function to get the element name of a GPX data object
+ *@pre data object is not NULL
+ *@return the name, owned by the name table and valid for the life of the process
+ *@param obj - a pointer to a data object
+ **/
+const char* getGPXDataName(const GPXData* data) {
+    return gpxNameString(data->nameId);
 }
 
 /*Waypoint reference
@@ -1478,6 +1720,13 @@ void deleteWaypoint(void* data) {
         tmpWpt = (Waypoint*)data;
     }
 
+    //A waypoint the parser made is freed with its arena, only the GPXData put in it from outside is freed here
+    GPXArena* arena = tmpWpt != NULL ? madeInArena(tmpWpt->otherData) : NULL;
+    if (arena != NULL) {
+        releaseOutside(arena, tmpWpt->otherData);
+        return;
+    }
+
     if (tmpWpt != NULL) {
         if (tmpWpt->name != NULL) {
             free(tmpWpt->name);
@@ -1535,6 +1784,19 @@ char* waypointToString(void* data) {
     }
     if (tmpWpt->otherData != NULL) {
         char* otherStr = toString(tmpWpt->otherData);
+
+        //Values only kept in the typed fields come first, where the parser found them
+        const char* typedNames[2];
+        char typedValues[2][GPX_TYPED_TEXT_SIZE];
+        int numTyped = typedPointText(tmpWpt, typedNames, typedValues);
+        for (int i = numTyped - 1; i >= 0; i--) {
+            size = strlen(otherStr) + strlen(typedNames[i]) + strlen(typedValues[i]) + 5;
+            char* withTyped = malloc(sizeof(char) * size);
+            sprintf(withTyped, "\n%s: %s\n%s", typedNames[i], typedValues[i], otherStr);
+            free(otherStr);
+            otherStr = withTyped;
+        }
+
         size = strlen(stringToReturn) + strlen("Other Data: ") + strlen(otherStr) + 2;
         stringToReturn = realloc(stringToReturn, (sizeof(char) * size));
         strcat(stringToReturn, "Other Data: ");
@@ -1584,6 +1846,14 @@ void deleteRoute(void* data) {
         tmpRte = (Route*)data;
     }
 
+    //A route the parser made is freed with its arena, only the GPXData put in it from outside is freed here
+    GPXArena* arena = tmpRte != NULL ? madeInArena(tmpRte->waypoints) : NULL;
+    if (arena != NULL) {
+        releaseOutside(arena, tmpRte->otherData);
+        deleteEach(tmpRte->waypoints, &deleteWaypoint);
+        return;
+    }
+
     if (tmpRte != NULL) {
         if (tmpRte->name != NULL) {
             free(tmpRte->name);
@@ -1676,6 +1946,12 @@ void deleteTrackSegment(void* data) {
         tmpTrSeg = (TrackSegment*)data;
     }
 
+    //A segment the parser made is freed with its arena, only the points put in it from outside are freed here
+    if (tmpTrSeg != NULL && madeInArena(tmpTrSeg->waypoints) != NULL) {
+        deleteEach(tmpTrSeg->waypoints, &deleteWaypoint);
+        return;
+    }
+
     if (tmpTrSeg != NULL) {
         if (tmpTrSeg->waypoints != NULL) {
             freeList(tmpTrSeg->waypoints);
@@ -1751,6 +2027,14 @@ void deleteTrack(void* data) {
         tmpTrk = (Track*)data;
     }
 
+    //A track the parser made is freed with its arena, only the GPXData put in it from outside is freed here
+    GPXArena* arena = tmpTrk != NULL ? madeInArena(tmpTrk->segments) : NULL;
+    if (arena != NULL) {
+        releaseOutside(arena, tmpTrk->otherData);
+        deleteEach(tmpTrk->segments, &deleteTrackSegment);
+        return;
+    }
+
     if (tmpTrk != NULL) {
         if (tmpTrk->name != NULL) {
             free(tmpTrk->name);
@@ -1827,27 +2111,20 @@ int compareTracks(const void* first, const void* second) {
     return strcmp((char*)tmpTRK1->name, (char*)tmpTRK2->name);
 }
 
-/** Function to convert an XML file to JSON
+/** Function to convert an XML file to JSON. The summary is kept beside the file in <file>.summary and
+ * reused until the file changes, so only the first call for a file parses it.
  *@pre FileName is not NULL
  *@post File has not been modified in any way
  *@return A JSON string with data from the file
  *@param str- a string literal of the parsed JSON data
  **/
 char* FiletoJSON(char* fileName) {
-    GPXdoc* tmpDoc = malloc(sizeof(GPXdoc));
-    char* json = malloc(sizeof(char));
-    strcpy(json, "");
-    int size = 0;
-
-    tmpDoc = createGPXdoc(fileName);
-
-    char* jStr = GPXtoJSON(tmpDoc);
-    size = strlen(json) + strlen(jStr) +2;
-    json = realloc(json, (sizeof(char) * size));
-    strcat(json, jStr);
-    free(jStr);
+    char* json = readGPXSummary(fileName);
 
-    deleteGPXdoc(tmpDoc);
+    //A file that cannot be read has the summary of no document
+    if (json == NULL) {
+        json = GPXtoJSON(NULL);
+    }
 
     return json;
 }
@@ -1859,17 +2136,20 @@ char* FiletoJSON(char* fileName) {
  *@param str- a string literal of the parsed JSON data
  **/
 char* GPXViewtoJSON(char* fileName) {
-    GPXdoc* tmpDoc = malloc(sizeof(GPXdoc));
     char* json = malloc(sizeof(char));
     strcpy(json, "");
     int size = 0;
 
-    tmpDoc = createGPXdoc(fileName);
+    //Only names, counts and lengths are needed, so the points are never read
+    GPXdoc* tmpDoc = createLazyGPXdoc(fileName);
 
-    char* rStr = routeListToJSON(tmpDoc->routes);
-    char* tStr = trackListToJSON(tmpDoc->tracks);
-    char* rdStr = routeDataToJSON(tmpDoc->routes);
-    char* tdStr = trackDataToJSON(tmpDoc->tracks);
+    //A file that cannot be read has the view of no document, every list empty
+    List* routes = tmpDoc != NULL ? tmpDoc->routes : NULL;
+    List* tracks = tmpDoc != NULL ? tmpDoc->tracks : NULL;
+    char* rStr = routeListToJSON(routes);
+    char* tStr = trackListToJSON(tracks);
+    char* rdStr = routeDataToJSON(routes);
+    char* tdStr = trackDataToJSON(tracks);
 
     size = strlen(json) + strlen(rStr) + strlen("--") + strlen(tStr) + strlen("--") + strlen(rdStr) + strlen("--") + strlen(tdStr) + 2;
     json = realloc(json, (sizeof(char) * size));
@@ -1904,7 +2184,7 @@ char* trackDataToJSON(const List* list) {
 
     if (list == NULL)
     {
-        size = strlen(json) + strlen("[]");
+        size = strlen(json) + strlen("[]") + 1;
         json = realloc(json, (sizeof(char) * size));
         strcat(json, "[]");
     }
@@ -1914,9 +2194,7 @@ char* trackDataToJSON(const List* list) {
         json = realloc(json, (sizeof(char) * size));
         strcat(json, "[");
 
-        ListIterator iter;
-
-        iter.current = list->head;
+        ListIterator iter = createIterator((List*)list);
         void* trk;
 
         while ((trk = nextElement(&iter)) != NULL) {
@@ -1932,6 +2210,7 @@ char* trackDataToJSON(const List* list) {
                 strcat(json, ",");
             }
             strcat(json, jsonTrkStr);
+            free(jsonTrkStr);
             notFirst = true;
         }
 
@@ -1957,7 +2236,7 @@ char* routeDataToJSON(const List* list) {
 
     if (list == NULL)
     {
-        size = strlen(json) + strlen("[]");
+        size = strlen(json) + strlen("[]") + 1;
         json = realloc(json, (sizeof(char) * size));
         strcat(json, "[]");
     }
@@ -1967,9 +2246,7 @@ char* routeDataToJSON(const List* list) {
         json = realloc(json, (sizeof(char) * size));
         strcat(json, "[");
 
-        ListIterator iter;
-
-        iter.current = list->head;
+        ListIterator iter = createIterator((List*)list);
         void* rte;
 
         while ((rte = nextElement(&iter)) != NULL) {
@@ -1983,6 +2260,7 @@ char* routeDataToJSON(const List* list) {
                 strcat(json, ",");
             }
             strcat(json, jsonRteStr);
+            free(jsonRteStr);
             notFirst = true;
         }
 
@@ -2018,15 +2296,13 @@ char* otherDataToJSON(const List* list) {
         json = realloc(json, (sizeof(char) * size));
         strcat(json, "{");
 
-        ListIterator iter;
-
-        iter.current = list->head;
+        ListIterator iter = createIterator((List*)list);
         void* data;
 
         while ((data = nextElement(&iter)) != NULL) {
             GPXData* tmpData = (GPXData*)data;
 
-            char* nameStr = tmpData->name;
+            const char* nameStr = getGPXDataName(tmpData);
             char* valStr = tmpData->value;
             size = strlen(json) + strlen("\"name\":\"") + strlen(nameStr) + strlen("\",\"value\":\"") + strlen(valStr) + strlen("\"") + 2;
             json = realloc(json, (sizeof(char) * size));
@@ -2070,7 +2346,7 @@ char* findPathToJSON(char* fileName, float sourceLat, float sourceLong, float de
     bool notFirst = false;
     bool data = false;
 
-    tmpDoc = createGPXdoc(fileName);
+    tmpDoc = createSnapshotGPXdoc(fileName);
     if (tmpDoc->routes != NULL)
     {
         List* list = getRoutesBetween(tmpDoc, sourceLat, sourceLong, destLat, destLong, delta);
@@ -2153,11 +2429,8 @@ bool createNewGPX(char* fileName, char* JSONString, char* gpxSchemaFile) {
 	int- number of waypoints
  **/
 bool addNewRoute(char* fileName, char* routeJSON, char* wptJSON, int numWPT) {
-    GPXdoc* tmpDoc = malloc(sizeof(GPXdoc));
-    Route* route = malloc(sizeof(Route));
-
-    tmpDoc = createGPXdoc(fileName);
-    route = JSONtoRoute(routeJSON);
+    GPXdoc* tmpDoc = createGPXdoc(fileName);
+    Route* route = JSONtoRoute(routeJSON);
 
     int i, j, ctr;
     char newString[numWPT][100];
@@ -2183,12 +2456,11 @@ bool addNewRoute(char* fileName, char* routeJSON, char* wptJSON, int numWPT) {
     }
 
     for (i = 0; i < numWPT; i++) {
-        Waypoint* waypoint = malloc(sizeof(Waypoint));
-        waypoint = JSONtoWaypoint(newString[i]);
-        insertBack(route->waypoints, waypoint);
+        Waypoint* waypoint = JSONtoWaypoint(newString[i]);
+        addWaypoint(route, waypoint);
     }
 
-    insertBack(tmpDoc->routes, route);
+    addRoute(tmpDoc, route);
 
     writeGPXdoc(tmpDoc, fileName);
     deleteGPXdoc(tmpDoc);
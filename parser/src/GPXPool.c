@@ -0,0 +1,131 @@
+/**
+ * Created by: Alexander Blankenstein
+ **/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "GPXPool.h"
+
+/** Function to count the processors that are online
+ *@return the count, at least 1
+ **/
+int defaultThreadCount(void) {
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count < 1 ? 1 : (int)count;
+}
+
+/** Function run by every worker, takes tasks until the pool is freed
+ **/
+static void* worker(void* data) {
+	GPXThreadPool* pool = (GPXThreadPool*)data;
+
+	pthread_mutex_lock(&pool->lock);
+	while (true) {
+		while (!pool->stopping && pool->nextTask >= pool->numTasks) {
+			pthread_cond_wait(&pool->workReady, &pool->lock);
+		}
+		if (pool->stopping) {
+			break;
+		}
+
+		int index = pool->nextTask;
+		pool->nextTask++;
+		pthread_mutex_unlock(&pool->lock);
+
+		pool->task(pool->arg, index);
+
+		pthread_mutex_lock(&pool->lock);
+		pool->tasksLeft--;
+		if (pool->tasksLeft == 0) {
+			pthread_cond_signal(&pool->workDone);
+		}
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return NULL;
+}
+
+/** Function to start a pool of worker threads
+ *@return the new pool, or NULL if no thread could be started
+ *@param int- the number of threads, 0 or less for one per processor
+ **/
+GPXThreadPool* createThreadPool(int numThreads) {
+	if (numThreads <= 0) {
+		numThreads = defaultThreadCount();
+	}
+
+	GPXThreadPool* pool = malloc(sizeof(GPXThreadPool));
+	memset(pool, 0, sizeof(GPXThreadPool));
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->workReady, NULL);
+	pthread_cond_init(&pool->workDone, NULL);
+
+	pool->threads = malloc(sizeof(pthread_t) * numThreads);
+	for (int i = 0; i < numThreads; i++) {
+		if (pthread_create(&pool->threads[pool->numThreads], NULL, worker, pool) == 0) {
+			pool->numThreads++;
+		}
+	}
+
+	if (pool->numThreads == 0) {
+		freeThreadPool(pool);
+		return NULL;
+	}
+	return pool;
+}
+
+/** Function to call task for every index from 0 to numTasks - 1 on the pool's threads, and wait for all of them
+ *@param Ptr- the pool
+ *@param int- the number of tasks
+ *@param Ptr- the function to call
+ *@param Ptr- passed to every call
+ **/
+void runThreadPool(GPXThreadPool* pool, int numTasks, GPXTask task, void* arg) {
+	if (numTasks <= 0) {
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->task = task;
+	pool->arg = arg;
+	pool->nextTask = 0;
+	pool->numTasks = numTasks;
+	pool->tasksLeft = numTasks;
+	pthread_cond_broadcast(&pool->workReady);
+
+	while (pool->tasksLeft > 0) {
+		pthread_cond_wait(&pool->workDone, &pool->lock);
+	}
+	pool->numTasks = 0;
+	pool->nextTask = 0;
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/** Function to stop the workers and free the pool
+ *@param Ptr- the pool, can be NULL
+ **/
+void freeThreadPool(GPXThreadPool* pool) {
+	if (pool == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->stopping = true;
+	pthread_cond_broadcast(&pool->workReady);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (int i = 0; i < pool->numThreads; i++) {
+		pthread_join(pool->threads[i], NULL);
+	}
+
+	pthread_cond_destroy(&pool->workDone);
+	pthread_cond_destroy(&pool->workReady);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->threads);
+	free(pool);
+}
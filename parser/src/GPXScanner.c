@@ -0,0 +1,1545 @@
+/**
+ * Created by: Alexander Blankenstein
+ **/
+
+#define _GNU_SOURCE
+
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include "GPXScanner.h"
+#include "GPXBuilder.h"
+#include "GPXHelper.h"
+#include "GPXParser.h"
+#include "GPXArena.h"
+#include "GPXColumns.h"
+#include "GPXPool.h"
+
+//Chunks smaller than this are not worth a thread
+#define MIN_CHUNK_SIZE (1024 * 1024)
+
+//Inflated bytes read from a compressed file at a time
+#define GZIP_READ_SIZE (256 * 1024)
+
+/* =========================================================   Character helpers   =========================================================== */
+
+static bool isSpace(char c) {
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool isNameStart(unsigned char c) {
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == ':' || c >= 0x80;
+}
+
+static bool isNameChar(unsigned char c) {
+	return isNameStart(c) || (c >= '0' && c <= '9') || c == '-' || c == '.';
+}
+
+/** Function to decode one UTF-8 sequence of a character XML allows
+ *@return the number of bytes in the sequence, 0 if it is not proper UTF-8 or not an XML character
+ *@param str- the first byte of the sequence, 0x80 or more
+ *@param str- the end of the buffer
+ *@param Ptr- set to the code point
+ **/
+static int decodeUTF8(const unsigned char* p, const unsigned char* end, unsigned int* code) {
+	unsigned char c = *p;
+	int extra;
+
+	if ((c & 0xE0) == 0xC0) {
+		extra = 1;
+		*code = c & 0x1F;
+	}
+	else if ((c & 0xF0) == 0xE0) {
+		extra = 2;
+		*code = c & 0x0F;
+	}
+	else if ((c & 0xF8) == 0xF0) {
+		extra = 3;
+		*code = c & 0x07;
+	}
+	else {
+		return 0;
+	}
+	if (end - p <= extra) {
+		return 0;
+	}
+	for (int i = 1; i <= extra; i++) {
+		if ((p[i] & 0xC0) != 0x80) {
+			return 0;
+		}
+		*code = (*code << 6) | (p[i] & 0x3F);
+	}
+	//Overlong forms, surrogates and the two non characters are rejected by libxml as well
+	if ((extra == 1 && *code < 0x80) || (extra == 2 && *code < 0x800) || (extra == 3 && *code < 0x10000)
+		|| (*code >= 0xD800 && *code <= 0xDFFF) || *code == 0xFFFE || *code == 0xFFFF || *code > 0x10FFFF) {
+		return 0;
+	}
+	return extra + 1;
+}
+
+/** Function to check a character past ASCII against the name characters of XML 1.0 (fifth edition), which
+ *  libxml uses for documents it reads
+ *@return true if the character can be in a name
+ *@param int- the code point
+ *@param bool- true for the first character of the name
+ **/
+static bool isNameCode(unsigned int code, bool first) {
+	if ((code >= 0xC0 && code <= 0xD6) || (code >= 0xD8 && code <= 0xF6) || (code >= 0xF8 && code <= 0x2FF)
+		|| (code >= 0x370 && code <= 0x37D) || (code >= 0x37F && code <= 0x1FFF) || (code >= 0x200C && code <= 0x200D)
+		|| (code >= 0x2070 && code <= 0x218F) || (code >= 0x2C00 && code <= 0x2FEF) || (code >= 0x3001 && code <= 0xD7FF)
+		|| (code >= 0xF900 && code <= 0xFDCF) || (code >= 0xFDF0 && code <= 0xFFFD) || (code >= 0x10000 && code <= 0xEFFFF)) {
+		return true;
+	}
+	return !first && (code == 0xB7 || (code >= 0x300 && code <= 0x36F) || (code >= 0x203F && code <= 0x2040));
+}
+
+/** Function to read an element or attribute name
+ *@return a pointer to the first character after the name, or NULL if there is no valid name
+ *@param str- the start of the name
+ *@param str- the end of the buffer
+ **/
+static const char* scanName(const char* p, const char* end) {
+	const char* name = p;
+	int colons = 0;
+
+	if (p >= end || !isNameStart(*p) || *p == ':') {
+		return NULL;
+	}
+	while (p < end && isNameChar(*p)) {
+		if ((unsigned char)*p >= 0x80) {
+			//Bytes past ASCII have to make up a name character, anything else is left to libxml
+			unsigned int code;
+			int len = decodeUTF8((const unsigned char*)p, (const unsigned char*)end, &code);
+			if (len == 0 || !isNameCode(code, p == name)) {
+				return NULL;
+			}
+			p = p + len;
+			continue;
+		}
+		if (*p == ':') {
+			colons++;
+		}
+		p++;
+	}
+	//libxml only keeps prefix:local names, anything else is left to it
+	if (colons > 1 || p[-1] == ':' || p == name) {
+		return NULL;
+	}
+	return p;
+}
+
+/** Function to check that a value only holds characters XML allows, as proper UTF-8
+ *@return true if the value is valid
+ **/
+static bool validChars(const char* value, int len) {
+	const unsigned char* p = (const unsigned char*)value;
+	const unsigned char* end = p + len;
+
+	while (p < end) {
+		unsigned char c = *p;
+		if (c >= 0x20 && c < 0x80) {
+			p++;
+			continue;
+		}
+		if (c < 0x20) {
+			if (c != '\t' && c != '\n' && c != '\r') {
+				return false;
+			}
+			p++;
+			continue;
+		}
+
+		unsigned int code;
+		int used = decodeUTF8(p, end, &code);
+		if (used == 0) {
+			return false;
+		}
+		p = p + used;
+	}
+	return true;
+}
+
+/** Function to write a character reference out as UTF-8
+ *@return the number of bytes written, 0 if the code point is not an XML character
+ **/
+static int encodeUTF8(unsigned long code, char* out) {
+	if (code < 0x20 && code != '\t' && code != '\n' && code != '\r') {
+		return 0;
+	}
+	if ((code >= 0xD800 && code <= 0xDFFF) || code == 0xFFFE || code == 0xFFFF || code > 0x10FFFF) {
+		return 0;
+	}
+
+	if (code < 0x80) {
+		out[0] = (char)code;
+		return 1;
+	}
+	if (code < 0x800) {
+		out[0] = (char)(0xC0 | (code >> 6));
+		out[1] = (char)(0x80 | (code & 0x3F));
+		return 2;
+	}
+	if (code < 0x10000) {
+		out[0] = (char)(0xE0 | (code >> 12));
+		out[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+		out[2] = (char)(0x80 | (code & 0x3F));
+		return 3;
+	}
+	out[0] = (char)(0xF0 | (code >> 18));
+	out[1] = (char)(0x80 | ((code >> 12) & 0x3F));
+	out[2] = (char)(0x80 | ((code >> 6) & 0x3F));
+	out[3] = (char)(0x80 | (code & 0x3F));
+	return 4;
+}
+
+/** Function to decode one entity or character reference. Only the five predefined entities exist without a DTD.
+ *@return the number of input bytes used, including the & and ;, or 0 if the reference is not handled
+ *@param str- the & starting the reference
+ *@param str- the end of the input
+ *@param str- where the decoded bytes go, at least 4 bytes
+ *@param Ptr- set to the number of bytes written
+ **/
+static int decodeReference(const char* p, const char* end, char* out, int* outLen) {
+	const char* semi = memchr(p, ';', end - p);
+	if (semi == NULL) {
+		return 0;
+	}
+	const char* ref = p + 1;
+	int refLen = semi - ref;
+
+	if (refLen >= 2 && ref[0] == '#') {
+		unsigned long code = 0;
+		int i = 1;
+		int base = 10;
+		if (ref[1] == 'x') {
+			base = 16;
+			i = 2;
+			if (refLen == 2) {
+				return 0;
+			}
+		}
+		for (; i < refLen; i++) {
+			char c = ref[i];
+			int digit;
+			if (c >= '0' && c <= '9') {
+				digit = c - '0';
+			}
+			else if (base == 16 && c >= 'a' && c <= 'f') {
+				digit = c - 'a' + 10;
+			}
+			else if (base == 16 && c >= 'A' && c <= 'F') {
+				digit = c - 'A' + 10;
+			}
+			else {
+				return 0;
+			}
+			code = code * base + digit;
+			if (code > 0x10FFFF) {
+				return 0;
+			}
+		}
+		*outLen = encodeUTF8(code, out);
+		return *outLen == 0 ? 0 : refLen + 2;
+	}
+
+	char c;
+	if (refLen == 2 && memcmp(ref, "lt", 2) == 0) {
+		c = '<';
+	}
+	else if (refLen == 2 && memcmp(ref, "gt", 2) == 0) {
+		c = '>';
+	}
+	else if (refLen == 3 && memcmp(ref, "amp", 3) == 0) {
+		c = '&';
+	}
+	else if (refLen == 4 && memcmp(ref, "quot", 4) == 0) {
+		c = '"';
+	}
+	else if (refLen == 4 && memcmp(ref, "apos", 4) == 0) {
+		c = '\'';
+	}
+	else {
+		return 0;
+	}
+	out[0] = c;
+	*outLen = 1;
+	return refLen + 2;
+}
+
+/* =========================================================   Scanner state   =========================================================== */
+
+/** Function to set up a scanner that feeds a builder
+ *@param Ptr- the scanner to set up
+ *@param Ptr- the builder that receives the events
+ **/
+void initializeScanner(GPXScanner* scanner, GPXBuilder* builder) {
+	memset(scanner, 0, sizeof(GPXScanner));
+	scanner->builder = builder;
+}
+
+/** Function to free the memory held by a scanner. The builder is not touched.
+ *@param Ptr- the scanner
+ **/
+void clearScanner(GPXScanner* scanner) {
+	free(scanner->openNames);
+	free(scanner->openLens);
+	free(scanner->namespaces);
+	free(scanner->attrs);
+	free(scanner->attrScratch);
+	free(scanner->scratch);
+	free(scanner->held);
+	memset(scanner, 0, sizeof(GPXScanner));
+}
+
+/** Function to copy the names of the open elements and their namespace declarations out of the buffer they were
+ *  read from, so the buffer can be dropped or reused before those elements are closed
+ *@param Ptr- the scanner
+ **/
+void holdScannerNames(GPXScanner* scanner) {
+	size_t size = 1;
+	for (int i = 0; i < scanner->numOpen; i++) {
+		size = size + scanner->openLens[i];
+	}
+	for (int i = 0; i < scanner->numNamespaces; i++) {
+		size = size + scanner->namespaces[i].prefixLen + scanner->namespaces[i].hrefLen;
+	}
+
+	char* held = malloc(sizeof(char) * size);
+	char* out = held;
+	for (int i = 0; i < scanner->numOpen; i++) {
+		memcpy(out, scanner->openNames[i], scanner->openLens[i]);
+		scanner->openNames[i] = out;
+		out = out + scanner->openLens[i];
+	}
+	for (int i = 0; i < scanner->numNamespaces; i++) {
+		GPXNamespace* ns = &scanner->namespaces[i];
+		if (ns->prefixLen > 0) {
+			memcpy(out, ns->prefix, ns->prefixLen);
+			ns->prefix = out;
+			out = out + ns->prefixLen;
+		}
+		if (ns->hrefLen > 0) {
+			memcpy(out, ns->href, ns->hrefLen);
+			ns->href = out;
+			out = out + ns->hrefLen;
+		}
+	}
+
+	free(scanner->held);
+	scanner->held = held;
+}
+
+/** Function to make room for len more bytes in the scratch buffer
+ **/
+static void reserveScratch(GPXScanner* scanner, int len) {
+	if (scanner->scratchLen + len > scanner->scratchSize) {
+		int size = scanner->scratchSize * 2;
+		if (size < scanner->scratchLen + len) {
+			size = scanner->scratchLen + len;
+		}
+		if (size < 256) {
+			size = 256;
+		}
+		scanner->scratch = realloc(scanner->scratch, sizeof(char) * size);
+		scanner->scratchSize = size;
+	}
+}
+
+/** Function to decode references and normalize line ends, appending the result to the scratch buffer.
+ *  Attribute values also get their whitespace characters turned into spaces, like libxml does without a DTD.
+ *@return false if the value holds a reference that is not handled
+ **/
+static bool decodeInto(GPXScanner* scanner, const char* p, int len, bool attribute) {
+	const char* end = p + len;
+
+	//Decoding never makes a value longer
+	reserveScratch(scanner, len);
+	char* out = scanner->scratch + scanner->scratchLen;
+
+	while (p < end) {
+		char c = *p;
+		if (c == '&') {
+			int outLen;
+			int used = decodeReference(p, end, out, &outLen);
+			if (used == 0) {
+				return false;
+			}
+			out = out + outLen;
+			p = p + used;
+			continue;
+		}
+		if (c == '\r') {
+			c = '\n';
+			if (p + 1 < end && p[1] == '\n') {
+				p++;
+			}
+		}
+		if (attribute && (c == '\n' || c == '\t')) {
+			c = ' ';
+		}
+		*out = c;
+		out++;
+		p++;
+	}
+
+	scanner->scratchLen = out - scanner->scratch;
+	return true;
+}
+
+/** Function to pass a run of character data to the builder
+ *@return false if the text is not handled
+ **/
+static bool scanText(GPXScanner* scanner, const char* text, int len) {
+	//Outside the root element only whitespace may appear
+	if (scanner->numOpen == 0) {
+		for (int i = 0; i < len; i++) {
+			if (!isSpace(text[i])) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//Text the builder drops still has to be text libxml would accept. References decode to characters that are
+	//checked on their own, so the characters read here are all there is to check.
+	if (!validChars(text, len) || memmem(text, len, "]]>", 3) != NULL) {
+		return false;
+	}
+	bool hasReference = memchr(text, '&', len) != NULL;
+
+	if (!builderWantsText(scanner->builder)) {
+		if (hasReference) {
+			scanner->scratchLen = 0;
+			return decodeInto(scanner, text, len, false);
+		}
+		return true;
+	}
+
+	if (!hasReference && memchr(text, '\r', len) == NULL) {
+		builderText(scanner->builder, text, len);
+		return true;
+	}
+
+	scanner->scratchLen = 0;
+	if (!decodeInto(scanner, text, len, false)) {
+		return false;
+	}
+	builderText(scanner->builder, scanner->scratch, scanner->scratchLen);
+	return true;
+}
+
+/** Function to find the namespace a prefix is bound to on the open elements
+ *@return the declaration, or NULL if the prefix is not declared
+ **/
+static GPXNamespace* findNamespace(GPXScanner* scanner, const char* prefix, int prefixLen) {
+	for (int i = scanner->numNamespaces - 1; i >= 0; i--) {
+		GPXNamespace* ns = &scanner->namespaces[i];
+		if (ns->prefixLen == prefixLen && memcmp(ns->prefix, prefix, prefixLen) == 0) {
+			return ns;
+		}
+	}
+	return NULL;
+}
+
+/** Function to record a namespace declared on the element being opened
+ **/
+static void pushNamespace(GPXScanner* scanner, const char* prefix, int prefixLen, const char* href, int hrefLen) {
+	if (scanner->numNamespaces == scanner->sizeNamespaces) {
+		scanner->sizeNamespaces = scanner->sizeNamespaces == 0 ? 4 : scanner->sizeNamespaces * 2;
+		scanner->namespaces = realloc(scanner->namespaces, sizeof(GPXNamespace) * scanner->sizeNamespaces);
+	}
+	GPXNamespace* ns = &scanner->namespaces[scanner->numNamespaces];
+	ns->prefix = prefix;
+	ns->prefixLen = prefixLen;
+	ns->href = href;
+	ns->hrefLen = hrefLen;
+	ns->depth = scanner->numOpen + 1;
+	scanner->numNamespaces++;
+}
+
+/** Function to split a qualified name
+ *@return the length of the prefix, 0 if the name has none
+ **/
+static int prefixLength(const char* name, int nameLen) {
+	const char* colon = memchr(name, ':', nameLen);
+	return colon == NULL ? 0 : colon - name;
+}
+
+/* =========================================================   Markup   =========================================================== */
+
+/** Function to close the innermost open element
+ **/
+static void closeElement(GPXScanner* scanner) {
+	builderEndElement(scanner->builder);
+	while (scanner->numNamespaces > 0 && scanner->namespaces[scanner->numNamespaces - 1].depth == scanner->numOpen) {
+		scanner->numNamespaces--;
+	}
+	scanner->numOpen--;
+}
+
+/** Function to read a start tag and pass it to the builder
+ *@return a pointer past the tag, or NULL if the tag is not handled
+ *@param Ptr- the scanner
+ *@param str- the first character after the <
+ *@param str- the end of the buffer
+ **/
+static const char* scanStartTag(GPXScanner* scanner, const char* p, const char* end) {
+	const char* name = p;
+	int numAttrs = 0;
+	bool empty = false;
+
+	//Only one root element
+	if (scanner->numOpen == 0 && scanner->seenRoot) {
+		return NULL;
+	}
+
+	if ((p = scanName(p, end)) == NULL) {
+		return NULL;
+	}
+	int nameLen = p - name;
+	scanner->scratchLen = 0;
+
+	while (true) {
+		const char* space = p;
+		while (p < end && isSpace(*p)) {
+			p++;
+		}
+		if (p >= end) {
+			return NULL;
+		}
+		if (*p == '>') {
+			p++;
+			break;
+		}
+		if (*p == '/') {
+			if (p + 1 < end && p[1] == '>') {
+				empty = true;
+				p = p + 2;
+				break;
+			}
+			return NULL;
+		}
+		if (p == space) {
+			return NULL;
+		}
+
+		const char* attrName = p;
+		if ((p = scanName(p, end)) == NULL) {
+			return NULL;
+		}
+		int attrNameLen = p - attrName;
+		while (p < end && isSpace(*p)) {
+			p++;
+		}
+		if (p >= end || *p != '=') {
+			return NULL;
+		}
+		p++;
+		while (p < end && isSpace(*p)) {
+			p++;
+		}
+		if (p >= end || (*p != '"' && *p != '\'')) {
+			return NULL;
+		}
+
+		const char* value = p + 1;
+		const char* close = memchr(value, *p, end - value);
+		if (close == NULL) {
+			return NULL;
+		}
+		int valueLen = close - value;
+		p = close + 1;
+		if (memchr(value, '<', valueLen) != NULL) {
+			return NULL;
+		}
+
+		if (numAttrs == scanner->sizeAttrs) {
+			scanner->sizeAttrs = scanner->sizeAttrs == 0 ? 8 : scanner->sizeAttrs * 2;
+			scanner->attrs = realloc(scanner->attrs, sizeof(GPXAttribute) * scanner->sizeAttrs);
+			scanner->attrScratch = realloc(scanner->attrScratch, sizeof(int) * scanner->sizeAttrs);
+		}
+		GPXAttribute* attr = &scanner->attrs[numAttrs];
+		attr->name = attrName;
+		attr->nameLen = attrNameLen;
+		attr->value = value;
+		attr->valueLen = valueLen;
+		scanner->attrScratch[numAttrs] = -1;
+
+		bool plain = true;
+		for (int i = 0; i < valueLen; i++) {
+			char c = value[i];
+			if (c == '&' || c == '\r' || c == '\n' || c == '\t') {
+				plain = false;
+				break;
+			}
+		}
+		if (!plain) {
+			int offset = scanner->scratchLen;
+			if (!decodeInto(scanner, value, valueLen, true)) {
+				return NULL;
+			}
+			scanner->attrScratch[numAttrs] = offset;
+			attr->valueLen = scanner->scratchLen - offset;
+		}
+
+		for (int i = 0; i < numAttrs; i++) {
+			if (scanner->attrs[i].nameLen == attrNameLen && memcmp(scanner->attrs[i].name, attrName, attrNameLen) == 0) {
+				return NULL;
+			}
+		}
+		numAttrs++;
+	}
+
+	//The scratch buffer may have moved while the values were decoded
+	for (int i = 0; i < numAttrs; i++) {
+		if (scanner->attrScratch[i] >= 0) {
+			scanner->attrs[i].value = scanner->scratch + scanner->attrScratch[i];
+		}
+		if (!validChars(scanner->attrs[i].value, scanner->attrs[i].valueLen)) {
+			return NULL;
+		}
+	}
+
+	/* =========================================================   Namespaces   =========================================================== */
+
+	//A tag that is not handled leaves the scanner as it was
+	int numNamespaces = scanner->numNamespaces;
+
+	for (int i = 0; i < numAttrs; i++) {
+		GPXAttribute* attr = &scanner->attrs[i];
+		bool isDefault = attr->nameLen == 5 && memcmp(attr->name, "xmlns", 5) == 0;
+		bool isPrefixed = attr->nameLen > 6 && memcmp(attr->name, "xmlns:", 6) == 0;
+
+		if (isDefault || isPrefixed) {
+			//Declarations are kept by pointer, so their values have to live in the buffer
+			if (scanner->attrScratch[i] >= 0 || (isPrefixed && attr->valueLen == 0)) {
+				scanner->numNamespaces = numNamespaces;
+				return NULL;
+			}
+			if (isDefault) {
+				pushNamespace(scanner, attr->name, 0, attr->value, attr->valueLen);
+			}
+			else {
+				pushNamespace(scanner, attr->name + 6, attr->nameLen - 6, attr->value, attr->valueLen);
+			}
+		}
+	}
+
+	int prefixLen = prefixLength(name, nameLen);
+	GPXNamespace* ns = findNamespace(scanner, name, prefixLen);
+	if (prefixLen > 0 && ns == NULL) {
+		scanner->numNamespaces = numNamespaces;
+		return NULL;
+	}
+	const char* localName = prefixLen > 0 ? name + prefixLen + 1 : name;
+	int localLen = prefixLen > 0 ? nameLen - prefixLen - 1 : nameLen;
+
+	//Drop the declarations and strip prefixes, the builder only sees local names like the DOM attributes have
+	int kept = 0;
+	for (int i = 0; i < numAttrs; i++) {
+		GPXAttribute attr = scanner->attrs[i];
+		int attrPrefixLen = prefixLength(attr.name, attr.nameLen);
+
+		if (attr.nameLen == 5 && memcmp(attr.name, "xmlns", 5) == 0) {
+			continue;
+		}
+		if (attrPrefixLen > 0) {
+			if (attrPrefixLen == 5 && memcmp(attr.name, "xmlns", 5) == 0) {
+				continue;
+			}
+			if (!(attrPrefixLen == 3 && memcmp(attr.name, "xml", 3) == 0) && findNamespace(scanner, attr.name, attrPrefixLen) == NULL) {
+				scanner->numNamespaces = numNamespaces;
+				return NULL;
+			}
+			attr.name = attr.name + attrPrefixLen + 1;
+			attr.nameLen = attr.nameLen - attrPrefixLen - 1;
+		}
+		scanner->attrs[kept] = attr;
+		kept++;
+	}
+
+	char nsHref[256];
+	const char* href = NULL;
+	if (ns != NULL && ns->hrefLen > 0 && localLen == 3 && memcmp(localName, "gpx", 3) == 0) {
+		int len = ns->hrefLen < (int)sizeof(nsHref) - 1 ? ns->hrefLen : (int)sizeof(nsHref) - 1;
+		memcpy(nsHref, ns->href, len);
+		nsHref[len] = '\0';
+		href = nsHref;
+	}
+
+	if (scanner->numOpen == scanner->sizeOpen) {
+		scanner->sizeOpen = scanner->sizeOpen == 0 ? 16 : scanner->sizeOpen * 2;
+		scanner->openNames = realloc(scanner->openNames, sizeof(char*) * scanner->sizeOpen);
+		scanner->openLens = realloc(scanner->openLens, sizeof(int) * scanner->sizeOpen);
+	}
+	scanner->openNames[scanner->numOpen] = name;
+	scanner->openLens[scanner->numOpen] = nameLen;
+	scanner->numOpen++;
+	scanner->seenRoot = true;
+
+	scanner->builder->tagStart = name - 1;
+	scanner->builder->tagEnd = p;
+	builderStartElement(scanner->builder, localName, localLen, href, scanner->attrs, kept);
+	if (empty) {
+		closeElement(scanner);
+	}
+	return p;
+}
+
+/** Function to read an end tag and pass it to the builder
+ *@return a pointer past the tag, or NULL if it does not close the innermost open element
+ **/
+static const char* scanEndTag(GPXScanner* scanner, const char* p, const char* end) {
+	const char* name = p;
+
+	if ((p = scanName(p, end)) == NULL) {
+		return NULL;
+	}
+	int nameLen = p - name;
+	while (p < end && isSpace(*p)) {
+		p++;
+	}
+	if (p >= end || *p != '>' || scanner->numOpen == 0) {
+		return NULL;
+	}
+
+	int top = scanner->numOpen - 1;
+	if (scanner->openLens[top] != nameLen || memcmp(scanner->openNames[top], name, nameLen) != 0) {
+		return NULL;
+	}
+
+	scanner->builder->tagStart = name - 2;
+	scanner->builder->tagEnd = p + 1;
+	closeElement(scanner);
+	return p + 1;
+}
+
+/** Function to read one pseudo attribute of the XML declaration, with the whitespace in front of it
+ *@return a pointer past its value, or NULL if the declaration does not go on with that attribute
+ *@param str- the end of what came before it in the declaration
+ *@param str- the end of the buffer
+ *@param str- the name of the attribute
+ *@param Ptr- set to the start of the value
+ *@param Ptr- set to the length of the value
+ **/
+static const char* scanPseudoAttribute(const char* p, const char* end, const char* name, const char** value, int* valueLen) {
+	int nameLen = strlen(name);
+
+	if (p >= end || !isSpace(*p)) {
+		return NULL;
+	}
+	while (p < end && isSpace(*p)) {
+		p++;
+	}
+	if (end - p < nameLen || memcmp(p, name, nameLen) != 0) {
+		return NULL;
+	}
+	p = p + nameLen;
+	while (p < end && isSpace(*p)) {
+		p++;
+	}
+	if (p >= end || *p != '=') {
+		return NULL;
+	}
+	p++;
+	while (p < end && isSpace(*p)) {
+		p++;
+	}
+	if (p >= end || (*p != '"' && *p != '\'')) {
+		return NULL;
+	}
+
+	const char* close = memchr(p + 1, *p, end - p - 1);
+	if (close == NULL) {
+		return NULL;
+	}
+	*value = p + 1;
+	*valueLen = close - p - 1;
+	return close + 1;
+}
+
+/** Function to read the XML declaration: the version, then the encoding and standalone if they are there, in that
+ *  order. Only 1.x versions and UTF-8 documents are handled, anything else is left to libxml to read or reject.
+ *@return a pointer past the declaration, or NULL if it is not handled
+ *@param str- the whitespace after "<?xml"
+ *@param str- the end of the buffer
+ **/
+static const char* scanDeclaration(const char* p, const char* end) {
+	const char* value;
+	int len;
+
+	p = scanPseudoAttribute(p, end, "version", &value, &len);
+	if (p == NULL || len < 3 || value[0] != '1' || value[1] != '.') {
+		return NULL;
+	}
+	for (int i = 2; i < len; i++) {
+		if (value[i] < '0' || value[i] > '9') {
+			return NULL;
+		}
+	}
+
+	const char* next = scanPseudoAttribute(p, end, "encoding", &value, &len);
+	if (next != NULL) {
+		if (!((len == 5 && strncasecmp(value, "UTF-8", 5) == 0) || (len == 4 && strncasecmp(value, "UTF8", 4) == 0))) {
+			return NULL;
+		}
+		p = next;
+	}
+
+	next = scanPseudoAttribute(p, end, "standalone", &value, &len);
+	if (next != NULL) {
+		if (!(len == 3 && memcmp(value, "yes", 3) == 0) && !(len == 2 && memcmp(value, "no", 2) == 0)) {
+			return NULL;
+		}
+		p = next;
+	}
+
+	while (p < end && isSpace(*p)) {
+		p++;
+	}
+	if (end - p < 2 || memcmp(p, "?>", 2) != 0) {
+		return NULL;
+	}
+	return p + 2;
+}
+
+/** Function to skip the byte order mark and the XML declaration, only UTF-8 documents are handled
+ *@return a pointer to the first character after them, or NULL if the document is not handled
+ **/
+static const char* scanProlog(const char* buffer, const char* end) {
+	const char* p = buffer;
+	size_t len = end - buffer;
+
+	//UTF-16 documents go to libxml, a UTF-8 byte order mark is skipped
+	if (len >= 2 && ((unsigned char)p[0] == 0xFE || (unsigned char)p[0] == 0xFF || p[0] == '\0' || p[1] == '\0')) {
+		return NULL;
+	}
+	if (len >= 3 && memcmp(p, "\xEF\xBB\xBF", 3) == 0) {
+		p = p + 3;
+	}
+	if (end - p >= 6 && memcmp(p, "<?xml", 5) == 0 && isSpace(p[5])) {
+		p = scanDeclaration(p + 5, end);
+	}
+	return p;
+}
+
+/** Function to tokenize markup and character data, feeding it to the scanner's builder. It can be called again
+ *  for the next part of a document as long as the parts are split between two tokens.
+ *@return false if the part uses something the scanner does not handle, is not well formed, or ends inside a token
+ *@param Ptr- the scanner
+ *@param str- the start of the part
+ *@param str- the end of the part
+ *@param Ptr- set to the start of the token that could not be read when false is returned, the scanner is left as
+ *            it was before that token so reading can carry on from there with more input. Can be NULL.
+ **/
+static bool scanMarkup(GPXScanner* scanner, const char* p, const char* end, const char** stopped) {
+	while (p < end) {
+		const char* open = memchr(p, '<', end - p);
+		const char* textEnd = open == NULL ? end : open;
+
+		if (textEnd > p && !scanText(scanner, p, textEnd - p)) {
+			if (stopped != NULL) {
+				*stopped = p;
+			}
+			return false;
+		}
+		if (open == NULL) {
+			break;
+		}
+
+		if (stopped != NULL) {
+			*stopped = open;
+		}
+		p = open + 1;
+		if (p >= end) {
+			return false;
+		}
+
+		if (*p == '/') {
+			p = scanEndTag(scanner, p + 1, end);
+		}
+		else if (*p == '?') {
+			//Processing instructions are skipped, a second XML declaration is an error libxml should report
+			const char* target = p + 1;
+			const char* targetEnd = scanName(target, end);
+			if (targetEnd == NULL || (targetEnd - target == 3 && strncasecmp(target, "xml", 3) == 0)) {
+				return false;
+			}
+			const char* close = memmem(targetEnd, end - targetEnd, "?>", 2);
+			if (close == NULL || (close > targetEnd && !isSpace(*targetEnd)) || !validChars(targetEnd, close - targetEnd)) {
+				return false;
+			}
+			p = close + 2;
+		}
+		else if (*p == '!') {
+			if (end - p >= 3 && memcmp(p, "!--", 3) == 0) {
+				//"--" may only appear as the end of a comment
+				const char* close = memmem(p + 3, end - p - 3, "--", 2);
+				if (close == NULL || close + 2 >= end || close[2] != '>' || !validChars(p + 3, close - p - 3)) {
+					return false;
+				}
+				p = close + 3;
+			}
+			else if (end - p >= 8 && memcmp(p, "![CDATA[", 8) == 0 && scanner->numOpen > 0) {
+				const char* text = p + 8;
+				const char* close = memmem(text, end - text, "]]>", 3);
+				if (close == NULL) {
+					return false;
+				}
+				//CDATA is taken literally, libxml does not even normalize its line ends
+				if (!validChars(text, close - text)) {
+					return false;
+				}
+				if (builderWantsText(scanner->builder)) {
+					builderText(scanner->builder, text, close - text);
+				}
+				p = close + 3;
+			}
+			else {
+				//DOCTYPE and everything else that needs a DTD
+				return false;
+			}
+		}
+		else {
+			p = scanStartTag(scanner, p, end);
+		}
+
+		if (p == NULL) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/** Function to tokenize a whole GPX document held in memory and feed it to the scanner's builder
+ *@return true if the document was read, false if it uses something the scanner does not handle or is not well formed.
+          The builder should be thrown away when false is returned.
+ *@param Ptr- the scanner
+ *@param str- the document, does not need to be NUL terminated
+ *@param int- the length of the document
+ **/
+bool scanGPXBuffer(GPXScanner* scanner, const char* buffer, size_t len) {
+	const char* end = buffer + len;
+	const char* p = scanProlog(buffer, end);
+
+	if (p == NULL || !scanMarkup(scanner, p, end, NULL)) {
+		return false;
+	}
+	return scanner->seenRoot && scanner->numOpen == 0;
+}
+
+/** Function to check if a token that could not be read is all there, so more input would not help. Tags end at
+ *  the first '>' outside quotes, comments, CDATA and processing instructions at their closing sequence, and text
+ *  at the next tag.
+ *@return true if the token ends before end, or is markup the scanner never handles
+ *@param str- the start of the token
+ *@param str- the end of the input read so far
+ **/
+static bool tokenIsWhole(const char* p, const char* end) {
+	if (*p != '<') {
+		return true;
+	}
+	if (end - p < 2) {
+		return false;
+	}
+
+	if (p[1] == '!') {
+		long len = end - p;
+		if (len >= 4 && memcmp(p, "<!--", 4) == 0) {
+			return memmem(p + 4, len - 4, "-->", 3) != NULL;
+		}
+		if (len >= 9 && memcmp(p, "<![CDATA[", 9) == 0) {
+			return memmem(p + 9, len - 9, "]]>", 3) != NULL;
+		}
+		//DOCTYPE and the like are never read, only the start of a comment or CDATA can still turn into one
+		return !(len < 4 && memcmp(p, "<!--", len) == 0) && !(len < 9 && memcmp(p, "<![CDATA[", len) == 0);
+	}
+	if (p[1] == '?') {
+		return memmem(p + 2, end - p - 2, "?>", 2) != NULL;
+	}
+
+	char quote = 0;
+	for (const char* c = p + 1; c < end; c++) {
+		if (quote != 0) {
+			if (*c == quote) {
+				quote = 0;
+			}
+		}
+		else if (*c == '"' || *c == '\'') {
+			quote = *c;
+		}
+		else if (*c == '>') {
+			return true;
+		}
+	}
+	return false;
+}
+
+/** Function to tokenize the part of a GPX document written so far, such as a file that is still being appended to.
+ *  Only whole tokens are read, along with the text between them, and the rest is left for the next call.
+ *@return the number of bytes read from the start of the buffer, the caller passes the rest again with more input
+ *        after it. -1 if the document is not handled, or has a whole token that cannot be read.
+ *@param Ptr- the scanner
+ *@param str- the unread part of the document, does not need to be NUL terminated
+ *@param int- the length of the part
+ *@param bool- true if the part starts at the beginning of the document
+ **/
+long scanGPXPrefix(GPXScanner* scanner, const char* buffer, size_t len, bool atStart) {
+	const char* end = buffer + len;
+	const char* p = buffer;
+
+	if (atStart) {
+		//Too little to tell if an XML declaration follows the byte order mark
+		if (len < 9) {
+			return 0;
+		}
+		p = scanProlog(buffer, end);
+		if (p == NULL) {
+			//The XML declaration may not be all there yet
+			return memmem(buffer, len, "?>", 2) == NULL ? 0 : -1;
+		}
+	}
+
+	//Text after the last tag may still be growing, so stop at the end of that tag or at the start of one
+	//that is not finished
+	const char* lastOpen = memrchr(p, '<', end - p);
+	const char* lastClose = memrchr(p, '>', end - p);
+	const char* cut = p;
+	if (lastClose != NULL && (lastOpen == NULL || lastClose > lastOpen)) {
+		cut = lastClose + 1;
+	}
+	else if (lastOpen != NULL) {
+		cut = lastOpen;
+	}
+
+	//A token that fails is read again with the next call if a '>' inside a comment or attribute cut it short.
+	//One that is all there and still fails never will be read.
+	const char* stopped;
+	if (scanMarkup(scanner, p, cut, &stopped)) {
+		stopped = cut;
+	}
+	else if (tokenIsWhole(stopped, cut)) {
+		return -1;
+	}
+	return stopped - buffer;
+}
+
+/** Function to map a whole file into memory for reading
+ *@return the mapping, or NULL if the file is missing, empty or not a regular file
+ **/
+static char* mapFile(char* fileName, size_t* len) {
+	struct stat info;
+
+	int fd = open(fileName, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+	if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0) {
+		close(fd);
+		return NULL;
+	}
+
+	char* buffer = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (buffer == MAP_FAILED) {
+		return NULL;
+	}
+	madvise(buffer, info.st_size, MADV_SEQUENTIAL);
+	*len = info.st_size;
+	return buffer;
+}
+
+/** Function to build a GPX document from a buffer on the calling thread
+ *@return the new document, or NULL if the scanner does not handle the buffer
+ **/
+static GPXdoc* scanWholeBuffer(const char* buffer, size_t len, bool keepText) {
+	GPXBuilder builder;
+	GPXScanner scanner;
+
+	GPXdoc* tmpDoc = initializeGPXdoc();
+	initializeBuilder(&builder, tmpDoc);
+	builder.keepText = keepText;
+	initializeScanner(&scanner, &builder);
+
+	bool handled = scanGPXBuffer(&scanner, buffer, len);
+
+	clearScanner(&scanner);
+	clearBuilder(&builder);
+
+	if (!handled) {
+		deleteGPXdoc(tmpDoc);
+		return NULL;
+	}
+	return tmpDoc;
+}
+
+/** Function to build a GPX document by mapping a file into memory and tokenizing it directly, without libxml
+ *@return the new document, or NULL when handled is set to false
+ *@param str- the name of the GPX file
+ *@param bool- false to keep waypoint <ele> and <time> only as typed values
+ *@param Ptr- set to false if the file could not be read this way and has to go through libxml instead
+ **/
+GPXdoc* scanGPXFile(char* fileName, bool keepText, bool* handled) {
+	size_t len;
+	char* buffer = mapFile(fileName, &len);
+
+	*handled = false;
+	if (buffer == NULL) {
+		return NULL;
+	}
+
+	GPXdoc* tmpDoc = scanWholeBuffer(buffer, len, keepText);
+	munmap(buffer, len);
+
+	*handled = tmpDoc != NULL;
+	return tmpDoc;
+}
+
+/** Function to build a GPX document from a gzip compressed file, inflating it a block at a time and tokenizing
+ *  each block as it comes. Only the token cut off at the end of a block is kept, so memory does not grow with the file.
+ *@return the new document, or NULL when handled is set to false
+ *@param str- the name of the .gpx.gz file
+ *@param bool- false to keep waypoint <ele> and <time> only as typed values
+ *@param Ptr- set to false if the file could not be read this way and has to go through libxml instead
+ **/
+GPXdoc* scanGzipGPXFile(char* fileName, bool keepText, bool* handled) {
+	*handled = false;
+
+	gzFile file = gzopen(fileName, "rb");
+	if (file == NULL) {
+		return NULL;
+	}
+	gzbuffer(file, GZIP_READ_SIZE);
+
+	GPXBuilder builder;
+	GPXScanner scanner;
+	GPXdoc* tmpDoc = initializeGPXdoc();
+	initializeBuilder(&builder, tmpDoc);
+	builder.keepText = keepText;
+	initializeScanner(&scanner, &builder);
+
+	long size = GZIP_READ_SIZE * 2;
+	long len = 0;
+	char* buffer = malloc(sizeof(char) * size);
+	bool atStart = true;
+	bool ok = true;
+	int got;
+
+	while ((got = gzread(file, buffer + len, GZIP_READ_SIZE)) > 0) {
+		len = len + got;
+
+		long used = scanGPXPrefix(&scanner, buffer, len, atStart);
+		if (used < 0) {
+			ok = false;
+			break;
+		}
+		if (used > 0) {
+			holdScannerNames(&scanner);
+			memmove(buffer, buffer + used, len - used);
+			len = len - used;
+			atStart = false;
+		}
+
+		//Room for the next block after the token that is still open
+		if (size - len < GZIP_READ_SIZE) {
+			size = len + GZIP_READ_SIZE * 2;
+			buffer = realloc(buffer, sizeof(char) * size);
+		}
+	}
+	gzclose(file);
+
+	//What is left is the end of the file, so it has to be whole now
+	if (ok && got == 0) {
+		if (atStart) {
+			ok = scanGPXBuffer(&scanner, buffer, len);
+		}
+		else {
+			ok = scanMarkup(&scanner, buffer, buffer + len, NULL) && scanner.seenRoot && scanner.numOpen == 0;
+		}
+	}
+	else {
+		ok = false;
+	}
+
+	free(buffer);
+	clearScanner(&scanner);
+	clearBuilder(&builder);
+
+	if (!ok) {
+		deleteGPXdoc(tmpDoc);
+		return NULL;
+	}
+	*handled = true;
+	return tmpDoc;
+}
+
+/* =========================================================   Parallel chunks   =========================================================== */
+
+/** Function to check if a name at p is the given one, followed by the end of a tag name
+ **/
+static bool tagIs(const char* p, const char* end, const char* name, int nameLen) {
+	return end - p > nameLen && memcmp(p, name, nameLen) == 0 && (isSpace(p[nameLen]) || p[nameLen] == '>' || p[nameLen] == '/');
+}
+
+/** Function to check that p comes straight after the end of the last tag, or on a new line after it. Files are
+ *  written one way or the other, while tag names typed into comments or CDATA rarely are.
+ **/
+static bool followsTag(const char* start, const char* p) {
+	bool newLine = false;
+	const char* gap = p;
+
+	while (p > start && isSpace(p[-1])) {
+		newLine = newLine || p[-1] == '\n';
+		p--;
+	}
+	return p > start && p[-1] == '>' && (p == gap || newLine);
+}
+
+/** Function to find the next place a chunk could start: a <trkseg> inside a track, or a <trk> or <rte> on the root.
+ *  These are only guesses, a match could sit in a comment or somewhere else in the tree. Every guess is checked
+ *  against where the chunk before it really ended before the chunks are joined.
+ *@return the < of the tag, or NULL if there is none
+ *@param str- where to start looking
+ *@param str- the end of the buffer
+ *@param Ptr- set to the depth the tag would open at, 2 for a segment and 1 otherwise
+ **/
+static const char* findSplit(const char* p, const char* end, int* depth) {
+	const char* start = p;
+
+	while (p < end && (p = memchr(p, '<', end - p)) != NULL) {
+		if (!followsTag(start, p)) {
+			p++;
+		}
+		else if (tagIs(p + 1, end, "trkseg", 6)) {
+			*depth = 2;
+			return p;
+		}
+		else if (tagIs(p + 1, end, "trk", 3) || tagIs(p + 1, end, "rte", 3)) {
+			*depth = 1;
+			return p;
+		}
+		else {
+			p++;
+		}
+	}
+	return NULL;
+}
+
+/** Function to find the end of the root start tag, skipping whitespace, comments and processing instructions before it
+ *@return a pointer past the >, or NULL if the prolog holds anything else
+ **/
+static const char* findRootEnd(const char* p, const char* end) {
+	while (p < end) {
+		if (isSpace(*p)) {
+			p++;
+		}
+		else if (end - p >= 4 && memcmp(p, "<!--", 4) == 0) {
+			const char* close = memmem(p + 4, end - p - 4, "-->", 3);
+			if (close == NULL) {
+				return NULL;
+			}
+			p = close + 3;
+		}
+		else if (end - p >= 2 && memcmp(p, "<?", 2) == 0) {
+			const char* close = memmem(p + 2, end - p - 2, "?>", 2);
+			if (close == NULL) {
+				return NULL;
+			}
+			p = close + 2;
+		}
+		else if (*p == '<' && end - p >= 2 && isNameStart(p[1])) {
+			char quote = '\0';
+			for (p++; p < end; p++) {
+				if (quote != '\0') {
+					if (*p == quote) {
+						quote = '\0';
+					}
+				}
+				else if (*p == '"' || *p == '\'') {
+					quote = *p;
+				}
+				else if (*p == '>') {
+					return p + 1;
+				}
+			}
+			return NULL;
+		}
+		else {
+			return NULL;
+		}
+	}
+	return NULL;
+}
+
+//One part of a file being parsed on its own thread into its own document
+typedef struct {
+    const char* start;
+    const char* stop;
+
+    //Depth of the element the chunk starts in, 1 for the root and 2 for a track on the root
+    int depth;
+
+    GPXdoc* doc;
+    GPXBuilder builder;
+    GPXScanner scanner;
+
+    //Stands in for the track a depth 2 chunk starts inside, its segments belong to the track of the chunk before.
+    //continuedName is its name before the chunk was read, to tell if the chunk set one.
+    Track* continued;
+    char* continuedName;
+
+    //Whether the chunk was read to its end, and where it stopped if not
+    bool ok;
+    const char* stopped;
+} GPXChunk;
+
+/** Function to read one chunk, run on a worker thread
+ **/
+static void scanChunk(void* arg, int index) {
+	GPXChunk* chunk = &((GPXChunk*)arg)[index];
+	chunk->ok = scanMarkup(&chunk->scanner, chunk->start, chunk->stop, &chunk->stopped);
+}
+
+/** Function to carry on reading a chunk through the next one, when the split between them was not a real
+ *  element boundary. The next chunk's own result is thrown away.
+ **/
+static void absorbChunk(GPXChunk* chunk, GPXChunk* next) {
+	const char* from = chunk->ok ? chunk->stop : chunk->stopped;
+
+	chunk->ok = scanMarkup(&chunk->scanner, from, next->stop, &chunk->stopped);
+	chunk->stop = next->stop;
+
+	clearScanner(&next->scanner);
+	clearBuilder(&next->builder);
+	deleteGPXdoc(next->doc);
+	next->doc = NULL;
+}
+
+/** Function to push an open element onto a scanner that starts in the middle of a document
+ **/
+static void seedOpen(GPXScanner* scanner, const char* name, int nameLen) {
+	if (scanner->numOpen == scanner->sizeOpen) {
+		scanner->sizeOpen = scanner->sizeOpen == 0 ? 16 : scanner->sizeOpen * 2;
+		scanner->openNames = realloc(scanner->openNames, sizeof(char*) * scanner->sizeOpen);
+		scanner->openLens = realloc(scanner->openLens, sizeof(int) * scanner->sizeOpen);
+	}
+	scanner->openNames[scanner->numOpen] = name;
+	scanner->openLens[scanner->numOpen] = nameLen;
+	scanner->numOpen++;
+}
+
+/** Function to set a chunk up to start where the root start tag left the first chunk's scanner, plus an open
+ *  track for a depth 2 chunk
+ **/
+static void seedChunk(GPXChunk* chunk, const GPXScanner* first, bool keepText) {
+	chunk->doc = initializeGPXdoc();
+	initializeBuilder(&chunk->builder, chunk->doc);
+	chunk->builder.keepText = keepText;
+	chunk->builder.depth = chunk->depth;
+	initializeScanner(&chunk->scanner, &chunk->builder);
+
+	chunk->scanner.seenRoot = true;
+	seedOpen(&chunk->scanner, first->openNames[0], first->openLens[0]);
+	for (int i = 0; i < first->numNamespaces; i++) {
+		const GPXNamespace* ns = &first->namespaces[i];
+		pushNamespace(&chunk->scanner, ns->prefix, ns->prefixLen, ns->href, ns->hrefLen);
+		chunk->scanner.namespaces[i].depth = ns->depth;
+	}
+
+	if (chunk->depth == 2) {
+		seedOpen(&chunk->scanner, "trk", 3);
+		chunk->continued = initializeTrack(chunk->doc->arena);
+		chunk->continuedName = chunk->continued->name;
+		chunk->builder.track = chunk->continued;
+		chunk->builder.objectDepth = 2;
+	}
+}
+
+/** Function to check that a chunk ended exactly in the state the next chunk was started in
+ *@return true if the two chunks join up, so parsing them apart gave the same result as parsing them in one go
+ **/
+static bool chunksJoin(const GPXChunk* chunk, const GPXChunk* next, const GPXScanner* first) {
+	const GPXScanner* scanner = &chunk->scanner;
+	const GPXBuilder* builder = &chunk->builder;
+
+	if (!chunk->ok || scanner->numOpen != next->depth || scanner->numNamespaces != first->numNamespaces) {
+		return false;
+	}
+	if (scanner->openLens[0] != first->openLens[0] || memcmp(scanner->openNames[0], first->openNames[0], first->openLens[0]) != 0) {
+		return false;
+	}
+	if (next->depth == 2 && (scanner->openLens[1] != 3 || memcmp(scanner->openNames[1], "trk", 3) != 0)) {
+		return false;
+	}
+	for (int i = 0; i < first->numNamespaces; i++) {
+		const GPXNamespace* a = &scanner->namespaces[i];
+		const GPXNamespace* b = &first->namespaces[i];
+		if (a->prefix != b->prefix || a->prefixLen != b->prefixLen || a->href != b->href || a->hrefLen != b->hrefLen || a->depth != b->depth) {
+			return false;
+		}
+	}
+
+	if (builder->depth != next->depth || builder->dataDepth != 0 || builder->waypoint != NULL || builder->segment != NULL || builder->route != NULL) {
+		return false;
+	}
+	if (next->depth == 2) {
+		return builder->track != NULL && builder->objectDepth == 2;
+	}
+	return builder->track == NULL && builder->objectDepth == 0;
+}
+
+/** Function to join the chunk documents into the first one, in file order
+ **/
+static GPXdoc* stitchChunks(GPXChunk* chunks, int numChunks) {
+	GPXdoc* doc = chunks[0].doc;
+	Track* openTrack = chunks[0].builder.track;
+
+	for (int i = 1; i < numChunks; i++) {
+		GPXChunk* chunk = &chunks[i];
+		if (chunk->doc == NULL) {
+			continue;
+		}
+		arenaMerge(doc->arena, chunk->doc->arena);
+		mergeCounts(doc->counts, chunk->doc->counts);
+
+		if (chunk->continued != NULL) {
+			appendList(openTrack->segments, chunk->continued->segments);
+			appendList(openTrack->otherData, chunk->continued->otherData);
+			if (chunk->continued->name != chunk->continuedName) {
+				openTrack->name = chunk->continued->name;
+			}
+		}
+		appendList(doc->waypoints, chunk->doc->waypoints);
+		appendList(doc->routes, chunk->doc->routes);
+		appendList(doc->tracks, chunk->doc->tracks);
+
+		//The track still open at the end of this chunk, the next one may carry on inside it
+		if (chunk->builder.track != chunk->continued) {
+			openTrack = chunk->builder.track;
+		}
+		chunk->doc = NULL;
+	}
+
+	//The counts were joined along with the lists
+	markCountsCurrent(doc->counts);
+	chunks[0].doc = NULL;
+	return doc;
+}
+
+/** Function to build a GPX document by splitting a mapped file at <trkseg>, <trk> and <rte> tags and tokenizing
+ *  the chunks on a pool of threads. The chunk documents are joined in order, so the result is the one scanGPXFile
+ *  gives. When a split turns out not to be a real element boundary the file is read again on one thread.
+ *@return the new document, or NULL when handled is set to false
+ *@param str- the name of the GPX file
+ *@param bool- false to keep waypoint <ele> and <time> only as typed values
+ *@param int- the number of threads, 0 or less for one per processor
+ *@param Ptr- set to false if the file could not be read this way and has to go through libxml instead
+ **/
+GPXdoc* scanGPXFileParallel(char* fileName, bool keepText, int numThreads, bool* handled) {
+	size_t len;
+	char* buffer = mapFile(fileName, &len);
+
+	*handled = false;
+	if (buffer == NULL) {
+		return NULL;
+	}
+	if (numThreads <= 0) {
+		numThreads = defaultThreadCount();
+	}
+
+	const char* end = buffer + len;
+	const char* p = scanProlog(buffer, end);
+	const char* rootEnd = p == NULL ? NULL : findRootEnd(p, end);
+	int numChunks = len / MIN_CHUNK_SIZE < (size_t)numThreads ? len / MIN_CHUNK_SIZE : (size_t)numThreads;
+	GPXdoc* tmpDoc = NULL;
+
+	if (rootEnd != NULL && numChunks > 1) {
+		GPXChunk* chunks = calloc(numChunks, sizeof(GPXChunk));
+		GPXChunk* first = &chunks[0];
+
+		//The root start tag is read first, every other chunk starts with its namespaces in scope
+		first->doc = initializeGPXdoc();
+		initializeBuilder(&first->builder, first->doc);
+		first->builder.keepText = keepText;
+		initializeScanner(&first->scanner, &first->builder);
+		first->depth = 0;
+		first->start = rootEnd;
+		bool ok = scanMarkup(&first->scanner, p, rootEnd, NULL) && first->scanner.numOpen == 1;
+
+		//Split near equal fractions of the file
+		int found = 1;
+		for (int i = 1; ok && i < numChunks; i++) {
+			const char* from = buffer + len / numChunks * i;
+			if (from < chunks[found - 1].start + 1) {
+				from = chunks[found - 1].start + 1;
+			}
+			int depth;
+			const char* split = findSplit(from, end, &depth);
+			if (split == NULL) {
+				break;
+			}
+			chunks[found - 1].stop = split;
+			chunks[found].start = split;
+			chunks[found].depth = depth;
+			found++;
+		}
+		chunks[found - 1].stop = end;
+		numChunks = found;
+
+		if (ok && numChunks > 1) {
+			for (int i = 1; i < numChunks; i++) {
+				seedChunk(&chunks[i], &first->scanner, keepText);
+			}
+
+			GPXThreadPool* pool = createThreadPool(numChunks);
+			if (pool != NULL) {
+				runThreadPool(pool, numChunks, scanChunk, chunks);
+				freeThreadPool(pool);
+			}
+			else {
+				for (int i = 0; i < numChunks; i++) {
+					scanChunk(chunks, i);
+				}
+			}
+
+			//A guess that was not a real boundary costs one chunk read again on this thread, not the whole file
+			int last = 0;
+			for (int i = 1; i < numChunks; i++) {
+				if (chunksJoin(&chunks[last], &chunks[i], &first->scanner)) {
+					last = i;
+				}
+				else {
+					absorbChunk(&chunks[last], &chunks[i]);
+				}
+			}
+			if (chunks[last].ok && chunks[last].scanner.numOpen == 0) {
+				tmpDoc = stitchChunks(chunks, numChunks);
+			}
+		}
+
+		for (int i = 0; i < numChunks; i++) {
+			clearScanner(&chunks[i].scanner);
+			clearBuilder(&chunks[i].builder);
+			if (chunks[i].doc != NULL) {
+				deleteGPXdoc(chunks[i].doc);
+			}
+		}
+		free(chunks);
+	}
+
+	if (tmpDoc == NULL) {
+		tmpDoc = scanWholeBuffer(buffer, len, keepText);
+	}
+	munmap(buffer, len);
+
+	*handled = tmpDoc != NULL;
+	return tmpDoc;
+}
@@ -0,0 +1,1054 @@
+/**
+ * Created by: Alexander Blankenstein
+ **/
+
+#define _DEFAULT_SOURCE
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include "GPXParser.h"
+#include "GPXHelper.h"
+#include "GPXArena.h"
+#include "GPXColumns.h"
+#include "GPXNames.h"
+#include "LinkedListAPI.h"
+
+/* A .gpxb snapshot is a GPXdoc flattened into fixed size records, so loading it is one pass that copies values
+ * into a new arena instead of parsing XML. createSnapshotGPXdoc copies everything but the route and segment
+ * points, which are read from the snapshot file one route or segment at a time when first used, the way
+ * createLazyGPXdoc reads them from the GPX file. After the header come, each padded to 8 bytes:
+ *   names     uint32 string offset per GPXData name used, GPXData refer to names by their index in this table
+ *   points    GPXSnapPoint, the document's waypoints first, then the points of each route and segment in order
+ *   data      GPXSnapData, the other data of the points, routes and tracks
+ *   routes    GPXSnapRoute
+ *   tracks    GPXSnapTrack
+ *   segments  GPXSnapSegment
+ *   strings   NUL terminated strings, referred to by byte offset
+ * Values are stored in the byte order of the machine that wrote them, a snapshot from another one is rejected. */
+
+#define SNAPSHOT_MAGIC "GPXB"
+#define SNAPSHOT_VERSION 3
+#define SNAPSHOT_BYTE_ORDER 0x01020304
+
+//Extension of the snapshot written beside a GPX file
+#define SNAPSHOT_EXTENSION ".gpxb"
+
+typedef struct {
+	char magic[4];
+	uint32_t version;
+	uint32_t byteOrder;
+	//CRC-32 of everything after the header
+	uint32_t checksum;
+	uint64_t payloadSize;
+
+	//Size and modification time of the GPX file the snapshot was made from, both 0 if it was not made from a file
+	uint64_t sourceSize;
+	int64_t sourceModified;
+
+	double docVersion;
+	uint32_t creator;
+	uint32_t namespaceName;
+
+	uint32_t numNames;
+	uint32_t numPoints;
+	uint32_t numData;
+	uint32_t numWaypoints;
+	uint32_t numRoutes;
+	uint32_t numTracks;
+	uint32_t numSegments;
+	uint32_t stringBytes;
+} GPXSnapHeader;
+
+//A waypoint, route point or track point
+typedef struct {
+	double lat;
+	double lon;
+	//The values of the point in the columns of its route or segment
+	double columnEle;
+	int64_t columnTime;
+	int64_t time;
+	float elevation;
+	uint32_t name;
+	uint32_t firstData;
+	uint32_t numData;
+	//Waypoint.droppedText
+	uint32_t droppedText;
+	uint32_t unused;
+} GPXSnapPoint;
+
+typedef struct {
+	uint32_t name;
+	uint32_t value;
+	//1 if the data is in the sparse table of its route or segment columns
+	uint32_t inColumns;
+} GPXSnapData;
+
+typedef struct {
+	int32_t numPoints;
+	float length;
+	double firstLat;
+	double firstLon;
+	double lastLat;
+	double lastLon;
+} GPXSnapTotals;
+
+typedef struct {
+	uint32_t name;
+	uint32_t firstData;
+	uint32_t numData;
+	uint32_t firstPoint;
+	uint32_t numPoints;
+	//1 if the columns matched the points when the snapshot was written
+	uint32_t hasColumns;
+	//The run of strings the points use, so they can be read on their own
+	uint32_t firstString;
+	uint32_t stringBytes;
+	GPXSnapTotals totals;
+} GPXSnapRoute;
+
+typedef struct {
+	uint32_t name;
+	uint32_t firstData;
+	uint32_t numData;
+	uint32_t firstSegment;
+	uint32_t numSegments;
+	uint32_t hasTotals;
+	GPXSnapTotals totals;
+} GPXSnapTrack;
+
+typedef struct {
+	uint32_t firstPoint;
+	uint32_t numPoints;
+	uint32_t hasColumns;
+	uint32_t firstString;
+	uint32_t stringBytes;
+	uint32_t unused;
+} GPXSnapSegment;
+
+_Static_assert(sizeof(GPXSnapHeader) == 88, "snapshot header layout");
+_Static_assert(sizeof(GPXSnapPoint) == 64, "snapshot point layout");
+_Static_assert(sizeof(GPXSnapData) == 12, "snapshot data layout");
+_Static_assert(sizeof(GPXSnapRoute) == 72, "snapshot route layout");
+_Static_assert(sizeof(GPXSnapTrack) == 64, "snapshot track layout");
+_Static_assert(sizeof(GPXSnapSegment) == 24, "snapshot segment layout");
+
+//Offsets of the sections from the end of the header
+typedef struct {
+	uint64_t names;
+	uint64_t points;
+	uint64_t data;
+	uint64_t routes;
+	uint64_t tracks;
+	uint64_t segments;
+	uint64_t strings;
+	uint64_t end;
+} GPXSnapLayout;
+
+/** Function to round a section size up to a multiple of 8 bytes
+ **/
+static uint64_t padded(uint64_t len) {
+	return (len + 7) & ~(uint64_t)7;
+}
+
+/** Function to work out where the sections of a snapshot are from the counts in its header
+ **/
+static GPXSnapLayout snapshotLayout(const GPXSnapHeader* header) {
+	GPXSnapLayout layout;
+	layout.names = 0;
+	layout.points = layout.names + padded((uint64_t)header->numNames * sizeof(uint32_t));
+	layout.data = layout.points + (uint64_t)header->numPoints * sizeof(GPXSnapPoint);
+	layout.routes = layout.data + padded((uint64_t)header->numData * sizeof(GPXSnapData));
+	layout.tracks = layout.routes + (uint64_t)header->numRoutes * sizeof(GPXSnapRoute);
+	layout.segments = layout.tracks + (uint64_t)header->numTracks * sizeof(GPXSnapTrack);
+	layout.strings = layout.segments + (uint64_t)header->numSegments * sizeof(GPXSnapSegment);
+	layout.end = layout.strings + padded(header->stringBytes);
+	return layout;
+}
+
+/** Function that returns the name of the snapshot kept beside a GPX file, a.gpx and a.gpx.gz both get a.gpxb
+ *@return the name, to be freed by the caller, or NULL if the file is not a GPX file
+ **/
+static char* snapshotName(const char* fileName) {
+	int kind = gpxFileKind(fileName);
+	if (kind == GPX_FILE_NONE) {
+		return NULL;
+	}
+
+	int len = strlen(fileName) - (kind == GPX_FILE_GZIP ? 7 : 4);
+	char* name = malloc(sizeof(char) * (len + strlen(SNAPSHOT_EXTENSION) + 1));
+	memcpy(name, fileName, len);
+	strcpy(name + len, SNAPSHOT_EXTENSION);
+	return name;
+}
+
+/* =========================================================   Writing   =========================================================== */
+
+//A section being filled
+typedef struct {
+	char* bytes;
+	uint64_t len;
+	uint64_t size;
+} GPXSnapBuffer;
+
+typedef struct {
+	GPXSnapBuffer names;
+	GPXSnapBuffer points;
+	GPXSnapBuffer data;
+	GPXSnapBuffer routes;
+	GPXSnapBuffer tracks;
+	GPXSnapBuffer segments;
+	GPXSnapBuffer strings;
+
+	//Index in the name table plus one for each interned name id, 0 for names not in the table yet
+	uint32_t* nameIndex;
+	int sizeNameIndex;
+	uint32_t numNames;
+} GPXSnapWriter;
+
+/** Function to add bytes to the end of a section
+ *@return the offset they were added at
+ **/
+static uint64_t appendBytes(GPXSnapBuffer* buffer, const void* bytes, uint64_t len) {
+	if (buffer->len + len > buffer->size) {
+		buffer->size = (buffer->len + len) * 2;
+		buffer->bytes = realloc(buffer->bytes, buffer->size);
+	}
+	memcpy(buffer->bytes + buffer->len, bytes, len);
+	buffer->len = buffer->len + len;
+	return buffer->len - len;
+}
+
+/** Function to add a string to the string section
+ *@return its offset
+ **/
+static uint32_t addString(GPXSnapWriter* writer, const char* str) {
+	return appendBytes(&writer->strings, str, strlen(str) + 1);
+}
+
+/** Function to look up a GPXData name in the name table, adding it the first time
+ *@return its index in the table
+ **/
+static uint32_t addName(GPXSnapWriter* writer, int nameId) {
+	if (nameId >= writer->sizeNameIndex) {
+		int size = (nameId + 1) * 2;
+		writer->nameIndex = realloc(writer->nameIndex, sizeof(uint32_t) * size);
+		memset(writer->nameIndex + writer->sizeNameIndex, 0, sizeof(uint32_t) * (size - writer->sizeNameIndex));
+		writer->sizeNameIndex = size;
+	}
+	if (writer->nameIndex[nameId] == 0) {
+		uint32_t offset = addString(writer, gpxNameString(nameId));
+		appendBytes(&writer->names, &offset, sizeof(uint32_t));
+		writer->numNames++;
+		writer->nameIndex[nameId] = writer->numNames;
+	}
+	return writer->nameIndex[nameId] - 1;
+}
+
+/** Function to add the records for a list of GPXData
+ *@return the index of the first one
+ **/
+static uint32_t addData(GPXSnapWriter* writer, List* list, uint32_t* numData) {
+	uint32_t first = writer->data.len / sizeof(GPXSnapData);
+	ListIterator iter = createIterator(list);
+	GPXData* data;
+
+	*numData = 0;
+	while ((data = nextElement(&iter)) != NULL) {
+		GPXSnapData record = {addName(writer, data->nameId), addString(writer, data->value), 0};
+		appendBytes(&writer->data, &record, sizeof(GPXSnapData));
+		(*numData)++;
+	}
+	return first;
+}
+
+/** Function to copy totals into their record, numPoints stays -1 for totals that were never filled
+ **/
+static void snapTotals(GPXSnapTotals* record, const GPXTotals* totals) {
+	memset(record, 0, sizeof(GPXSnapTotals));
+	record->numPoints = -1;
+	if (totals != NULL) {
+		record->numPoints = totals->numPoints;
+		record->length = totals->length;
+		record->firstLat = totals->firstLat;
+		record->firstLon = totals->firstLon;
+		record->lastLat = totals->lastLat;
+		record->lastLon = totals->lastLon;
+	}
+}
+
+/** Function to add the records for a list of points, along with their columns when those match the list
+ *@return the index of the first point
+ **/
+static uint32_t addPoints(GPXSnapWriter* writer, List* list, const PointColumns* columns, uint32_t* numPoints) {
+	uint32_t first = writer->points.len / sizeof(GPXSnapPoint);
+	ListIterator iter = createIterator(list);
+	Waypoint* waypoint;
+	int sparse = 0;
+
+	*numPoints = 0;
+	while ((waypoint = nextElement(&iter)) != NULL) {
+		int index = *numPoints;
+		GPXSnapPoint record;
+		memset(&record, 0, sizeof(GPXSnapPoint));
+		record.lat = waypoint->latitude;
+		record.lon = waypoint->longitude;
+		record.columnEle = columns != NULL ? columns->ele[index] : NAN;
+		record.columnTime = columns != NULL ? columns->time[index] : GPX_NO_TIME;
+		record.time = waypoint->time;
+		record.elevation = waypoint->elevation;
+		record.droppedText = waypoint->droppedText;
+		record.name = addString(writer, waypoint->name);
+		record.firstData = addData(writer, waypoint->otherData, &record.numData);
+
+		//The sparse table holds the point's data that did not go into the ele and time columns, in list order
+		if (columns != NULL) {
+			GPXSnapData* data = (GPXSnapData*)writer->data.bytes + record.firstData;
+			ListIterator iter2 = createIterator(waypoint->otherData);
+			GPXData* otherData;
+
+			for (int i = 0; (otherData = nextElement(&iter2)) != NULL; i++) {
+				if (sparse < columns->numData && columns->dataPoint[sparse] == index && columns->data[sparse] == otherData) {
+					data[i].inColumns = 1;
+					sparse++;
+				}
+			}
+		}
+
+		appendBytes(&writer->points, &record, sizeof(GPXSnapPoint));
+		(*numPoints)++;
+	}
+	return first;
+}
+
+/** Function to flatten a document into the sections of a writer
+ **/
+static void snapDoc(GPXSnapWriter* writer, GPXdoc* doc, GPXSnapHeader* header) {
+	header->docVersion = doc->version;
+	header->creator = addString(writer, doc->creator);
+	header->namespaceName = addString(writer, doc->namespace);
+
+	addPoints(writer, doc->waypoints, NULL, &header->numWaypoints);
+
+	ListIterator iter = createIterator(doc->routes);
+	Route* route;
+	while ((route = nextElement(&iter)) != NULL) {
+		GPXSnapRoute record;
+		memset(&record, 0, sizeof(GPXSnapRoute));
+		const PointColumns* columns = getRouteColumns(route);
+
+		record.name = addString(writer, route->name);
+		record.firstData = addData(writer, route->otherData, &record.numData);
+		record.firstString = writer->strings.len;
+		record.firstPoint = addPoints(writer, route->waypoints, columns, &record.numPoints);
+		record.stringBytes = writer->strings.len - record.firstString;
+		record.hasColumns = columns != NULL;
+		snapTotals(&record.totals, route->totals);
+		appendBytes(&writer->routes, &record, sizeof(GPXSnapRoute));
+	}
+
+	iter = createIterator(doc->tracks);
+	Track* track;
+	while ((track = nextElement(&iter)) != NULL) {
+		GPXSnapTrack record;
+		memset(&record, 0, sizeof(GPXSnapTrack));
+
+		record.name = addString(writer, track->name);
+		record.firstData = addData(writer, track->otherData, &record.numData);
+		record.firstSegment = writer->segments.len / sizeof(GPXSnapSegment);
+		record.hasTotals = track->totals != NULL;
+		snapTotals(&record.totals, track->totals);
+
+		ListIterator iter2 = createIterator(track->segments);
+		TrackSegment* segment;
+		while ((segment = nextElement(&iter2)) != NULL) {
+			GPXSnapSegment segRecord;
+			memset(&segRecord, 0, sizeof(GPXSnapSegment));
+			const PointColumns* columns = getSegmentColumns(segment);
+
+			segRecord.firstString = writer->strings.len;
+			segRecord.firstPoint = addPoints(writer, segment->waypoints, columns, &segRecord.numPoints);
+			segRecord.stringBytes = writer->strings.len - segRecord.firstString;
+			segRecord.hasColumns = columns != NULL;
+			appendBytes(&writer->segments, &segRecord, sizeof(GPXSnapSegment));
+			record.numSegments++;
+		}
+		appendBytes(&writer->tracks, &record, sizeof(GPXSnapTrack));
+	}
+
+	header->numNames = writer->numNames;
+	header->numPoints = writer->points.len / sizeof(GPXSnapPoint);
+	header->numData = writer->data.len / sizeof(GPXSnapData);
+	header->numRoutes = writer->routes.len / sizeof(GPXSnapRoute);
+	header->numTracks = writer->tracks.len / sizeof(GPXSnapTrack);
+	header->numSegments = writer->segments.len / sizeof(GPXSnapSegment);
+	header->stringBytes = writer->strings.len;
+}
+
+/** Function to write a section padded to 8 bytes, adding it to the checksum
+ **/
+static bool writeSection(FILE* file, const GPXSnapBuffer* buffer, uLong* checksum) {
+	static const char zeros[8] = {0};
+	uint64_t pad = padded(buffer->len) - buffer->len;
+
+	if (buffer->len > 0) {
+		*checksum = crc32_z(*checksum, (const Bytef*)buffer->bytes, buffer->len);
+		if (fwrite(buffer->bytes, 1, buffer->len, file) != buffer->len) {
+			return false;
+		}
+	}
+	*checksum = crc32_z(*checksum, (const Bytef*)zeros, pad);
+	return fwrite(zeros, 1, pad, file) == pad;
+}
+
+/** Function to write a snapshot of a document, recording the size and modification time of its source
+ *@return true if the whole snapshot was written
+ **/
+static bool writeSnapshot(GPXdoc* doc, const char* fileName, uint64_t sourceSize, int64_t sourceModified) {
+	GPXSnapWriter writer;
+	GPXSnapHeader header;
+	memset(&writer, 0, sizeof(GPXSnapWriter));
+	memset(&header, 0, sizeof(GPXSnapHeader));
+
+	snapDoc(&writer, doc, &header);
+
+	memcpy(header.magic, SNAPSHOT_MAGIC, 4);
+	header.version = SNAPSHOT_VERSION;
+	header.byteOrder = SNAPSHOT_BYTE_ORDER;
+	header.sourceSize = sourceSize;
+	header.sourceModified = sourceModified;
+	header.payloadSize = snapshotLayout(&header).end;
+
+	//String offsets are 32 bits
+	bool ok = writer.strings.len <= UINT32_MAX;
+
+	//Written next to the snapshot and renamed over it, so a reader never sees half of one. The name is
+	//unique so two writers of the same snapshot do not write into one file.
+	char* tmpName = malloc(sizeof(char) * (strlen(fileName) + 8));
+	sprintf(tmpName, "%s.XXXXXX", fileName);
+	FILE* file = NULL;
+	int fd = ok ? mkstemp(tmpName) : -1;
+	if (fd >= 0) {
+		fchmod(fd, 0644);
+		file = fdopen(fd, "wb");
+		if (file == NULL) {
+			close(fd);
+			remove(tmpName);
+		}
+	}
+
+	if (file != NULL) {
+		uLong checksum = crc32_z(0L, Z_NULL, 0);
+		ok = fwrite(&header, sizeof(GPXSnapHeader), 1, file) == 1
+			&& writeSection(file, &writer.names, &checksum)
+			&& writeSection(file, &writer.points, &checksum)
+			&& writeSection(file, &writer.data, &checksum)
+			&& writeSection(file, &writer.routes, &checksum)
+			&& writeSection(file, &writer.tracks, &checksum)
+			&& writeSection(file, &writer.segments, &checksum)
+			&& writeSection(file, &writer.strings, &checksum);
+
+		//The checksum is only known at the end
+		header.checksum = checksum;
+		ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(GPXSnapHeader), 1, file) == 1;
+		ok = fclose(file) == 0 && ok;
+		ok = ok && rename(tmpName, fileName) == 0;
+		if (!ok) {
+			remove(tmpName);
+		}
+	}
+	else {
+		ok = false;
+	}
+
+	free(tmpName);
+	free(writer.names.bytes);
+	free(writer.points.bytes);
+	free(writer.data.bytes);
+	free(writer.routes.bytes);
+	free(writer.tracks.bytes);
+	free(writer.segments.bytes);
+	free(writer.strings.bytes);
+	free(writer.nameIndex);
+	return ok;
+}
+
+/* =========================================================   Loading   =========================================================== */
+
+//The snapshot file a document from createSnapshotGPXdoc reads its points from, shared by all of its parts
+typedef struct {
+	char* fileName;
+
+	//Size and modification time of the snapshot when the document was made, parts are only read from that same file
+	long long size;
+	long long modified;
+
+	//Where the points, data and strings sections start in the file, and how many records and bytes they hold
+	uint64_t pointsStart;
+	uint64_t dataStart;
+	uint64_t stringsStart;
+	uint32_t numData;
+	uint32_t numNames;
+	uint32_t stringBytes;
+
+	//Interned id for each entry of the name table
+	int* nameIds;
+} GPXSnapFile;
+
+//The points of one route or track segment in the snapshot file
+typedef struct {
+	GPXSnapFile* file;
+	uint32_t firstPoint;
+	uint32_t numPoints;
+	uint32_t firstString;
+	uint32_t stringBytes;
+
+	//The columns of the route or segment, swapped for the ones built when the points are loaded. NULL if the
+	//snapshot has none for it.
+	PointColumns** columns;
+} GPXSnapPart;
+
+//A snapshot mapped into memory, with pointers to its sections
+typedef struct {
+	const GPXSnapHeader* header;
+	const uint32_t* names;
+	const GPXSnapPoint* points;
+	const GPXSnapData* data;
+	const GPXSnapRoute* routes;
+	const GPXSnapTrack* tracks;
+	const GPXSnapSegment* segments;
+	const char* strings;
+
+	//Index of the first data record and offset of the first string held, when only a part of them was read
+	uint32_t dataBase;
+	uint32_t stringBase;
+
+	//Interned id for each entry of the name table
+	int* nameIds;
+	GPXArena* arena;
+
+	//The file the route and segment points are left in until they are used, NULL to copy them straight away
+	GPXSnapFile* file;
+} GPXSnapReader;
+
+/** Function to check that a run of records lies inside a section
+ **/
+static bool inRange(uint32_t first, uint32_t count, uint32_t total) {
+	return (uint64_t)first + count <= total;
+}
+
+/** Function to build a GPXData out of its record
+ **/
+static GPXData* loadData(const GPXSnapReader* reader, const GPXSnapData* record) {
+	const char* value = reader->strings + (record->value - reader->stringBase);
+	size_t len = strlen(value);
+	GPXData* data = arenaAlloc(reader->arena, sizeof(GPXData) + sizeof(char) * (len + 1));
+	data->nameId = reader->nameIds[record->name];
+	memcpy(data->value, value, len + 1);
+	return data;
+}
+
+/** Function to fill a list of GPXData from a run of records
+ **/
+static void loadDataList(const GPXSnapReader* reader, List* list, uint32_t first, uint32_t count) {
+	for (uint32_t i = first; i < first + count; i++) {
+		insertBack(list, loadData(reader, &reader->data[i - reader->dataBase]));
+	}
+}
+
+/** Function to fill a list of waypoints from a run of point records, and the columns when there are any
+ **/
+static void loadPoints(const GPXSnapReader* reader, List* list, PointColumns* columns, uint32_t first, uint32_t count) {
+	if (columns != NULL && count > 0) {
+		columns->lat = malloc(sizeof(double) * count);
+		columns->lon = malloc(sizeof(double) * count);
+		columns->ele = malloc(sizeof(double) * count);
+		columns->time = malloc(sizeof(int64_t) * count);
+		columns->size = count;
+
+		int numData = 0;
+		for (uint32_t i = first; i < first + count; i++) {
+			for (uint32_t j = reader->points[i].firstData; j < reader->points[i].firstData + reader->points[i].numData; j++) {
+				numData = numData + (reader->data[j - reader->dataBase].inColumns != 0);
+			}
+		}
+		if (numData > 0) {
+			columns->dataPoint = malloc(sizeof(int) * numData);
+			columns->data = malloc(sizeof(GPXData*) * numData);
+			columns->sizeData = numData;
+		}
+	}
+
+	for (uint32_t i = first; i < first + count; i++) {
+		const GPXSnapPoint* record = &reader->points[i];
+		Waypoint* waypoint = initializeWaypoint(reader->arena);
+		const char* name = reader->strings + (record->name - reader->stringBase);
+
+		//The waypoint already has an empty name
+		if (name[0] != '\0') {
+			waypoint->name = arenaString(reader->arena, name, strlen(name));
+		}
+		waypoint->latitude = record->lat;
+		waypoint->longitude = record->lon;
+		waypoint->elevation = record->elevation;
+		waypoint->time = record->time;
+		waypoint->droppedText = record->droppedText;
+
+		for (uint32_t j = record->firstData; j < record->firstData + record->numData; j++) {
+			const GPXSnapData* dataRecord = &reader->data[j - reader->dataBase];
+			GPXData* data = loadData(reader, dataRecord);
+			insertBack(waypoint->otherData, data);
+			if (columns != NULL && dataRecord->inColumns != 0) {
+				columns->dataPoint[columns->numData] = columns->length;
+				columns->data[columns->numData] = data;
+				columns->numData++;
+			}
+		}
+
+		if (columns != NULL) {
+			columns->lat[columns->length] = record->lat;
+			columns->lon[columns->length] = record->lon;
+			columns->ele[columns->length] = record->columnEle;
+			columns->time[columns->length] = record->columnTime;
+			columns->length++;
+		}
+		insertBack(list, waypoint);
+	}
+}
+
+/** Function to read a run of bytes of a snapshot file into memory
+ *@return the bytes, to be freed by the caller, or NULL if they could not all be read
+ **/
+static char* readSnapshotBytes(int fd, uint64_t offset, uint64_t len) {
+	char* bytes = malloc(len > 0 ? len : 1);
+	if (!readFileAt(fd, bytes, len, offset)) {
+		free(bytes);
+		return NULL;
+	}
+	return bytes;
+}
+
+/** Function to check that the point records of a part only use the data records and strings read with them
+ **/
+static bool checkPart(const GPXSnapReader* reader, const GPXSnapPart* part, uint32_t endData) {
+	const char* strings = reader->strings;
+	uint32_t firstString = part->firstString;
+
+	if (part->stringBytes == 0 || strings[part->stringBytes - 1] != '\0') {
+		return false;
+	}
+	for (uint32_t i = 0; i < part->numPoints; i++) {
+		const GPXSnapPoint* record = &reader->points[i];
+		if (record->name < firstString || record->name - firstString >= part->stringBytes
+			|| record->firstData < reader->dataBase || !inRange(record->firstData, record->numData, endData)) {
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < endData - reader->dataBase; i++) {
+		const GPXSnapData* record = &reader->data[i];
+		if (record->name >= part->file->numNames || record->value < firstString || record->value - firstString >= part->stringBytes) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/** Function to add the points of a route or track segment of a document from createSnapshotGPXdoc to its
+ *  waypoint list, reading them from the snapshot. Meant for setListLoader. If the snapshot has changed or is
+ *  gone since the document was made, the list stays empty.
+ *@param Ptr- the waypoint list, its pool is the arena of the document
+ *@param Ptr- the GPXSnapPart it was given
+ **/
+static void loadSnapshotPart(List* list, void* source) {
+	GPXSnapPart* part = source;
+	GPXSnapFile* file = part->file;
+	GPXArena* arena = list->pool;
+	struct stat info;
+
+	if (arena == NULL) {
+		return;
+	}
+	int fd = open(file->fileName, O_RDONLY);
+	if (fd < 0) {
+		return;
+	}
+
+	GPXSnapReader reader;
+	memset(&reader, 0, sizeof(GPXSnapReader));
+	reader.nameIds = file->nameIds;
+	reader.arena = arena;
+	reader.stringBase = part->firstString;
+
+	bool ok = fstat(fd, &info) == 0 && info.st_size == file->size && gpxFileModified(&info) == file->modified;
+	char* points = NULL;
+	char* data = NULL;
+	char* strings = NULL;
+	uint32_t endData = 0;
+
+	if (ok) {
+		points = readSnapshotBytes(fd, file->pointsStart + (uint64_t)part->firstPoint * sizeof(GPXSnapPoint), (uint64_t)part->numPoints * sizeof(GPXSnapPoint));
+		ok = points != NULL;
+	}
+	if (ok) {
+		//The data of the points was written point after point, so it is one run of records
+		const GPXSnapPoint* last = (const GPXSnapPoint*)points + part->numPoints - 1;
+		reader.points = (const GPXSnapPoint*)points;
+		reader.dataBase = reader.points[0].firstData;
+		endData = last->firstData + last->numData;
+		ok = endData >= reader.dataBase && endData <= file->numData && last->firstData <= endData;
+	}
+	if (ok) {
+		data = readSnapshotBytes(fd, file->dataStart + (uint64_t)reader.dataBase * sizeof(GPXSnapData), (uint64_t)(endData - reader.dataBase) * sizeof(GPXSnapData));
+		strings = readSnapshotBytes(fd, file->stringsStart + part->firstString, part->stringBytes);
+		reader.data = (const GPXSnapData*)data;
+		reader.strings = strings;
+		ok = data != NULL && strings != NULL && checkPart(&reader, part, endData);
+	}
+	close(fd);
+
+	if (ok) {
+		PointColumns* columns = part->columns != NULL ? initializeColumns(arena) : NULL;
+		loadPoints(&reader, list, columns, 0, part->numPoints);
+		if (part->columns != NULL) {
+			*part->columns = columns;
+		}
+	}
+
+	free(points);
+	free(data);
+	free(strings);
+}
+
+/** Function to give a route or track segment its points, copied now, or left in the snapshot file to be read
+ *  when first used
+ *@param Ptr- the reader
+ *@param Ptr- the waypoint list
+ *@param Ptr- the columns of the route or segment, NULL if the snapshot has none for it
+ *@param int- the first point record, and the number of them
+ *@param int- the strings the points use, and their number of bytes
+ **/
+static void placePoints(const GPXSnapReader* reader, List* list, PointColumns** columns, uint32_t first, uint32_t count, uint32_t firstString, uint32_t stringBytes) {
+	if (reader->file == NULL || count == 0) {
+		loadPoints(reader, list, columns != NULL ? *columns : NULL, first, count);
+		return;
+	}
+
+	GPXSnapPart* part = arenaAlloc(reader->arena, sizeof(GPXSnapPart));
+	part->file = reader->file;
+	part->firstPoint = first;
+	part->numPoints = count;
+	part->firstString = firstString;
+	part->stringBytes = stringBytes;
+	part->columns = columns;
+	//Like the points, the columns are only there once they are loaded
+	if (columns != NULL) {
+		*columns = NULL;
+	}
+	setListLoader(list, count, &loadSnapshotPart, part);
+}
+
+/** Function to copy totals out of their record
+ **/
+static void loadTotals(GPXTotals* totals, const GPXSnapTotals* record) {
+	if (totals == NULL) {
+		return;
+	}
+	totals->numPoints = record->numPoints;
+	totals->length = record->length;
+	totals->firstLat = record->firstLat;
+	totals->firstLon = record->firstLon;
+	totals->lastLat = record->lastLat;
+	totals->lastLon = record->lastLon;
+}
+
+/** Function to check every index and string offset in a snapshot before anything is built from it
+ **/
+static bool checkSnapshot(const GPXSnapReader* reader) {
+	const GPXSnapHeader* header = reader->header;
+	uint32_t strings = header->stringBytes;
+
+	//Every string ends inside the section
+	if (strings == 0 || reader->strings[strings - 1] != '\0') {
+		return false;
+	}
+	if (header->creator >= strings || header->namespaceName >= strings || header->numWaypoints > header->numPoints) {
+		return false;
+	}
+	for (uint32_t i = 0; i < header->numNames; i++) {
+		if (reader->names[i] >= strings) {
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < header->numData; i++) {
+		if (reader->data[i].name >= header->numNames || reader->data[i].value >= strings) {
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < header->numPoints; i++) {
+		if (reader->points[i].name >= strings || !inRange(reader->points[i].firstData, reader->points[i].numData, header->numData)) {
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < header->numRoutes; i++) {
+		const GPXSnapRoute* route = &reader->routes[i];
+		if (route->name >= strings || !inRange(route->firstData, route->numData, header->numData) || !inRange(route->firstPoint, route->numPoints, header->numPoints)
+			|| !inRange(route->firstString, route->stringBytes, strings)) {
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < header->numTracks; i++) {
+		const GPXSnapTrack* track = &reader->tracks[i];
+		if (track->name >= strings || !inRange(track->firstData, track->numData, header->numData) || !inRange(track->firstSegment, track->numSegments, header->numSegments)) {
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < header->numSegments; i++) {
+		const GPXSnapSegment* segment = &reader->segments[i];
+		if (!inRange(segment->firstPoint, segment->numPoints, header->numPoints) || !inRange(segment->firstString, segment->stringBytes, strings)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/** Function to note the snapshot file a document reads its points from later
+ *@return the file, out of the arena of the document
+ **/
+static GPXSnapFile* initializeSnapFile(const GPXSnapReader* reader, const char* fileName, const struct stat* info) {
+	const GPXSnapHeader* header = reader->header;
+	GPXSnapLayout layout = snapshotLayout(header);
+	GPXSnapFile* file = arenaAlloc(reader->arena, sizeof(GPXSnapFile));
+
+	file->fileName = arenaString(reader->arena, fileName, strlen(fileName));
+	file->size = info->st_size;
+	file->modified = gpxFileModified(info);
+	file->pointsStart = sizeof(GPXSnapHeader) + layout.points;
+	file->dataStart = sizeof(GPXSnapHeader) + layout.data;
+	file->stringsStart = sizeof(GPXSnapHeader) + layout.strings;
+	file->numData = header->numData;
+	file->numNames = header->numNames;
+	file->stringBytes = header->stringBytes;
+	file->nameIds = reader->nameIds;
+	return file;
+}
+
+/** Function to build a document out of a checked snapshot
+ *@param Ptr- the reader
+ *@param str- the name of the snapshot file to leave the route and segment points in, NULL to copy them now
+ *@param Ptr- the status of that file
+ **/
+static GPXdoc* loadDoc(GPXSnapReader* reader, const char* fileName, const struct stat* info) {
+	const GPXSnapHeader* header = reader->header;
+	GPXdoc* tmpDoc = initializeGPXdoc();
+	reader->arena = tmpDoc->arena;
+
+	//Kept with the document for the points that are read later
+	reader->nameIds = arenaAlloc(reader->arena, sizeof(int) * (header->numNames + 1));
+	for (uint32_t i = 0; i < header->numNames; i++) {
+		const char* name = reader->strings + reader->names[i];
+		reader->nameIds[i] = internGPXName(name, strlen(name));
+	}
+	if (fileName != NULL) {
+		reader->file = initializeSnapFile(reader, fileName, info);
+	}
+
+	const char* creator = reader->strings + header->creator;
+	tmpDoc->version = header->docVersion;
+	tmpDoc->creator = arenaString(tmpDoc->arena, creator, strlen(creator));
+	strncpy(tmpDoc->namespace, reader->strings + header->namespaceName, sizeof(tmpDoc->namespace) - 1);
+
+	loadPoints(reader, tmpDoc->waypoints, NULL, 0, header->numWaypoints);
+
+	for (uint32_t i = 0; i < header->numRoutes; i++) {
+		const GPXSnapRoute* record = &reader->routes[i];
+		Route* route = initializeRoute(tmpDoc->arena);
+		const char* name = reader->strings + record->name;
+
+		route->name = arenaString(tmpDoc->arena, name, strlen(name));
+		loadDataList(reader, route->otherData, record->firstData, record->numData);
+		placePoints(reader, route->waypoints, record->hasColumns ? &route->columns : NULL, record->firstPoint, record->numPoints, record->firstString, record->stringBytes);
+		loadTotals(route->totals, &record->totals);
+		insertBack(tmpDoc->routes, route);
+	}
+
+	for (uint32_t i = 0; i < header->numTracks; i++) {
+		const GPXSnapTrack* record = &reader->tracks[i];
+		Track* track = initializeTrack(tmpDoc->arena);
+		const char* name = reader->strings + record->name;
+
+		track->name = arenaString(tmpDoc->arena, name, strlen(name));
+		loadDataList(reader, track->otherData, record->firstData, record->numData);
+		for (uint32_t j = record->firstSegment; j < record->firstSegment + record->numSegments; j++) {
+			const GPXSnapSegment* segRecord = &reader->segments[j];
+			TrackSegment* segment = initializeTrackSegment(tmpDoc->arena);
+
+			placePoints(reader, segment->waypoints, segRecord->hasColumns ? &segment->columns : NULL, segRecord->firstPoint, segRecord->numPoints, segRecord->firstString, segRecord->stringBytes);
+			insertBack(track->segments, segment);
+		}
+		loadTotals(track->totals, &record->totals);
+		insertBack(tmpDoc->tracks, track);
+	}
+
+	tmpDoc->counts->numWaypoints = header->numWaypoints;
+	tmpDoc->counts->numRoutes = header->numRoutes;
+	tmpDoc->counts->numTracks = header->numTracks;
+	tmpDoc->counts->numSegments = header->numSegments;
+	markCountsCurrent(tmpDoc->counts);
+	arenaBuilt(tmpDoc->arena, 0);
+	return tmpDoc;
+}
+
+/** Function to map a snapshot, check it and build its document. The snapshot of a source file is kept beside it,
+ *  so a document built for one leaves its route and segment points there until they are used.
+ *@return the document, or NULL if the snapshot is missing, from another version or machine, damaged, or was made
+ *        from a source other than the one given
+ **/
+static GPXdoc* loadSnapshot(const char* fileName, const struct stat* source) {
+	struct stat info;
+
+	int fd = open(fileName, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+	if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size < (off_t)sizeof(GPXSnapHeader)) {
+		close(fd);
+		return NULL;
+	}
+	char* buffer = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (buffer == MAP_FAILED) {
+		return NULL;
+	}
+	madvise(buffer, info.st_size, MADV_SEQUENTIAL);
+
+	GPXSnapReader reader;
+	memset(&reader, 0, sizeof(GPXSnapReader));
+	const GPXSnapHeader* header = (const GPXSnapHeader*)buffer;
+	const char* payload = buffer + sizeof(GPXSnapHeader);
+	GPXSnapLayout layout = snapshotLayout(header);
+	GPXdoc* tmpDoc = NULL;
+
+	bool ok = memcmp(header->magic, SNAPSHOT_MAGIC, 4) == 0 && header->version == SNAPSHOT_VERSION
+		&& header->byteOrder == SNAPSHOT_BYTE_ORDER
+		&& header->payloadSize == (uint64_t)info.st_size - sizeof(GPXSnapHeader) && layout.end == header->payloadSize;
+	if (ok && source != NULL) {
+		ok = header->sourceSize == (uint64_t)source->st_size && header->sourceModified == gpxFileModified(source);
+	}
+	ok = ok && crc32_z(crc32_z(0L, Z_NULL, 0), (const Bytef*)payload, header->payloadSize) == header->checksum;
+
+	if (ok) {
+		reader.header = header;
+		reader.names = (const uint32_t*)(payload + layout.names);
+		reader.points = (const GPXSnapPoint*)(payload + layout.points);
+		reader.data = (const GPXSnapData*)(payload + layout.data);
+		reader.routes = (const GPXSnapRoute*)(payload + layout.routes);
+		reader.tracks = (const GPXSnapTrack*)(payload + layout.tracks);
+		reader.segments = (const GPXSnapSegment*)(payload + layout.segments);
+		reader.strings = payload + layout.strings;
+		if (checkSnapshot(&reader)) {
+			tmpDoc = loadDoc(&reader, source != NULL ? fileName : NULL, &info);
+		}
+	}
+
+	munmap(buffer, info.st_size);
+	return tmpDoc;
+}
+
+/* =========================================================   Public API   =========================================================== */
+
+/** Function to write a GPXdoc to a .gpxb snapshot file
+ *@return true if the snapshot was written
+ *@param Ptr- the document
+ *@param str- the name of the snapshot file
+ **/
+bool writeGPXSnapshot(GPXdoc* doc, char* fileName) {
+	if (doc == NULL || fileName == NULL) {
+		return false;
+	}
+	return writeSnapshot(doc, fileName, 0, 0);
+}
+
+/** Function to load a GPXdoc from a .gpxb snapshot file
+ *@return the new document, or NULL if the snapshot cannot be used
+ *@param str- the name of the snapshot file
+ **/
+GPXdoc* readGPXSnapshot(char* fileName) {
+	if (fileName == NULL) {
+		return NULL;
+	}
+	resetParseCount();
+	return loadSnapshot(fileName, NULL);
+}
+
+/** Function to parse a GPX file and write its snapshot beside it
+ *@return true if the snapshot was written
+ *@param str- the name of the GPX file
+ **/
+bool snapshotGPXFile(char* fileName) {
+	struct stat source;
+
+	char* name = fileName == NULL ? NULL : snapshotName(fileName);
+	if (name == NULL) {
+		return false;
+	}
+
+	//The stamp is taken first, a file changed while it is read gets a snapshot that never matches it
+	bool ok = false;
+	if (stat(fileName, &source) == 0) {
+		GPXdoc* doc = createFastGPXdoc(fileName);
+		if (doc != NULL) {
+			ok = writeSnapshot(doc, name, source.st_size, gpxFileModified(&source));
+			deleteGPXdoc(doc);
+		}
+	}
+
+	free(name);
+	return ok;
+}
+
+/** Function to create a GPXdoc from the snapshot beside a GPX file when it was made from the file as it is now,
+ *  and by parsing the file like createFastGPXdoc otherwise
+ *@return the new document, or NULL
+ *@param str- the name of the GPX file
+ **/
+GPXdoc* createSnapshotGPXdoc(char* fileName) {
+	struct stat source;
+
+	char* name = fileName == NULL ? NULL : snapshotName(fileName);
+	if (name == NULL) {
+		return NULL;
+	}
+
+	GPXdoc* tmpDoc = NULL;
+	if (stat(fileName, &source) == 0) {
+		resetParseCount();
+		tmpDoc = loadSnapshot(name, &source);
+	}
+	free(name);
+
+	if (tmpDoc != NULL) {
+		return tmpDoc;
+	}
+	return createFastGPXdoc(fileName);
+}
+
+/** Function to remove the snapshot kept beside a file, for when the file is written again
+ *@param str- the name of the GPX file
+ **/
+void dropGPXSnapshot(const char* fileName) {
+	char* name = fileName == NULL ? NULL : snapshotName(fileName);
+	if (name == NULL) {
+		return;
+	}
+	remove(name);
+	free(name);
+}
@@ -0,0 +1,197 @@
+/**
+ * Created by: Alexander Blankenstein
+ **/
+
+#define _DEFAULT_SOURCE
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include "GPXParser.h"
+#include "GPXHelper.h"
+
+/* The GPXtoJSON summary of a file is kept beside it in <file>.summary, as text:
+ *   GPXSUMMARY <version> <size> <modified> <crc> <length>
+ *   <the summary JSON, length bytes, which may hold newlines of its own>
+ * size, modified and crc are the size, modification time in nanoseconds and CRC-32 of the file the summary
+ * was made from. A summary is used when the size and time still match. When only the time changed, the
+ * file is read once more and the summary is used if the CRC still matches, so copying or touching a file
+ * does not cost a parse. */
+
+#define SUMMARY_VERSION 1
+#define SUMMARY_EXTENSION ".summary"
+
+//Summaries are a few hundred bytes, anything much bigger is not one
+#define MAX_SUMMARY_SIZE (64 * 1024)
+
+//Bytes read at a time for the CRC
+#define HASH_CHUNK (1024 * 1024)
+
+//The file a summary belongs to
+typedef struct {
+	long long size;
+	long long modified;
+	unsigned long crc;
+} GPXSummaryKey;
+
+/** Function that returns the name of the summary kept beside a file
+ *@return the name, to be freed by the caller
+ **/
+static char* summaryName(const char* fileName) {
+	char* name = malloc(sizeof(char) * (strlen(fileName) + strlen(SUMMARY_EXTENSION) + 1));
+	strcpy(name, fileName);
+	strcat(name, SUMMARY_EXTENSION);
+	return name;
+}
+
+/** Function to work out the CRC-32 of a whole file
+ *@return true if all of it was read
+ **/
+static bool hashFile(const char* fileName, unsigned long* crc) {
+	int fd = open(fileName, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	char* buffer = malloc(sizeof(char) * HASH_CHUNK);
+	ssize_t got;
+	*crc = crc32_z(0L, Z_NULL, 0);
+	while ((got = read(fd, buffer, HASH_CHUNK)) > 0) {
+		*crc = crc32_z(*crc, (const Bytef*)buffer, got);
+	}
+	free(buffer);
+	close(fd);
+	return got == 0;
+}
+
+/** Function to read a summary file
+ *@return the summary JSON, or NULL if there is no readable summary
+ **/
+static char* readSummary(const char* name, GPXSummaryKey* key) {
+	FILE* file = fopen(name, "rb");
+	if (file == NULL) {
+		return NULL;
+	}
+
+	char* text = malloc(sizeof(char) * (MAX_SUMMARY_SIZE + 1));
+	size_t len = fread(text, 1, MAX_SUMMARY_SIZE + 1, file);
+	fclose(file);
+	if (len > MAX_SUMMARY_SIZE) {
+		free(text);
+		return NULL;
+	}
+	text[len] = '\0';
+
+	int version = 0;
+	int used = 0;
+	size_t jsonLen = 0;
+	if (sscanf(text, "GPXSUMMARY %d %lld %lld %lx %zu%n", &version, &key->size, &key->modified, &key->crc, &jsonLen, &used) != 5
+		|| version != SUMMARY_VERSION || text[used] != '\n' || used + 1 + jsonLen != len || strlen(text + used + 1) != jsonLen) {
+		free(text);
+		return NULL;
+	}
+
+	memmove(text, text + used + 1, jsonLen + 1);
+	return text;
+}
+
+/** Function to write a summary file, through a temporary file renamed over it so a reader never sees half of one
+ **/
+static void writeSummary(const char* name, const GPXSummaryKey* key, const char* json) {
+	char* tmpName = malloc(sizeof(char) * (strlen(name) + 8));
+	sprintf(tmpName, "%s.XXXXXX", name);
+
+	int fd = mkstemp(tmpName);
+	if (fd < 0) {
+		free(tmpName);
+		return;
+	}
+	FILE* file = fdopen(fd, "wb");
+	if (file == NULL) {
+		close(fd);
+		remove(tmpName);
+		free(tmpName);
+		return;
+	}
+
+	fchmod(fd, 0644);
+	bool ok = fprintf(file, "GPXSUMMARY %d %lld %lld %lx %zu\n%s", SUMMARY_VERSION, key->size, key->modified, key->crc, strlen(json), json) > 0;
+	ok = fclose(file) == 0 && ok;
+	if (!ok || rename(tmpName, name) != 0) {
+		remove(tmpName);
+	}
+	free(tmpName);
+}
+
+/** Function that returns the GPXtoJSON summary of a GPX file, from the summary kept beside it when that was
+ *  made from the file as it is now. Otherwise the file is read like createLazyGPXdoc and a new summary is
+ *  written beside it.
+ *@return the summary JSON, or NULL if the file cannot be read
+ *@param str- the name of the GPX file
+ **/
+char* readGPXSummary(char* fileName) {
+	struct stat before;
+	struct stat after;
+	GPXSummaryKey key;
+	GPXSummaryKey saved;
+
+	if (fileName == NULL || stat(fileName, &before) != 0 || !S_ISREG(before.st_mode)) {
+		return NULL;
+	}
+	key.size = before.st_size;
+	key.modified = gpxFileModified(&before);
+
+	char* name = summaryName(fileName);
+	char* json = readSummary(name, &saved);
+	bool haveCrc = false;
+
+	if (json != NULL && saved.size == key.size) {
+		if (saved.modified == key.modified) {
+			free(name);
+			return json;
+		}
+		haveCrc = hashFile(fileName, &key.crc);
+		if (haveCrc && saved.crc == key.crc) {
+			writeSummary(name, &key, json);
+			free(name);
+			return json;
+		}
+	}
+	free(json);
+	json = NULL;
+
+	//The CRC is taken before the parse, and the summary is only kept if the file did not change meanwhile
+	if (!haveCrc) {
+		haveCrc = hashFile(fileName, &key.crc);
+	}
+	GPXdoc* doc = createLazyGPXdoc(fileName);
+	if (doc != NULL) {
+		json = GPXtoJSON(doc);
+		deleteGPXdoc(doc);
+		if (haveCrc && stat(fileName, &after) == 0 && after.st_size == before.st_size && gpxFileModified(&after) == key.modified) {
+			writeSummary(name, &key, json);
+		}
+	}
+
+	free(name);
+	return json;
+}
+
+/** Function to remove the summary kept beside a file, for when the file is written again
+ *@param str- the name of the GPX file
+ **/
+void dropGPXSummary(const char* fileName) {
+	if (fileName == NULL) {
+		return;
+	}
+	char* name = summaryName(fileName);
+	remove(name);
+	free(name);
+}
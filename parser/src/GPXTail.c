@@ -0,0 +1,166 @@
+/**
+ * Created by: Alexander Blankenstein
+ **/
+
+#define _DEFAULT_SOURCE
+
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include "GPXParser.h"
+#include "GPXBuilder.h"
+#include "GPXScanner.h"
+#include "GPXHelper.h"
+#include "GPXColumns.h"
+#include "GPXArena.h"
+
+//Unread bytes a handle will hold on to waiting for a token to finish before it gives up on the file
+#define MAX_PENDING (4 * 1024 * 1024)
+
+//A GPX file that is still being written, read a little more every time followGPXTail is called. The scanner
+//and builder keep their state between calls, so the document grows as if the file had been read in one go.
+struct GPXTail {
+    char* fileName;
+    GPXdoc* doc;
+    GPXBuilder builder;
+    GPXScanner scanner;
+
+    //Bytes of the file read so far
+    long offset;
+
+    //The end of what was read that the scanner could not use yet, a token or text that is not finished
+    char* pending;
+    long pendingLen;
+    long pendingSize;
+
+    bool atStart;
+    bool failed;
+};
+
+/** Function to start following a GPX file that is still being written, reading what is already there
+ *@pre File name cannot be an empty string or NULL
+ *@return the new handle, or NULL if the file cannot be opened or is not a plain UTF-8 GPX file
+ *@param str- the name of the GPX file
+ **/
+GPXTail* createGPXTail(char* fileName) {
+	if (fileName == NULL) {
+		return NULL;
+	}
+	if (gpxFileKind(fileName) != GPX_FILE_PLAIN) {
+		return NULL;
+	}
+
+	GPXTail* tail = malloc(sizeof(GPXTail));
+	memset(tail, 0, sizeof(GPXTail));
+	tail->fileName = malloc(sizeof(char) * (strlen(fileName) + 1));
+	strcpy(tail->fileName, fileName);
+	tail->doc = initializeGPXdoc();
+	initializeBuilder(&tail->builder, tail->doc);
+	initializeScanner(&tail->scanner, &tail->builder);
+	tail->atStart = true;
+
+	if (followGPXTail(tail) < 0) {
+		deleteGPXTail(tail);
+		return NULL;
+	}
+	return tail;
+}
+
+/** Function to read whatever was appended to the file since the last call into the handle's document.
+ *  Elements left open at the end of the file stay open, a point is added once its closing tag is there.
+ *@return the number of waypoints, route points and track points added, or -1 if the file is gone, got shorter,
+ *        or holds something that cannot be read this way. A handle that failed stays failed.
+ *@param Ptr- the handle
+ **/
+int followGPXTail(GPXTail* tail) {
+	if (tail == NULL || tail->failed) {
+		return -1;
+	}
+
+	FILE* file = fopen(tail->fileName, "rb");
+	struct stat info;
+	if (file == NULL || fstat(fileno(file), &info) != 0 || info.st_size < tail->offset) {
+		if (file != NULL) {
+			fclose(file);
+		}
+		tail->failed = true;
+		return -1;
+	}
+
+	long newBytes = info.st_size - tail->offset;
+	if (newBytes == 0) {
+		fclose(file);
+		return 0;
+	}
+
+	if (tail->pendingLen + newBytes > tail->pendingSize) {
+		tail->pendingSize = (tail->pendingLen + newBytes) * 2;
+		tail->pending = realloc(tail->pending, sizeof(char) * tail->pendingSize);
+	}
+	fseek(file, tail->offset, SEEK_SET);
+	size_t got = fread(tail->pending + tail->pendingLen, 1, newBytes, file);
+	fclose(file);
+	tail->offset = tail->offset + got;
+	tail->pendingLen = tail->pendingLen + got;
+
+	long numPoints = tail->builder.numPoints;
+	unsigned int startChanges = arenaChanges(tail->doc->arena);
+	long used = scanGPXPrefix(&tail->scanner, tail->pending, tail->pendingLen, tail->atStart);
+	if (used < 0) {
+		tail->failed = true;
+		return -1;
+	}
+
+	//Names of the open elements point into pending, which is about to move
+	if (used > 0) {
+		holdScannerNames(&tail->scanner);
+		memmove(tail->pending, tail->pending + used, tail->pendingLen - used);
+		tail->pendingLen = tail->pendingLen - used;
+		tail->atStart = false;
+	}
+
+	//Markup the scanner does not handle failed above, a token that is still this long is never going to end
+	if (tail->pendingLen > MAX_PENDING) {
+		tail->failed = true;
+		return -1;
+	}
+	//The builder carried the counts on with every element it added
+	markCountsCurrent(tail->doc->counts);
+	arenaBuilt(tail->doc->arena, startChanges);
+	return tail->builder.numPoints - numPoints;
+}
+
+/** Function that returns the document a handle fills. It stays owned by the handle, and is only changed
+ *  by followGPXTail.
+ *@return the document
+ *@param Ptr- the handle
+ **/
+GPXdoc* getGPXTailDoc(const GPXTail* tail) {
+	return tail == NULL ? NULL : tail->doc;
+}
+
+/** Function to check if the whole file has been read, up to the closing tag of the root element
+ *@return true if the root element was closed
+ *@param Ptr- the handle
+ **/
+bool isGPXTailFinished(const GPXTail* tail) {
+	return tail != NULL && tail->scanner.seenRoot && tail->scanner.numOpen == 0;
+}
+
+/** Function to free a handle along with its document
+ *@param Ptr- the handle, can be NULL
+ **/
+void deleteGPXTail(GPXTail* tail) {
+	if (tail == NULL) {
+		return;
+	}
+	clearScanner(&tail->scanner);
+	clearBuilder(&tail->builder);
+	deleteGPXdoc(tail->doc);
+	free(tail->pending);
+	free(tail->fileName);
+	free(tail);
+}
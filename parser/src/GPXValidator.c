@@ -0,0 +1,418 @@
+/**
+ * Created by: Alexander Blankenstein
+ **/
+
+#define _DEFAULT_SOURCE
+
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <libxml/parser.h>
+#include <libxml/xmlschemas.h>
+#include <libxml/xmlreader.h>
+
+#include "GPXParser.h"
+#include "GPXHelper.h"
+#include "GPXPool.h"
+#include "GPXBuilder.h"
+
+//The contexts one thread validates with. libxml contexts cannot be shared, the compiled schema can.
+typedef struct GPXValidatorSlot {
+    xmlParserCtxtPtr parser;
+    xmlSchemaValidCtxtPtr valid;
+    struct GPXValidator* validator;
+    struct GPXValidatorSlot* next;
+} GPXValidatorSlot;
+
+//A schema compiled once. It is only read after it is made, so any number of threads can use it at once.
+struct GPXValidator {
+    xmlSchemaPtr schema;
+
+    //Each thread finds its own slot under the key, the list holds those of the threads still running so they can
+    //be freed. A thread that ends frees its own.
+    pthread_key_t key;
+    pthread_mutex_t lock;
+    GPXValidatorSlot* slots;
+};
+
+//The files of one batch, filled in by the workers
+typedef struct {
+    GPXValidator* validator;
+    char** paths;
+    GPXValidation* results;
+} GPXValidationBatch;
+
+//Validators made by sharedGPXValidator, one for every version of every schema file that was asked for
+typedef struct GPXSharedSchema {
+    char* fileName;
+    long long size;
+    long long modified;
+    GPXValidator* validator;
+    struct GPXSharedSchema* next;
+} GPXSharedSchema;
+
+static pthread_mutex_t sharedLock = PTHREAD_MUTEX_INITIALIZER;
+static GPXSharedSchema* sharedSchemas = NULL;
+
+/** Function that drops schema errors, a schema that does not compile just gives no validator
+ **/
+static void ignoreError(void* userData, xmlErrorPtr error) {
+	(void)userData;
+	(void)error;
+}
+
+/** Function that drops the messages libxml prints outside of the structured handlers
+ **/
+static void ignoreMessage(void* ctx, const char* msg, ...) {
+	(void)ctx;
+	(void)msg;
+}
+
+/** Function that keeps the first error libxml reports while validating a file
+ **/
+static void recordError(void* userData, xmlErrorPtr error) {
+	GPXValidation* result = (GPXValidation*)userData;
+
+	if (result == NULL || result->message[0] != '\0' || error == NULL || error->message == NULL) {
+		return;
+	}
+	if (error->line > 0) {
+		snprintf(result->message, sizeof(result->message), "line %d: %s", error->line, error->message);
+	}
+	else {
+		snprintf(result->message, sizeof(result->message), "%s", error->message);
+	}
+
+	//libxml messages end in a newline and some have more inside, the message is kept on one line
+	int len = strlen(result->message);
+	if (len > 0 && result->message[len - 1] == '\n') {
+		result->message[len - 1] = '\0';
+	}
+	for (char* c = result->message; *c != '\0'; c++) {
+		if (*c == '\n') {
+			*c = ' ';
+		}
+	}
+}
+
+/** Function to free the contexts of one thread
+ **/
+static void freeSlot(GPXValidatorSlot* slot) {
+	xmlFreeParserCtxt(slot->parser);
+	xmlSchemaFreeValidCtxt(slot->valid);
+	free(slot);
+}
+
+/** Function that frees the contexts of a thread as it ends, so the pool threads of every validateGPXFiles call
+ *  do not leave theirs behind in a validator that lives as long as the process
+ **/
+static void endThreadSlot(void* data) {
+	GPXValidatorSlot* slot = (GPXValidatorSlot*)data;
+	GPXValidator* validator = slot->validator;
+
+	pthread_mutex_lock(&validator->lock);
+	GPXValidatorSlot** at = &validator->slots;
+	while (*at != NULL && *at != slot) {
+		at = &(*at)->next;
+	}
+	if (*at != NULL) {
+		*at = slot->next;
+	}
+	pthread_mutex_unlock(&validator->lock);
+
+	freeSlot(slot);
+}
+
+/** Function that returns the contexts of the calling thread, making them the first time
+ *@return the slot, or NULL if libxml could not make the contexts
+ **/
+static GPXValidatorSlot* threadSlot(GPXValidator* validator) {
+	GPXValidatorSlot* slot = pthread_getspecific(validator->key);
+	if (slot != NULL) {
+		return slot;
+	}
+
+	slot = malloc(sizeof(GPXValidatorSlot));
+	slot->parser = xmlNewParserCtxt();
+	slot->valid = xmlSchemaNewValidCtxt(validator->schema);
+	if (slot->parser == NULL || slot->valid == NULL) {
+		freeSlot(slot);
+		return NULL;
+	}
+
+	slot->validator = validator;
+	pthread_mutex_lock(&validator->lock);
+	slot->next = validator->slots;
+	validator->slots = slot;
+	pthread_mutex_unlock(&validator->lock);
+
+	pthread_setspecific(validator->key, slot);
+	return slot;
+}
+
+/** Function to validate a parsed tree with the calling thread's context
+ *@return the result, GPX_VALID, GPX_NOT_VALID or GPX_VALIDATION_ERROR
+ **/
+static int validateTree(GPXValidatorSlot* slot, xmlDocPtr doc, GPXValidation* result) {
+	//Entity references make the schema validator print an "Unimplemented block" notice on the generic
+	//handler, which belongs to the calling thread and is put back afterwards
+	xmlGenericErrorFunc oldHandler = xmlGenericError;
+	void* oldContext = xmlGenericErrorContext;
+	xmlSetGenericErrorFunc(NULL, ignoreMessage);
+
+	xmlSchemaSetValidStructuredErrors(slot->valid, recordError, result);
+	int ret = xmlSchemaValidateDoc(slot->valid, doc);
+	xmlSchemaSetValidStructuredErrors(slot->valid, recordError, NULL);
+
+	xmlSetGenericErrorFunc(oldContext, oldHandler);
+
+	if (ret == 0) {
+		return GPX_VALID;
+	}
+	return ret > 0 ? GPX_NOT_VALID : GPX_VALIDATION_ERROR;
+}
+
+/** Function to compile a GPX schema for validating files against it
+ *@pre schema file name is not NULL/empty
+ *@return the new validator, or NULL if the schema could not be read or does not compile. Nothing is printed.
+ *@param str- the name of the schema file
+ **/
+GPXValidator* createGPXValidator(char* gpxSchemaFile) {
+	if (gpxSchemaFile == NULL) {
+		return NULL;
+	}
+
+	//libxml sets up its globals on first use, which is not safe to race
+	initGPXParser();
+
+	xmlSchemaParserCtxtPtr ctxt = xmlSchemaNewParserCtxt(gpxSchemaFile);
+	if (ctxt == NULL) {
+		return NULL;
+	}
+	xmlSchemaSetParserStructuredErrors(ctxt, ignoreError, NULL);
+	xmlSchemaPtr schema = xmlSchemaParse(ctxt);
+	xmlSchemaFreeParserCtxt(ctxt);
+	if (schema == NULL) {
+		return NULL;
+	}
+
+	GPXValidator* validator = malloc(sizeof(GPXValidator));
+	if (pthread_key_create(&validator->key, &endThreadSlot) != 0) {
+		xmlSchemaFree(schema);
+		free(validator);
+		return NULL;
+	}
+	validator->schema = schema;
+	validator->slots = NULL;
+	pthread_mutex_init(&validator->lock, NULL);
+	return validator;
+}
+
+/** Function to validate an already parsed XML tree against a validator's schema
+ *@return GPX_VALID, GPX_NOT_VALID or GPX_VALIDATION_ERROR
+ *@param Ptr- the validator
+ *@param Ptr- the parsed XML document
+ *@param Ptr- set to the result, with the first problem found
+ **/
+int validateXMLWith(GPXValidator* validator, xmlDocPtr doc, GPXValidation* result) {
+	memset(result, 0, sizeof(GPXValidation));
+
+	GPXValidatorSlot* slot = threadSlot(validator);
+	if (slot == NULL) {
+		result->result = GPX_VALIDATION_ERROR;
+		return result->result;
+	}
+	result->result = validateTree(slot, doc, result);
+	return result->result;
+}
+
+/** Function to build a GPX document from a streaming reader that checks every node against a validator's
+ *  schema as it reads it, so the file is validated in the same pass that builds it. The build stops at the
+ *  first node that breaks the schema. Errors go into result instead of being printed.
+ *@pre the reader has not read anything yet
+ *@return the new document, or NULL if the file could not be read or is not valid
+ *@param Ptr- the validator
+ *@param Ptr- the reader
+ *@param Ptr- set to the result, with the first problem found
+ **/
+GPXdoc* readValidGPXdoc(GPXValidator* validator, xmlTextReaderPtr reader, GPXValidation* result) {
+	memset(result, 0, sizeof(GPXValidation));
+	xmlTextReaderSetStructuredErrorHandler(reader, recordError, result);
+
+	if (xmlTextReaderSetSchema(reader, validator->schema) != 0) {
+		result->result = GPX_VALIDATION_ERROR;
+		return NULL;
+	}
+
+	xmlGenericErrorFunc oldHandler = xmlGenericError;
+	void* oldContext = xmlGenericErrorContext;
+	xmlSetGenericErrorFunc(NULL, ignoreMessage);
+
+	GPXdoc* tmpDoc = readerToGPXdoc(reader, true, true);
+
+	xmlSetGenericErrorFunc(oldContext, oldHandler);
+
+	if (tmpDoc != NULL) {
+		result->result = GPX_VALID;
+	}
+	else {
+		result->result = xmlTextReaderIsValid(reader) == 0 ? GPX_NOT_VALID : GPX_NOT_READ;
+	}
+	return tmpDoc;
+}
+
+/** Function to validate a GPX file against a validator's schema. Can be called from any number of threads
+ *  at once with the same validator.
+ *@pre validator was made by createGPXValidator, file name is not NULL
+ *@return the result: GPX_VALID, GPX_NOT_VALID, GPX_NOT_READ if the file could not be read or is not well
+ *        formed, or GPX_VALIDATION_ERROR, with the first problem libxml found in message
+ *@param Ptr- the validator
+ *@param str- the name of the GPX file
+ **/
+GPXValidation validateGPXFile(GPXValidator* validator, char* fileName) {
+	GPXValidation result;
+	memset(&result, 0, sizeof(GPXValidation));
+	result.result = GPX_NOT_READ;
+
+	if (validator == NULL || fileName == NULL) {
+		return result;
+	}
+	GPXValidatorSlot* slot = threadSlot(validator);
+	if (slot == NULL) {
+		result.result = GPX_VALIDATION_ERROR;
+		return result;
+	}
+
+	xmlDocPtr doc = readXMLFileWith(slot->parser, fileName, XML_PARSE_NOERROR | XML_PARSE_NOWARNING);
+	if (doc == NULL) {
+		recordError(&result, xmlCtxtGetLastError(slot->parser));
+		return result;
+	}
+
+	result.result = validateTree(slot, doc, &result);
+	xmlFreeDoc(doc);
+	return result;
+}
+
+/** Function to validate one file of a batch, run on a worker thread
+ **/
+static void validateBatchFile(void* arg, int index) {
+	GPXValidationBatch* batch = (GPXValidationBatch*)arg;
+	batch->results[index] = validateGPXFile(batch->validator, batch->paths[index]);
+}
+
+/** Function to validate a list of GPX files against a validator's schema on a pool of worker threads
+ *@pre validator was made by createGPXValidator, fileNames holds numFiles strings
+ *@return the results in the order the files were given, to be freed by the caller, or NULL without a validator
+ *@param Ptr- the validator
+ *@param Ptr- the names of the files
+ *@param int- the number of files
+ *@param int- the number of threads, 0 or less for one per processor
+ **/
+GPXValidation* validateGPXFiles(GPXValidator* validator, char** fileNames, int numFiles, int numThreads) {
+	if (validator == NULL || fileNames == NULL || numFiles < 0) {
+		return NULL;
+	}
+
+	GPXValidationBatch batch;
+	batch.validator = validator;
+	batch.paths = fileNames;
+	batch.results = calloc(numFiles > 0 ? numFiles : 1, sizeof(GPXValidation));
+
+	if (numThreads <= 0) {
+		numThreads = defaultThreadCount();
+	}
+	GPXThreadPool* pool = NULL;
+	if (numFiles > 1) {
+		pool = createThreadPool(numThreads < numFiles ? numThreads : numFiles);
+	}
+	if (pool != NULL) {
+		runThreadPool(pool, numFiles, validateBatchFile, &batch);
+		freeThreadPool(pool);
+	}
+	else {
+		for (int i = 0; i < numFiles; i++) {
+			validateBatchFile(&batch, i);
+		}
+	}
+	return batch.results;
+}
+
+/** Function to free a validator along with the contexts every thread made for it. No thread may be using it.
+ *@param Ptr- the validator, can be NULL
+ **/
+void deleteGPXValidator(GPXValidator* validator) {
+	if (validator == NULL) {
+		return;
+	}
+
+	//Deleting the key first keeps threads that end later from freeing their slots again
+	pthread_key_delete(validator->key);
+	GPXValidatorSlot* slot = validator->slots;
+	while (slot != NULL) {
+		GPXValidatorSlot* next = slot->next;
+		freeSlot(slot);
+		slot = next;
+	}
+
+	pthread_mutex_destroy(&validator->lock);
+	xmlSchemaFree(validator->schema);
+	free(validator);
+}
+
+/** Function that returns a validator for a schema file that is compiled once and kept for the life of the
+ *  process, or until cleanupGPXParser. The schema is compiled again only if the file changes, the old validator
+ *  is kept as other threads may still be using it.
+ *@return the validator, or NULL if the schema could not be read or does not compile
+ *@param str- the name of the schema file
+ **/
+GPXValidator* sharedGPXValidator(char* gpxSchemaFile) {
+	struct stat info;
+
+	if (gpxSchemaFile == NULL || stat(gpxSchemaFile, &info) != 0) {
+		return NULL;
+	}
+
+	pthread_mutex_lock(&sharedLock);
+	GPXSharedSchema* shared = sharedSchemas;
+	while (shared != NULL) {
+		if (strcmp(shared->fileName, gpxSchemaFile) == 0 && shared->size == info.st_size && shared->modified == gpxFileModified(&info)) {
+			break;
+		}
+		shared = shared->next;
+	}
+
+	if (shared == NULL) {
+		GPXValidator* validator = createGPXValidator(gpxSchemaFile);
+		if (validator != NULL) {
+			shared = malloc(sizeof(GPXSharedSchema));
+			shared->fileName = malloc(sizeof(char) * (strlen(gpxSchemaFile) + 1));
+			strcpy(shared->fileName, gpxSchemaFile);
+			shared->size = info.st_size;
+			shared->modified = gpxFileModified(&info);
+			shared->validator = validator;
+			shared->next = sharedSchemas;
+			sharedSchemas = shared;
+		}
+	}
+	pthread_mutex_unlock(&sharedLock);
+
+	return shared == NULL ? NULL : shared->validator;
+}
+
+/** Function to free every validator made by sharedGPXValidator, for cleanupGPXParser
+ **/
+void freeSharedGPXValidators(void) {
+	pthread_mutex_lock(&sharedLock);
+	while (sharedSchemas != NULL) {
+		GPXSharedSchema* next = sharedSchemas->next;
+		deleteGPXValidator(sharedSchemas->validator);
+		free(sharedSchemas->fileName);
+		free(sharedSchemas);
+		sharedSchemas = next;
+	}
+	pthread_mutex_unlock(&sharedLock);
+}
@@ -4,6 +4,7 @@
 
 #include "LinkedListAPI.h"
 #include "assert.h"
+#include <pthread.h>
 
 /** Function to initialize the list metadata head to the appropriate function pointers. Allocates memory to the struct.
 *@return pointer to the list head
@@ -27,10 +28,173 @@ List * initializeList(char* (*printFunction)(void* toBePrinted),void (*deleteFun
 	tmpList->deleteData = deleteFunction;
 	tmpList->compare = compareFunction;
 	tmpList->printData = printFunction;
+
+	tmpList->allocate = NULL;
+	tmpList->pool = NULL;
+
+	tmpList->load = NULL;
+	tmpList->source = NULL;
+
+	tmpList->numChanges = 0;
+	tmpList->watch = NULL;
+	tmpList->watchContext = NULL;
 	
 	return tmpList;
 }
 
+/** Function to initialize a list whose head and nodes come out of a pool. Pool memory is never freed by the list.
+*@return pointer to the list head
+*@param printFunction function pointer to print a single node of the list
+*@param deleteFunction function pointer to delete a single piece of data from the list
+*@param compareFunction function pointer to compare two nodes of the list in order to test for equality or order
+*@param allocate function returning size bytes out of the pool
+*@param pool the pool passed to allocate
+**/
+List * initializeListInPool(char* (*printFunction)(void* toBePrinted),void (*deleteFunction)(void* toBeDeleted),int (*compareFunction)(const void* first,const void* second),void* (*allocate)(void* pool, size_t size),void* pool){
+	assert(printFunction != NULL);
+	assert(deleteFunction != NULL);
+	assert(compareFunction != NULL);
+	assert(allocate != NULL);
+
+	List * tmpList = allocate(pool, sizeof(List));
+
+	tmpList->head = NULL;
+	tmpList->tail = NULL;
+
+	tmpList->length = 0;
+
+	tmpList->deleteData = deleteFunction;
+	tmpList->compare = compareFunction;
+	tmpList->printData = printFunction;
+
+	tmpList->allocate = allocate;
+	tmpList->pool = pool;
+
+	tmpList->load = NULL;
+	tmpList->source = NULL;
+
+	tmpList->numChanges = 0;
+	tmpList->watch = NULL;
+	tmpList->watchContext = NULL;
+
+	return tmpList;
+}
+
+//Lists are loaded one at a time, the loaders of lazy documents share the document's arena. A loader can need the
+//nodes of another list, the thread that holds the lock only takes it once.
+static pthread_mutex_t loadLock = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local int loadDepth = 0;
+
+/** Counts a change to the nodes of a list, see numChanges. Whatever watches the list is told, unless the change
+ * is made by a loader, which only puts in place what the list was said to hold.
+**/
+static void listChanged(List* list){
+	list->numChanges++;
+	if (list->watch != NULL && loadDepth == 0){
+		list->watch(list->watchContext);
+	}
+}
+
+/** Runs the loader of a list whose nodes have not been added yet, so it runs only once even if many threads read
+ * the list. The nodes are added to a copy of the list head first, and only put in place once they are all there,
+ * then the loader is dropped. A thread that sees no loader also sees every node.
+**/
+static void loadList(List* list){
+	if (list == NULL || __atomic_load_n(&list->load, __ATOMIC_ACQUIRE) == NULL){
+		return;
+	}
+
+	if (loadDepth == 0){
+		pthread_mutex_lock(&loadLock);
+	}
+	loadDepth++;
+
+	//Another thread may have loaded it while this one waited
+	bool changed = false;
+	void (*load)(List* list, void* source) = list->load;
+	if (load != NULL){
+		List loaded = *list;
+		loaded.head = NULL;
+		loaded.tail = NULL;
+		loaded.length = 0;
+		loaded.load = NULL;
+		loaded.source = NULL;
+		load(&loaded, list->source);
+
+		list->head = loaded.head;
+		list->tail = loaded.tail;
+		//Readers can be asking for the length the whole time, it only changes if the loader added a different number
+		changed = list->length != loaded.length;
+		if (changed){
+			list->length = loaded.length;
+			list->numChanges++;
+		}
+		list->source = NULL;
+		__atomic_store_n(&list->load, NULL, __ATOMIC_RELEASE);
+	}
+
+	loadDepth--;
+	if (loadDepth == 0){
+		pthread_mutex_unlock(&loadLock);
+	}
+	if (changed && list->watch != NULL && loadDepth == 0){
+		list->watch(list->watchContext);
+	}
+}
+
+/** Has a function called after every change to the nodes of a list
+*@param list pointer to the list
+*@param watch function to call, NULL to stop
+*@param context passed to watch
+**/
+void watchList(List* list, void (*watch)(void* context), void* context){
+	if (list == NULL){
+		return;
+	}
+
+	list->watch = watch;
+	list->watchContext = context;
+}
+
+/** Tells whether the nodes of a list are in place, without loading them
+*@return true if the list has no loader waiting to run
+*@param list pointer to the list
+**/
+bool isListLoaded(const List* list){
+	return list == NULL || __atomic_load_n(&list->load, __ATOMIC_ACQUIRE) == NULL;
+}
+
+/** Gives an empty list a length now and its nodes the first time they are needed
+*@param list pointer to the list
+*@param length the number of nodes load is expected to add
+*@param load function adding the nodes
+*@param source passed to load
+**/
+void setListLoader(List* list, int length, void (*load)(List* list, void* source), void* source){
+	if (list == NULL || load == NULL || list->head != NULL){
+		return;
+	}
+
+	list->length = length;
+	list->load = load;
+	list->source = source;
+}
+
+/** Creates a node for the given list, out of its pool if it has one
+**/
+static Node* listNode(List* list, void* data){
+	if (list->allocate == NULL){
+		return initializeNode(data);
+	}
+
+	Node* tmpNode = list->allocate(list->pool, sizeof(Node));
+	tmpNode->data = data;
+	tmpNode->previous = NULL;
+	tmpNode->next = NULL;
+
+	return tmpNode;
+}
+
 
 /** Deletes the entire linked list, freeing all memory.
 * uses the supplied function pointer to release allocated memory for the data
@@ -41,7 +205,9 @@ List * initializeList(char* (*printFunction)(void* toBePrinted),void (*deleteFun
 void freeList(List* list){	
 
     clearList(list);
-	free(list);
+	if (list != NULL && list->allocate == NULL){
+		free(list);
+	}
 }
 
 /** Clears the list: frees the contents of the list - Node structs and data stored in them - 
@@ -56,10 +222,19 @@ void clearList(List* list){
     if (list == NULL){
 		return;
 	}
+
+	//Nodes that were never loaded have nothing to free
+	if (list->load != NULL){
+		list->load = NULL;
+		list->source = NULL;
+		list->length = 0;
+		listChanged(list);
+	}
 	
 	if (list->head == NULL && list->tail == NULL){
 		return;
 	}
+	listChanged(list);
 	
 	Node* tmp;
 	
@@ -67,7 +242,9 @@ void clearList(List* list){
 		list->deleteData(list->head->data);
 		tmp = list->head;
 		list->head = list->head->next;
-		free(tmp);
+		if (list->allocate == NULL){
+			free(tmp);
+		}
 	}
 	
 	list->head = NULL;
@@ -108,10 +285,12 @@ void insertBack(List* list, void* toBeAdded){
 	if (list == NULL || toBeAdded == NULL){
 		return;
 	}
+	loadList(list);
 	
 	(list->length)++;
+	listChanged(list);
 
-	Node* newNode = initializeNode(toBeAdded);
+	Node* newNode = listNode(list, toBeAdded);
 	
     if (list->head == NULL && list->tail == NULL){
         list->head = newNode;
@@ -123,6 +302,39 @@ void insertBack(List* list, void* toBeAdded){
     }
 }
 
+/**Moves every node of one list to the back of another, without copying or reallocating anything.
+*@pre Both lists hold the same kind of data and allocate their nodes the same way (both malloc, or pools
+*     that are freed together)
+*@post other is empty, its nodes belong to list
+*@param list pointer to the list that grows
+*@param other pointer to the list that is emptied
+**/
+void appendList(List* list, List* other){
+	if (list == NULL || other == NULL){
+		return;
+	}
+	loadList(list);
+	loadList(other);
+	if (other->head == NULL){
+		return;
+	}
+
+	if (list->head == NULL){
+		list->head = other->head;
+	}else{
+		list->tail->next = other->head;
+		other->head->previous = list->tail;
+	}
+	list->tail = other->tail;
+	list->length = list->length + other->length;
+	listChanged(list);
+
+	other->head = NULL;
+	other->tail = NULL;
+	other->length = 0;
+	listChanged(other);
+}
+
 /**Inserts a Node at the front of a linked list.  List metadata is updated
 * so that head and tail pointers are correct.
 *@pre 'List' type must exist and be used in order to keep track of the linked list.
@@ -133,10 +345,12 @@ void insertFront(List* list, void* toBeAdded){
 	if (list == NULL || toBeAdded == NULL){
 		return;
 	}
+	loadList(list);
 	
 	(list->length)++;
+	listChanged(list);
 
-	Node* newNode = initializeNode(toBeAdded);
+	Node* newNode = listNode(list, toBeAdded);
 	
     if (list->head == NULL && list->tail == NULL){
         list->head = newNode;
@@ -154,6 +368,7 @@ void insertFront(List* list, void* toBeAdded){
  *@return pointer to the data located at the head of the list
  **/
 void* getFromFront(List * list){
+	loadList(list);
 	if (list->head == NULL){
 		return NULL;
 	}
@@ -167,6 +382,7 @@ void* getFromFront(List * list){
  *@return pointer to the data located at the tail of the list
  **/
 void* getFromBack(List * list){
+	loadList(list);
 	if (list->tail == NULL){
 		return NULL;
 	}
@@ -178,6 +394,7 @@ void* deleteDataFromList(List* list, void* toBeDeleted){
 	if (list == NULL || toBeDeleted == NULL){
 		return NULL;
 	}
+	loadList(list);
 	
 	Node* tmp = list->head;
 	
@@ -199,9 +416,12 @@ void* deleteDataFromList(List* list, void* toBeDeleted){
 			}
 			
 			void* data = delNode->data;
-			free(delNode);
+			if (list->allocate == NULL){
+				free(delNode);
+			}
 			
 			(list->length)--;
+			listChanged(list);
 
 			return data;
 			
@@ -227,6 +447,7 @@ void insertSorted(List *list, void *toBeAdded){
 	if (list == NULL || toBeAdded == NULL){
 		return;
 	}
+	loadList(list);
 
 	if (list->head == NULL){
 		insertBack(list, toBeAdded);
@@ -247,21 +468,13 @@ void insertSorted(List *list, void *toBeAdded){
 	
 	while (currNode != NULL){
 		if (list->compare(toBeAdded, currNode->data) <= 0){
-		
-			char* currDescr = list->printData(currNode->data); 
-			char* newDescr = list->printData(toBeAdded); 
-		
-			//printf("Inserting %s before %s\n", newDescr, currDescr);
-
-			free(currDescr);
-			free(newDescr);
-		
-			Node* newNode = initializeNode(toBeAdded);
+			Node* newNode = listNode(list, toBeAdded);
 			newNode->next = currNode;
 			newNode->previous = currNode->previous;
 			currNode->previous->next = newNode;
 			currNode->previous = newNode;
 			(list->length)++;
+			listChanged(list);
 
 			return;
 		}
@@ -272,6 +485,83 @@ void insertSorted(List *list, void *toBeAdded){
 	return;
 }
 
+/** Function to merge two sorted runs of nodes linked by next, taking from first on ties so equal elements keep
+ * their order
+ *@return the first node of the merged run
+**/
+static Node* mergeNodes(Node* first, Node* second, int (*compare)(const void* first,const void* second)){
+	Node merged;
+	Node* last = &merged;
+
+	while (first != NULL && second != NULL){
+		if (compare(first->data, second->data) <= 0){
+			last->next = first;
+			first = first->next;
+		}else{
+			last->next = second;
+			second = second->next;
+		}
+		last = last->next;
+	}
+	last->next = (first != NULL) ? first : second;
+
+	return merged.next;
+}
+
+/** Sorts the list with its compare function by merging runs of nodes bottom up, so nothing is allocated and
+ * elements that compare equal keep their order. Only the next pointers are used while merging, the previous
+ * pointers and the tail are set again in one walk at the end.
+ *@param list pointer to the list
+**/
+void sortList(List* list){
+	if (list == NULL){
+		return;
+	}
+	loadList(list);
+	if (list->length < 2){
+		return;
+	}
+
+	//runs[i] holds a sorted run of 2^i nodes or nothing, like the digits of a binary counter
+	Node* runs[sizeof(int) * 8 + 1] = {NULL};
+	int numRuns = 0;
+
+	Node* curr = list->head;
+	while (curr != NULL){
+		Node* run = curr;
+		curr = curr->next;
+		run->next = NULL;
+
+		int i = 0;
+		while (i < numRuns && runs[i] != NULL){
+			run = mergeNodes(runs[i], run, list->compare);
+			runs[i] = NULL;
+			i++;
+		}
+		if (i == numRuns){
+			numRuns++;
+		}
+		runs[i] = run;
+	}
+
+	//Older runs hold earlier nodes, so they go first
+	Node* sorted = NULL;
+	for (int i = 0; i < numRuns; i++){
+		if (runs[i] != NULL){
+			sorted = (sorted == NULL) ? runs[i] : mergeNodes(runs[i], sorted, list->compare);
+		}
+	}
+
+	Node* previous = NULL;
+	list->head = sorted;
+	for (curr = sorted; curr != NULL; curr = curr->next){
+		curr->previous = previous;
+		previous = curr;
+	}
+	list->tail = previous;
+	listChanged(list);
+}
+
 /**Returns a string that contains a string representation of the list traversed from  head to tail. 
 Utilize an iterator and the list's printData function pointer to create the string.
 returned string must be freed by the calling function.
@@ -303,6 +593,8 @@ char* toString(List * list){
 ListIterator createIterator(List* list){
     ListIterator iter;
 
+    loadList(list);
+
     iter.current = list->head;
     
     return iter;
@@ -0,0 +1,311 @@
+/**
+ * Created by: Alexander Blankenstein
+ **/
+
+#include "SkipListAPI.h"
+
+/** Function to allocate a node with height levels, its pointers are set by whoever links it in
+**/
+static SkipListNode* skipListNode(void* data, int height){
+    SkipListNode* newNode = malloc(sizeof(SkipListNode) + sizeof(SkipListNode*) * height);
+
+    newNode->node.data = data;
+    newNode->node.previous = NULL;
+    newNode->node.next = NULL;
+    newNode->height = height;
+
+    return newNode;
+}
+
+/** Function to pick the height of a new node, one more level with a chance of one in four each time
+*@return the height, 1 up to SKIP_LIST_MAX_LEVEL
+**/
+static int randomHeight(SkipList* list){
+    //xorshift, good enough to keep the levels balanced and cheap to run on every insert
+    unsigned int x = list->seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    list->seed = x;
+
+    int height = 1;
+    while (height < SKIP_LIST_MAX_LEVEL && (x & 3) == 0){
+        height++;
+        x = x >> 2;
+    }
+    return height;
+}
+
+/** Function to initialize an empty skip list, only the struct and the node before the first element are allocated
+*@return pointer to the list head
+*@param printFunction function pointer to print a single element of the list
+*@param deleteFunction function pointer to delete a single piece of data from the list
+*@param compareFunction function pointer to compare two elements of the list in order to place them
+**/
+SkipList* initializeSkipList(char* (*printFunction)(void* toBePrinted),void (*deleteFunction)(void* toBeDeleted),int (*compareFunction)(const void* first,const void* second)){
+    assert(printFunction != NULL);
+    assert(deleteFunction != NULL);
+    assert(compareFunction != NULL);
+
+    SkipList* tmpList = malloc(sizeof(SkipList));
+
+    tmpList->head = skipListNode(NULL, SKIP_LIST_MAX_LEVEL);
+    for (int i = 0; i < SKIP_LIST_MAX_LEVEL; i++){
+        tmpList->head->forward[i] = NULL;
+    }
+    tmpList->tail = NULL;
+    tmpList->length = 0;
+    tmpList->level = 1;
+    tmpList->seed = 2463534242u;
+
+    tmpList->deleteData = deleteFunction;
+    tmpList->compare = compareFunction;
+    tmpList->printData = printFunction;
+
+    return tmpList;
+}
+
+/** Inserts an element after the last one that compares less than or equal to it, going down from the top level
+*@param list pointer to the skip list
+*@param toBeAdded a pointer to data that is to be added to the list
+**/
+void insertSkipList(SkipList* list, void* toBeAdded){
+    if (list == NULL || toBeAdded == NULL){
+        return;
+    }
+
+    //The last node before the new one on every level
+    SkipListNode* update[SKIP_LIST_MAX_LEVEL];
+    SkipListNode* curr = list->head;
+    for (int i = list->level - 1; i >= 0; i--){
+        while (curr->forward[i] != NULL && list->compare(curr->forward[i]->node.data, toBeAdded) <= 0){
+            curr = curr->forward[i];
+        }
+        update[i] = curr;
+    }
+
+    int height = randomHeight(list);
+    if (height > list->level){
+        for (int i = list->level; i < height; i++){
+            update[i] = list->head;
+        }
+        list->level = height;
+    }
+
+    SkipListNode* newNode = skipListNode(toBeAdded, height);
+    for (int i = 0; i < height; i++){
+        newNode->forward[i] = update[i]->forward[i];
+        update[i]->forward[i] = newNode;
+    }
+
+    //The bottom level is also a doubly linked list of Nodes, the head itself is not part of it
+    newNode->node.previous = (curr == list->head) ? NULL : &curr->node;
+    newNode->node.next = curr->node.next;
+    if (curr->node.next != NULL){
+        curr->node.next->previous = &newNode->node;
+    }else{
+        list->tail = &newNode->node;
+    }
+    curr->node.next = &newNode->node;
+
+    list->length++;
+}
+
+/** Function to find the last node whose element compares less than searchRecord
+*@return the node, list->head if there is none
+**/
+static SkipListNode* findBefore(SkipList* list, const void* searchRecord){
+    SkipListNode* curr = list->head;
+    for (int i = list->level - 1; i >= 0; i--){
+        while (curr->forward[i] != NULL && list->compare(curr->forward[i]->node.data, searchRecord) < 0){
+            curr = curr->forward[i];
+        }
+    }
+    return curr;
+}
+
+/** Returns the first element that compares equal to searchRecord
+*@return the data, or NULL if there is none
+*@param list pointer to the skip list
+*@param searchRecord a pointer to the data to look for
+**/
+void* findInSkipList(SkipList* list, const void* searchRecord){
+    if (list == NULL || searchRecord == NULL){
+        return NULL;
+    }
+
+    SkipListNode* next = findBefore(list, searchRecord)->forward[0];
+    if (next != NULL && list->compare(next->node.data, searchRecord) == 0){
+        return next->node.data;
+    }
+    return NULL;
+}
+
+/** Removes data from the skip list. The elements that compare equal to it are walked on the bottom level to find
+ * the one with the same address, then it is unlinked from every level it is on.
+*@return the data, or NULL if it is not in the list
+*@param list pointer to the skip list
+*@param toBeDeleted a pointer to the data to remove
+**/
+void* deleteDataFromSkipList(SkipList* list, void* toBeDeleted){
+    if (list == NULL || toBeDeleted == NULL){
+        return NULL;
+    }
+
+    SkipListNode* update[SKIP_LIST_MAX_LEVEL];
+    SkipListNode* curr = list->head;
+    for (int i = list->level - 1; i >= 0; i--){
+        while (curr->forward[i] != NULL && list->compare(curr->forward[i]->node.data, toBeDeleted) < 0){
+            curr = curr->forward[i];
+        }
+        update[i] = curr;
+    }
+
+    SkipListNode* target = curr->forward[0];
+    while (target != NULL && target->node.data != toBeDeleted){
+        if (list->compare(target->node.data, toBeDeleted) != 0){
+            return NULL;
+        }
+        //Move the nodes before the target along on every level that skips past this node
+        for (int i = 0; i < target->height; i++){
+            update[i] = target;
+        }
+        target = target->forward[0];
+    }
+    if (target == NULL){
+        return NULL;
+    }
+
+    for (int i = 0; i < target->height; i++){
+        update[i]->forward[i] = target->forward[i];
+    }
+    while (list->level > 1 && list->head->forward[list->level - 1] == NULL){
+        list->level--;
+    }
+
+    if (target->node.previous != NULL){
+        target->node.previous->next = target->node.next;
+    }else{
+        list->head->node.next = target->node.next;
+    }
+    if (target->node.next != NULL){
+        target->node.next->previous = target->node.previous;
+    }else{
+        list->tail = target->node.previous;
+    }
+
+    list->length--;
+    free(target);
+
+    return toBeDeleted;
+}
+
+/** Returns the smallest element
+*@return the data, or NULL if the list is empty
+*@param list pointer to the skip list
+**/
+void* getFromSkipListFront(SkipList* list){
+    if (list == NULL || list->head->node.next == NULL){
+        return NULL;
+    }
+    return list->head->node.next->data;
+}
+
+/** Returns the largest element
+*@return the data, or NULL if the list is empty
+*@param list pointer to the skip list
+**/
+void* getFromSkipListBack(SkipList* list){
+    if (list == NULL || list->tail == NULL){
+        return NULL;
+    }
+    return list->tail->data;
+}
+
+/** Returns the number of elements in the skip list
+*@return the length
+*@param list pointer to the skip list
+**/
+int getSkipListLength(SkipList* list){
+    if (list == NULL){
+        return 0;
+    }
+    return list->length;
+}
+
+/** Frees the data of every element and every node, walking the bottom level
+*@param list pointer to the skip list
+**/
+void clearSkipList(SkipList* list){
+    if (list == NULL){
+        return;
+    }
+
+    Node* curr = list->head->node.next;
+    while (curr != NULL){
+        Node* next = curr->next;
+        list->deleteData(curr->data);
+        //node is the first member, so this is the address of the SkipListNode
+        free(curr);
+        curr = next;
+    }
+
+    for (int i = 0; i < SKIP_LIST_MAX_LEVEL; i++){
+        list->head->forward[i] = NULL;
+    }
+    list->head->node.next = NULL;
+    list->tail = NULL;
+    list->length = 0;
+    list->level = 1;
+}
+
+/** Frees the data of every element, the nodes and the list struct
+*@param list pointer to the skip list
+**/
+void freeSkipList(SkipList* list){
+    if (list == NULL){
+        return;
+    }
+
+    clearSkipList(list);
+    free(list->head);
+    free(list);
+}
+
+/** Returns a string representation of the skip list, made the same way toString makes one of a List
+*@return the string, to be freed by the caller
+*@param list pointer to the skip list
+**/
+char* skipListToString(SkipList* list){
+    char* str = malloc(sizeof(char));
+    strcpy(str, "");
+
+    if (list == NULL){
+        return str;
+    }
+
+    int len = 0;
+    for (Node* curr = list->head->node.next; curr != NULL; curr = curr->next){
+        char* currDescr = list->printData(curr->data);
+        int descrLen = strlen(currDescr);
+        str = realloc(str, sizeof(char) * (len + descrLen + 2));
+        str[len] = '\n';
+        memcpy(str + len + 1, currDescr, descrLen + 1);
+        len = len + descrLen + 1;
+        free(currDescr);
+    }
+
+    return str;
+}
+
+/** Function for creating an iterator over the skip list, it walks the bottom level like the nodes of a List
+*@return the iterator
+*@param list pointer to the skip list
+**/
+ListIterator createSkipListIterator(SkipList* list){
+    ListIterator iter;
+
+    iter.current = (list != NULL) ? list->head->node.next : NULL;
+
+    return iter;
+}
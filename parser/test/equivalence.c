@@ -0,0 +1,238 @@
+/**
+ * Created by: Alexander Blankenstein
+ *
+ * Reads the same files with createGPXdoc, which goes through libxml, and with the loaders built on the hand written
+ * tokenizer: createFastGPXdoc, createParallelGPXdoc, createLazyGPXdoc and createSnapshotGPXdoc, the last one with
+ * and without a snapshot beside the file. Every loader has to give NULL when createGPXdoc does, and a document with
+ * the same contents when it does not. The files are the documents below, each written to /tmp, followed by any
+ * named on the command line. See "make equivalence".
+ * Usage: equivalence [file.gpx ...]
+ **/
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "GPXParser.h"
+#include "GPXHelper.h"
+
+#define GPX_OPEN "<gpx version=\"1.1\" creator=\"equivalence\" xmlns=\"http://www.topografix.com/GPX/1/1\">"
+#define POINT "<wpt lat=\"43.5\" lon=\"-80.25\"><ele>310.5</ele><time>2020-01-01T10:00:00Z</time><name>a</name></wpt>"
+
+#define NUM_LOADERS 5
+
+typedef struct {
+    const char* label;
+    const char* text;
+} Case;
+
+static const Case cases[] = {
+    //Documents libxml reads
+    {"plain", GPX_OPEN POINT
+        "<rte><name>r</name><desc>d</desc><rtept lat=\"1\" lon=\"2\"><ele>3</ele></rtept><rtept lat=\"1.5\" lon=\"2.5\"/></rte>"
+        "<trk><name>t</name><trkseg><trkpt lat=\"4\" lon=\"5\"><time>2020-01-01T10:00:01Z</time></trkpt></trkseg><trkseg/></trk>"
+        "</gpx>"},
+    {"declaration", "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n" GPX_OPEN POINT "</gpx>"},
+    {"declaration standalone", "<?xml version='1.0' encoding='utf-8' standalone='no' ?>" GPX_OPEN POINT "</gpx>"},
+    {"declaration version 1.1", "<?xml version = \"1.1\"?>" GPX_OPEN POINT "</gpx>"},
+    {"byte order mark", "\xEF\xBB\xBF<?xml version=\"1.0\"?>" GPX_OPEN POINT "</gpx>"},
+    {"references", GPX_OPEN "<wpt lat=\"1\" lon=\"2\"><name>a &amp; b &lt;&#233;&#x4E2D;&gt; ]]&gt;</name>"
+        "<desc title=\"x&quot;\ty\">]] &apos;</desc></wpt></gpx>"},
+    {"cdata comments and pis", GPX_OPEN "<!-- c --><?keep this?><wpt lat=\"1\" lon=\"2\"><name><![CDATA[a <b> & c]]></name>"
+        "<desc>x<!-- y -->z<?pi?></desc></wpt></gpx>"},
+    {"line ends", GPX_OPEN "\r\n<wpt lat=\"1\"\r\n lon=\"2\"><desc>a\r\nb\rc</desc></wpt>\r\n</gpx>"},
+    {"utf-8", GPX_OPEN "<wpt lat=\"1\" lon=\"2\"><name>\xC3\xA9t\xC3\xA9 \xE4\xB8\xAD \xF0\x9F\x97\xBA</name>"
+        "<extensions><\xC3\xA9l\xC3\xA9ment\xCC\x80>x</\xC3\xA9l\xC3\xA9ment\xCC\x80></extensions></wpt></gpx>"},
+    {"prefixed", "<g:gpx version=\"1.1\" creator=\"equivalence\" xmlns:g=\"http://www.topografix.com/GPX/1/1\">"
+        "<g:wpt lat=\"1\" lon=\"2\"><g:name>a</g:name></g:wpt></g:gpx>"},
+
+    //Documents libxml rejects
+    {"declaration without version", "<?xml encoding=\"UTF-8\"?>" GPX_OPEN POINT "</gpx>"},
+    {"declaration empty version", "<?xml version=\"\" junk?>" GPX_OPEN POINT "</gpx>"},
+    {"declaration version 2.0", "<?xml version=\"2.0\"?>" GPX_OPEN POINT "</gpx>"},
+    {"declaration junk", "<?xml version=\"1.0\" junk?>" GPX_OPEN POINT "</gpx>"},
+    {"declaration out of order", "<?xml version=\"1.0\" standalone=\"no\" encoding=\"UTF-8\"?>" GPX_OPEN POINT "</gpx>"},
+    {"declaration no space", "<?xml version=\"1.0\"encoding=\"UTF-8\"?>" GPX_OPEN POINT "</gpx>"},
+    {"declaration standalone maybe", "<?xml version=\"1.0\" standalone=\"maybe\"?>" GPX_OPEN POINT "</gpx>"},
+    {"cdata end in text", GPX_OPEN "<wpt lat=\"1\" lon=\"2\"><name>a]]>b</name></wpt></gpx>"},
+    {"cdata end in dropped text", GPX_OPEN "]]>" POINT "</gpx>"},
+    {"bad byte in name", GPX_OPEN "<wpt lat=\"1\" lon=\"2\"><n\xFF>a</n\xFF></wpt></gpx>"},
+    {"name starting with a mark", GPX_OPEN "<wpt lat=\"1\" lon=\"2\"><\xCC\x80>a</\xCC\x80></wpt></gpx>"},
+    {"bad byte in text", GPX_OPEN "<wpt lat=\"1\" lon=\"2\"><name>\xFF</name></wpt></gpx>"},
+    {"bad byte in dropped text", GPX_OPEN "\xFF" POINT "</gpx>"},
+    {"overlong utf-8", GPX_OPEN "<wpt lat=\"1\" lon=\"2\"><name>\xC0\xAF</name></wpt></gpx>"},
+    {"surrogate", GPX_OPEN "<wpt lat=\"1\" lon=\"2\"><name>\xED\xA0\x80</name></wpt></gpx>"},
+    {"control character", GPX_OPEN "<wpt lat=\"1\" lon=\"2\"><name>a\x01</name></wpt></gpx>"},
+    {"bad byte in comment", GPX_OPEN "<!-- \xFF -->" POINT "</gpx>"},
+    {"bad byte in cdata", GPX_OPEN "<wpt lat=\"1\" lon=\"2\"><desc><![CDATA[\xFF]]></desc></wpt></gpx>"},
+    {"pi without space", GPX_OPEN "<?pi?x?>" POINT "</gpx>"},
+};
+
+static const char* loaderNames[NUM_LOADERS] = {"fast", "parallel", "lazy", "snapshot", "from snapshot"};
+
+/** Function to compare two GPXData lists
+**/
+static bool sameData(List* a, List* b){
+    if (getLength(a) != getLength(b)){
+        return false;
+    }
+    ListIterator iterA = createIterator(a);
+    ListIterator iterB = createIterator(b);
+    GPXData* dataA;
+    GPXData* dataB;
+    while ((dataA = nextElement(&iterA)) != NULL && (dataB = nextElement(&iterB)) != NULL){
+        if (strcmp(getGPXDataName(dataA), getGPXDataName(dataB)) != 0 || strcmp(dataA->value, dataB->value) != 0){
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Function to compare two waypoint lists, typed values included
+**/
+static bool samePoints(List* a, List* b){
+    if (getLength(a) != getLength(b)){
+        return false;
+    }
+    ListIterator iterA = createIterator(a);
+    ListIterator iterB = createIterator(b);
+    Waypoint* wptA;
+    Waypoint* wptB;
+    while ((wptA = nextElement(&iterA)) != NULL && (wptB = nextElement(&iterB)) != NULL){
+        bool sameEle = wptA->elevation == wptB->elevation || (isnan(wptA->elevation) && isnan(wptB->elevation));
+        if (strcmp(wptA->name, wptB->name) != 0 || wptA->latitude != wptB->latitude || wptA->longitude != wptB->longitude
+            || !sameEle || wptA->time != wptB->time || !sameData(wptA->otherData, wptB->otherData)){
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Function to compare everything two documents hold
+**/
+static bool sameDoc(GPXdoc* a, GPXdoc* b){
+    if (strcmp(a->namespace, b->namespace) != 0 || a->version != b->version || strcmp(a->creator, b->creator) != 0
+        || !samePoints(a->waypoints, b->waypoints) || getLength(a->routes) != getLength(b->routes)
+        || getLength(a->tracks) != getLength(b->tracks)){
+        return false;
+    }
+
+    ListIterator routesA = createIterator(a->routes);
+    ListIterator routesB = createIterator(b->routes);
+    Route* rtA;
+    Route* rtB;
+    while ((rtA = nextElement(&routesA)) != NULL && (rtB = nextElement(&routesB)) != NULL){
+        if (strcmp(rtA->name, rtB->name) != 0 || !sameData(rtA->otherData, rtB->otherData) || !samePoints(rtA->waypoints, rtB->waypoints)){
+            return false;
+        }
+    }
+
+    ListIterator tracksA = createIterator(a->tracks);
+    ListIterator tracksB = createIterator(b->tracks);
+    Track* trkA;
+    Track* trkB;
+    while ((trkA = nextElement(&tracksA)) != NULL && (trkB = nextElement(&tracksB)) != NULL){
+        if (strcmp(trkA->name, trkB->name) != 0 || !sameData(trkA->otherData, trkB->otherData)
+            || getLength(trkA->segments) != getLength(trkB->segments)){
+            return false;
+        }
+        ListIterator segsA = createIterator(trkA->segments);
+        ListIterator segsB = createIterator(trkB->segments);
+        TrackSegment* segA;
+        TrackSegment* segB;
+        while ((segA = nextElement(&segsA)) != NULL && (segB = nextElement(&segsB)) != NULL){
+            if (!samePoints(segA->waypoints, segB->waypoints)){
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/** Function to read a file with one of the loaders named in loaderNames
+**/
+static GPXdoc* readWith(int loader, char* fileName){
+    switch (loader){
+        case 0: return createFastGPXdoc(fileName);
+        case 1: return createParallelGPXdoc(fileName, 2);
+        case 2: return createLazyGPXdoc(fileName);
+        case 3: return createSnapshotGPXdoc(fileName);
+        default: {
+            //A file that cannot be read has no snapshot, so this reads it like createFastGPXdoc
+            snapshotGPXFile(fileName);
+            GPXdoc* doc = createSnapshotGPXdoc(fileName);
+            dropGPXSnapshot(fileName);
+            return doc;
+        }
+    }
+}
+
+//libxml reports every document it rejects on stderr, which is expected here
+static void ignoreError(void* context, const char* message, ...){
+    (void)context;
+    (void)message;
+}
+
+/** Function to read one file with createGPXdoc and with every other loader, printing each one that disagrees
+ *@return the number of loaders that disagree
+**/
+static int checkFile(const char* label, char* fileName){
+    GPXdoc* expected = createGPXdoc(fileName);
+    int wrong = 0;
+
+    for (int loader = 0; loader < NUM_LOADERS; loader++){
+        GPXdoc* doc = readWith(loader, fileName);
+        if ((doc == NULL) != (expected == NULL)){
+            printf("%s: %s gives %s, createGPXdoc %s\n", label, loaderNames[loader], doc == NULL ? "NULL" : "a document",
+                expected == NULL ? "NULL" : "a document");
+            wrong++;
+        }
+        else if (doc != NULL && !sameDoc(expected, doc)){
+            printf("%s: %s gives a different document\n", label, loaderNames[loader]);
+            wrong++;
+        }
+        deleteGPXdoc(doc);
+    }
+
+    deleteGPXdoc(expected);
+    return wrong;
+}
+
+int main(int argc, char** argv){
+    char fileName[] = "/tmp/gpxequivalenceXXXXXX.gpx";
+    int fd = mkstemps(fileName, 4);
+    if (fd < 0){
+        fprintf(stderr, "cannot create a file in /tmp\n");
+        return 1;
+    }
+    close(fd);
+
+    initGPXParser();
+    xmlSetGenericErrorFunc(NULL, &ignoreError);
+    int wrong = 0;
+    int numCases = sizeof(cases) / sizeof(cases[0]);
+
+    for (int i = 0; i < numCases; i++){
+        FILE* file = fopen(fileName, "w");
+        if (file == NULL || fputs(cases[i].text, file) < 0 || fclose(file) != 0){
+            fprintf(stderr, "cannot write %s\n", fileName);
+            remove(fileName);
+            return 1;
+        }
+        wrong = wrong + checkFile(cases[i].label, fileName);
+    }
+    remove(fileName);
+
+    for (int i = 1; i < argc; i++){
+        wrong = wrong + checkFile(argv[i], argv[i]);
+    }
+
+    printf("%d documents, %d files, %d loaders that disagree\n", numCases, argc - 1, wrong);
+    cleanupGPXParser();
+    return wrong != 0;
+}
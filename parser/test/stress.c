@@ -0,0 +1,270 @@
+/**
+ * Created by: Alexander Blankenstein
+ *
+ * Calls the lookups of one document from many threads at once: getWaypoint/getRoute/getTrack,
+ * getRoutesBetween/getTracksBetween and getRouteLen/getTrackLen. Every answer is checked against the one from a
+ * second copy of the document read by a single thread. Run on a document from createFastGPXdoc and on one from
+ * createLazyGPXdoc, whose caches and points are all filled by the threads racing for them. Meant to be built
+ * against the ThreadSanitizer library, see "make stress".
+ * Usage: stress [threads] [rounds]
+ **/
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "GPXParser.h"
+
+#define NUM_WAYPOINTS 200
+#define NUM_ROUTES 120
+#define NUM_TRACKS 60
+#define NUM_POINTS 40
+
+//The answers of the single threaded copy
+typedef struct {
+    double waypointLat[NUM_WAYPOINTS];
+    float routeLen[NUM_ROUTES];
+    float trackLen[NUM_TRACKS];
+    int routesBetween[NUM_ROUTES];
+    int tracksBetween[NUM_TRACKS];
+    //Start and end of every route and track, the places asked about
+    float routeEnds[NUM_ROUTES][4];
+    float trackEnds[NUM_TRACKS][4];
+} Expected;
+
+typedef struct {
+    GPXdoc* doc;
+    const Expected* expected;
+    int rounds;
+    int first;
+    int wrong;
+} Worker;
+
+/** Function to write a GPX file with waypoints, routes and two segment tracks. Every fourth route and track
+ *  starts and ends where the one before it does, so the between searches find more than one.
+**/
+static bool writeStressFile(const char* fileName){
+    FILE* file = fopen(fileName, "w");
+    if (file == NULL){
+        return false;
+    }
+
+    fprintf(file, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    fprintf(file, "<gpx version=\"1.1\" creator=\"stress\" xmlns=\"http://www.topografix.com/GPX/1/1\">\n");
+    for (int i = 0; i < NUM_WAYPOINTS; i++){
+        fprintf(file, "<wpt lat=\"%.6f\" lon=\"%.6f\"><ele>%d</ele><name>wpt%d</name></wpt>\n", 43.0 + i * 0.001, -80.0 - i * 0.001, i, i);
+    }
+    for (int i = 0; i < NUM_ROUTES; i++){
+        int place = i % 4 == 3 ? i - 1 : i;
+        fprintf(file, "<rte><name>rte%d</name>\n", i);
+        for (int j = 0; j < NUM_POINTS; j++){
+            double step = j == 0 || j == NUM_POINTS - 1 ? j : j + (i % 4 == 3 ? 0.5 : 0.0);
+            fprintf(file, "<rtept lat=\"%.6f\" lon=\"%.6f\"><name>p%d</name></rtept>\n", 44.0 + place * 0.01 + step * 0.0001, -79.0 + step * 0.0002, j);
+        }
+        fprintf(file, "</rte>\n");
+    }
+    for (int i = 0; i < NUM_TRACKS; i++){
+        int place = i % 4 == 3 ? i - 1 : i;
+        fprintf(file, "<trk><name>trk%d</name>\n", i);
+        for (int s = 0; s < 2; s++){
+            fprintf(file, "<trkseg>\n");
+            for (int j = 0; j < NUM_POINTS; j++){
+                double step = s * NUM_POINTS + j;
+                fprintf(file, "<trkpt lat=\"%.6f\" lon=\"%.6f\"><time>2020-01-01T00:%02d:%02dZ</time></trkpt>\n", 45.0 + place * 0.01 + step * 0.0001, -78.0 + step * 0.0001, s, j);
+            }
+            fprintf(file, "</trkseg>\n");
+        }
+        fprintf(file, "</trk>\n");
+    }
+    fprintf(file, "</gpx>\n");
+
+    return fclose(file) == 0;
+}
+
+/** Function that returns the number of elements in a list from a between search, which is NULL when it is empty
+**/
+static int takeLength(List* list){
+    int length = list == NULL ? 0 : getLength(list);
+    if (list != NULL){
+        freeList(list);
+    }
+    return length;
+}
+
+/** Function to note the first and last point of a waypoint list
+**/
+static void noteEnds(List* waypoints, float ends[4]){
+    Waypoint* first = getFromFront(waypoints);
+    Waypoint* last = getFromBack(waypoints);
+    ends[0] = first->latitude;
+    ends[1] = first->longitude;
+    ends[2] = last->latitude;
+    ends[3] = last->longitude;
+}
+
+/** Function to get every answer from one thread
+**/
+static void fillExpected(GPXdoc* doc, Expected* expected){
+    char name[32];
+
+    for (int i = 0; i < NUM_WAYPOINTS; i++){
+        snprintf(name, sizeof(name), "wpt%d", i);
+        expected->waypointLat[i] = getWaypoint(doc, name)->latitude;
+    }
+    for (int i = 0; i < NUM_ROUTES; i++){
+        snprintf(name, sizeof(name), "rte%d", i);
+        Route* route = getRoute(doc, name);
+        expected->routeLen[i] = getRouteLen(route);
+        noteEnds(route->waypoints, expected->routeEnds[i]);
+    }
+    for (int i = 0; i < NUM_TRACKS; i++){
+        snprintf(name, sizeof(name), "trk%d", i);
+        Track* track = getTrack(doc, name);
+        TrackSegment* first = getFromFront(track->segments);
+        TrackSegment* last = getFromBack(track->segments);
+        expected->trackLen[i] = getTrackLen(track);
+        noteEnds(first->waypoints, expected->trackEnds[i]);
+        expected->trackEnds[i][2] = ((Waypoint*)getFromBack(last->waypoints))->latitude;
+        expected->trackEnds[i][3] = ((Waypoint*)getFromBack(last->waypoints))->longitude;
+    }
+    for (int i = 0; i < NUM_ROUTES; i++){
+        const float* ends = expected->routeEnds[i];
+        expected->routesBetween[i] = takeLength(getRoutesBetween(doc, ends[0], ends[1], ends[2], ends[3], 10));
+    }
+    for (int i = 0; i < NUM_TRACKS; i++){
+        const float* ends = expected->trackEnds[i];
+        expected->tracksBetween[i] = takeLength(getTracksBetween(doc, ends[0], ends[1], ends[2], ends[3], 10));
+    }
+}
+
+/** Function that asks every question in an order of its own, counting the answers that differ from the expected ones
+**/
+static void* runWorker(void* data){
+    Worker* worker = data;
+    GPXdoc* doc = worker->doc;
+    const Expected* expected = worker->expected;
+    char name[32];
+
+    for (int r = 0; r < worker->rounds; r++){
+        for (int k = 0; k < NUM_ROUTES; k++){
+            int i = (worker->first + k * 7) % NUM_ROUTES;
+            snprintf(name, sizeof(name), "rte%d", i);
+            Route* route = getRoute(doc, name);
+            if (route == NULL || getRouteLen(route) != expected->routeLen[i]){
+                worker->wrong++;
+            }
+            //From the second round on the points are read too, so a lazy document loads them while other
+            //threads still answer from what it kept of them
+            Waypoint* start = r > 0 && route != NULL ? getFromFront(route->waypoints) : NULL;
+            if (start != NULL && (float)start->latitude != expected->routeEnds[i][0]){
+                worker->wrong++;
+            }
+
+            const float* ends = expected->routeEnds[i];
+            if (takeLength(getRoutesBetween(doc, ends[0], ends[1], ends[2], ends[3], 10)) != expected->routesBetween[i]){
+                worker->wrong++;
+            }
+        }
+
+        for (int k = 0; k < NUM_TRACKS; k++){
+            int i = (worker->first + k * 11) % NUM_TRACKS;
+            snprintf(name, sizeof(name), "trk%d", i);
+            Track* track = getTrack(doc, name);
+            if (track == NULL || getTrackLen(track) != expected->trackLen[i]){
+                worker->wrong++;
+            }
+            TrackSegment* segment = r > 0 && track != NULL ? getFromBack(track->segments) : NULL;
+            Waypoint* end = segment != NULL ? getFromBack(segment->waypoints) : NULL;
+            if (end != NULL && (float)end->longitude != expected->trackEnds[i][3]){
+                worker->wrong++;
+            }
+
+            const float* ends = expected->trackEnds[i];
+            if (takeLength(getTracksBetween(doc, ends[0], ends[1], ends[2], ends[3], 10)) != expected->tracksBetween[i]){
+                worker->wrong++;
+            }
+        }
+
+        for (int k = 0; k < NUM_WAYPOINTS; k++){
+            int i = (worker->first + k * 13) % NUM_WAYPOINTS;
+            snprintf(name, sizeof(name), "wpt%d", i);
+            Waypoint* waypoint = getWaypoint(doc, name);
+            if (waypoint == NULL || waypoint->latitude != expected->waypointLat[i]){
+                worker->wrong++;
+            }
+        }
+    }
+    return NULL;
+}
+
+/** Function to run the threads on one document
+ *@return the number of wrong answers
+**/
+static int stressDoc(GPXdoc* doc, const Expected* expected, int numThreads, int rounds){
+    pthread_t* threads = malloc(sizeof(pthread_t) * numThreads);
+    Worker* workers = malloc(sizeof(Worker) * numThreads);
+    int wrong = 0;
+
+    for (int i = 0; i < numThreads; i++){
+        workers[i].doc = doc;
+        workers[i].expected = expected;
+        workers[i].rounds = rounds;
+        workers[i].first = i * 17;
+        workers[i].wrong = 0;
+        pthread_create(&threads[i], NULL, &runWorker, &workers[i]);
+    }
+    for (int i = 0; i < numThreads; i++){
+        pthread_join(threads[i], NULL);
+        wrong = wrong + workers[i].wrong;
+    }
+
+    free(threads);
+    free(workers);
+    return wrong;
+}
+
+int main(int argc, char** argv){
+    int numThreads = argc > 1 ? atoi(argv[1]) : 8;
+    int rounds = argc > 2 ? atoi(argv[2]) : 4;
+    char fileName[] = "/tmp/gpxstressXXXXXX.gpx";
+
+    int fd = mkstemps(fileName, 4);
+    if (fd < 0){
+        fprintf(stderr, "cannot create a file in /tmp\n");
+        return 1;
+    }
+    close(fd);
+    if (!writeStressFile(fileName)){
+        fprintf(stderr, "cannot write %s\n", fileName);
+        remove(fileName);
+        return 1;
+    }
+
+    initGPXParser();
+
+    Expected* expected = malloc(sizeof(Expected));
+    GPXdoc* reference = createFastGPXdoc(fileName);
+    fillExpected(reference, expected);
+    deleteGPXdoc(reference);
+
+    int failed = 0;
+    const char* kinds[2] = {"fast", "lazy"};
+    for (int k = 0; k < 2; k++){
+        GPXdoc* doc = k == 0 ? createFastGPXdoc(fileName) : createLazyGPXdoc(fileName);
+        int wrong = doc == NULL ? -1 : stressDoc(doc, expected, numThreads, rounds);
+        printf("%s: %d threads x %d rounds, %d wrong answers\n", kinds[k], numThreads, rounds, wrong);
+        failed = failed || wrong != 0;
+        deleteGPXdoc(doc);
+    }
+
+    free(expected);
+    remove(fileName);
+    cleanupGPXParser();
+    return failed;
+}